@@ -0,0 +1,111 @@
+/* ./lib/BlockHeap.cc
+ * BlockHeap is a data structure in the library
+ *  BlockHeap is a set of flat vectors holding one binary min-heap of block_ids per set,
+ *    ordered by (key, block_id), with the heap index of every block for O(log ways) updates
+ * Cache with n sets of m blocks will have a BlockHeap with n heaps of up to m blocks
+ */
+
+#include "containers.hh"
+#include <iostream>
+
+/* The end of a list (or a block out of the heap) */
+const unsigned BlockHeap::NIL;
+
+/* Constructor: Initialize the BlockHeap with the number of sets (n_sets) and blocks per set (n_ways) */
+BlockHeap::BlockHeap(unsigned n_sets, unsigned n_ways) {
+  this->initialize(n_sets, n_ways);
+}
+
+/* Allocate the heaps, all of them are empty */
+void BlockHeap::initialize(unsigned n_sets, unsigned n_ways) {
+  this->numSets = n_sets;
+  this->numWays = n_ways;
+
+  this->heaps.assign((size_t)n_sets * n_ways, NIL);
+  this->positions.assign((size_t)n_sets * n_ways, NIL);
+  this->keys.assign((size_t)n_sets * n_ways, 0);
+  this->sizes.assign(n_sets, 0);
+}
+
+/* Put a block at a heap index */
+void BlockHeap::place(unsigned set_id, unsigned index, unsigned block_id) {
+  size_t base = (size_t)set_id * this->numWays;
+  this->heaps[base + index] = block_id;
+  this->positions[base + block_id] = index;
+}
+
+/* Move the block at index up, while it goes before its parent */
+void BlockHeap::siftUp(unsigned set_id, unsigned index) {
+  size_t base = (size_t)set_id * this->numWays;
+  unsigned block_id = this->heaps[base + index];
+
+  while (index > 0) {
+    unsigned parent = (index - 1) / 2;
+    unsigned parent_id = this->heaps[base + parent];
+    if (!this->before(set_id, block_id, parent_id))
+      break;
+    this->place(set_id, index, parent_id);
+    index = parent;
+  }
+  this->place(set_id, index, block_id);
+}
+
+/* Move the block at index down, while a child goes before it */
+void BlockHeap::siftDown(unsigned set_id, unsigned index) {
+  size_t base = (size_t)set_id * this->numWays;
+  unsigned size = this->sizes[set_id];
+  unsigned block_id = this->heaps[base + index];
+
+  while (2*index + 1 < size) {
+    unsigned child = 2*index + 1;
+    if (child + 1 < size && this->before(set_id, this->heaps[base + child + 1], this->heaps[base + child]))
+      ++child;
+    unsigned child_id = this->heaps[base + child];
+    if (!this->before(set_id, child_id, block_id))
+      break;
+    this->place(set_id, index, child_id);
+    index = child;
+  }
+  this->place(set_id, index, block_id);
+}
+
+/* Set the key of a block, the block is added at the bottom of the heap if it was not in it */
+void BlockHeap::setKey(unsigned set_id, unsigned block_id, uint64_t key) {
+  size_t base = (size_t)set_id * this->numWays;
+  unsigned index = this->positions[base + block_id];
+
+  bool added = index == NIL;
+  if (added) {
+    index = this->sizes[set_id]++;
+    this->place(set_id, index, block_id);
+  }
+  uint64_t old = this->keys[base + block_id];
+  this->keys[base + block_id] = key;
+
+  // A new block (at the bottom) or a smaller key moves up, a larger key moves down
+  if (added || key < old)
+    this->siftUp(set_id, index);
+  else
+    this->siftDown(set_id, index);
+}
+
+/* Empty all the heaps */
+void BlockHeap::reset() {
+  this->initialize(this->numSets, this->numWays);
+}
+
+/* Write the heaps and the keys to a checkpoint */
+void BlockHeap::save(CheckpointWriter &w) const {
+  w.put(this->heaps);
+  w.put(this->positions);
+  w.put(this->keys);
+  w.put(this->sizes);
+}
+
+/* Read the heaps and the keys back from a checkpoint */
+void BlockHeap::restore(CheckpointReader &r) {
+  r.get(this->heaps);
+  r.get(this->positions);
+  r.get(this->keys);
+  r.get(this->sizes);
+}
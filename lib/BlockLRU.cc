@@ -1,80 +1,108 @@
 /* ./lib/BlockLRU.cc
  * BlockLRU is a data structure in the library
- *  BlockLRU is a vector of list of block_ids,
- *    each element of the vector is the block_id sequence of the set
- * Cache with n sets will have a vector of BLockQueues with n lists
+ *  BlockLRU is a flat vector of links between block_ids,
+ *    each set threads an intrusive doubly-linked list (most recently used at the head) through its blocks
+ * Cache with n sets of m blocks will have a BlockLRU with n lists over n*m links
  */
 
 #include "containers.hh"
 #include <iostream>
+#include <stdexcept>
 
-/* Constructor: Initialize the BlockLRU with the number of sets (n_sets) */
-BlockLRU::BlockLRU(unsigned n_sets) {
-  numSets = n_sets;
+/* The end of a list */
+const unsigned BlockLRU::NIL;
 
-  list<unsigned> l;
-  unordered_map<unsigned, list<unsigned>::iterator> ma;
-  for (unsigned i=0; i!=n_sets; ++i) {
-    lists.push_back(l);
-    maps.push_back(ma);
-  }
+/* Constructor: Initialize the BlockLRU with the number of sets (n_sets) and blocks per set (n_ways) */
+BlockLRU::BlockLRU(unsigned n_sets, unsigned n_ways) {
+  this->initialize(n_sets, n_ways);
 }
 
-/* Fill the number of queues specified by nsets into the data structure */
-void BlockLRU::initialize(unsigned n_sets) {
+/* Allocate the links of n_sets sets of n_ways blocks, all the lists are empty */
+void BlockLRU::initialize(unsigned n_sets, unsigned n_ways) {
   this->numSets = n_sets;
+  this->numWays = n_ways;
 
-  list<unsigned> l;
-  unordered_map<unsigned, list<unsigned>::iterator> ma;
-  for (unsigned i=0; i!=n_sets; ++i) {
-    this->lists.push_back(l);
-    this->maps.push_back(ma);
-  }
+  Link unlinked = {NIL, NIL};
+  this->links.assign((size_t)n_sets * n_ways, unlinked);
+  this->heads.assign(n_sets, NIL);
+  this->tails.assign(n_sets, NIL);
+}
+
+/* Detach a block from the list of set_id */
+void BlockLRU::unlink(unsigned set_id, unsigned block_id) {
+  Link &l = this->link(set_id, block_id);
+
+  if (l.prev == NIL)
+    this->heads[set_id] = l.next;
+  else
+    this->link(set_id, l.prev).next = l.next;
+
+  if (l.next == NIL)
+    this->tails[set_id] = l.prev;
+  else
+    this->link(set_id, l.next).prev = l.prev;
+
+  l.prev = l.next = NIL;
 }
 
 /* Pop the block number from the queue specified by set_id */
 unsigned BlockLRU::pop(unsigned set_id) {
-  if (this->lists[set_id].empty())
+  if (this->tails[set_id] == NIL)
     throw runtime_error("Try to pop from an empty queue (Code: 005).\n");
-  // Remove from list
-  unsigned ret = this->lists[set_id].back();
-  this->lists[set_id].pop_back();
-  // Remove from map
-  auto ret_it = this->maps[set_id].find(ret);
-  this->maps[set_id].erase(ret_it);
+  // Remove the least recently used block from the list
+  unsigned ret = this->tails[set_id];
+  this->unlink(set_id, ret);
 
   return ret;
 }
 
-/* Update the priority of the block in the queue specified by set_id */
-void BlockLRU::update(unsigned set_id, unsigned block_id) {
-  // Remove from list
-  auto it = this->maps[set_id][block_id];
-  this->lists[set_id].erase(it);
-  // Remove from map
-  auto map_it = this->maps[set_id].find(block_id);
-  this->maps[set_id].erase(map_it);
-  // Reinsert to the beginning of list, and add to map
-  this->lists[set_id].push_front(block_id);
-  this->maps[set_id].insert(make_pair(block_id, this->lists[set_id].begin()));
+/* Move a block (not the most recently used) to the beginning of the list of set_id (the rest of update) */
+void BlockLRU::promote(unsigned set_id, unsigned block_id) {
+  // Remove from list, and reinsert to the beginning of list
+  this->unlink(set_id, block_id);
+  this->push(set_id, block_id);
 }
 
-/* Push the block number to the queue specified by set id */
+/* Push the block number (which must not be in the list) to the queue specified by set id */
 void BlockLRU::push(unsigned set_id, unsigned block_id) {
-  // Push to list
-  this->lists[set_id].push_front(block_id);
-  this->maps[set_id].insert(make_pair(block_id, this->lists[set_id].begin()));
+  Link &l = this->link(set_id, block_id);
+  unsigned head = this->heads[set_id];
+
+  l.prev = NIL;
+  l.next = head;
+  if (head == NIL)
+    this->tails[set_id] = block_id;
+  else
+    this->link(set_id, head).prev = block_id;
+  this->heads[set_id] = block_id;
+}
+
+/* Empty all the lists */
+void BlockLRU::reset() {
+  this->initialize(this->numSets, this->numWays);
+}
+
+/* Write the lists to a checkpoint */
+void BlockLRU::save(CheckpointWriter &w) const {
+  w.put(this->links);
+  w.put(this->heads);
+  w.put(this->tails);
+}
+
+/* Read the lists back from a checkpoint */
+void BlockLRU::restore(CheckpointReader &r) {
+  r.get(this->links);
+  r.get(this->heads);
+  r.get(this->tails);
 }
 
 /* Show the runtime memory status of the data structure */
 void BlockLRU::show() {
-  unsigned ct = 0;
-
-  for (auto &set : this->lists) {
+  for (unsigned set_id=0; set_id!=this->numSets; ++set_id) {
 
-    cout << "Set " << ct++ << ": ";
+    cout << "Set " << set_id << ": ";
 
-    for (auto &block_id : set)
+    for (unsigned block_id=this->heads[set_id]; block_id!=NIL; block_id=this->link(set_id, block_id).next)
       cout << block_id << " ";
     cout << endl;
   }
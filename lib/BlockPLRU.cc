@@ -0,0 +1,95 @@
+/* ./lib/BlockPLRU.cc
+ * BlockPLRU is a data structure in the library
+ *  BlockPLRU is a vector of words holding one tree of bits per set,
+ *    node i of a tree (1 <= i < leaves) has children 2i and 2i+1, node leaves+b is block b,
+ *    a bit 0 (1) says the next victim is in the left (right) half below the node
+ * Cache with n sets of m blocks will have a BlockPLRU with n trees of m-1 bits (rounded up to a power of 2)
+ */
+
+#include "containers.hh"
+#include <iostream>
+
+/* Constructor: Initialize the BlockPLRU with the number of sets (n_sets) and blocks per set (n_ways) */
+BlockPLRU::BlockPLRU(unsigned n_sets, unsigned n_ways) {
+  this->initialize(n_sets, n_ways);
+}
+
+/* Allocate the trees, all bits are 0 (the victim is the leftmost block) */
+void BlockPLRU::initialize(unsigned n_sets, unsigned n_ways) {
+  this->numSets = n_sets;
+  this->numWays = n_ways;
+
+  this->leaves = 1;
+  this->topShift = 0;
+  while (this->leaves < n_ways) {
+    this->leaves *= 2;
+    this->topShift += this->leaves > 64;
+  }
+  this->wordsPerSet = (this->leaves + 63) / 64;
+
+  this->bits.assign((size_t)n_sets * this->wordsPerSet, 0);
+  this->mru.assign(n_sets, UINT32_MAX);
+
+  // Precompute the paths in the first word, from every node of level 6 (or every leaf of a smaller tree)
+  unsigned tops = this->leaves >> this->topShift;
+  this->pathMasks.assign(tops, 0);
+  this->pathBits.assign(tops, 0);
+  for (unsigned top=0; top!=tops; ++top)
+    for (unsigned node = tops + top; node > 1; node /= 2) {
+      this->pathMasks[top] |= 1ull << (node/2);
+      this->pathBits[top] |= (uint64_t)(node % 2 == 0) << (node/2);
+    }
+}
+
+/* Point every node on the path of the block to the other half */
+void BlockPLRU::update(unsigned set_id, unsigned block_id) {
+  // The path already points away from the last block updated
+  if (this->mru[set_id] == block_id)
+    return;
+  this->mru[set_id] = block_id;
+
+  // The levels below the first word, one bit each
+  for (unsigned node = this->leaves + block_id; node >= 128; node /= 2)
+    this->setBit(set_id, node/2, node % 2 == 0);
+
+  // The top levels, in the first word
+  uint64_t &word = this->bits[(size_t)set_id * this->wordsPerSet];
+  unsigned top = block_id >> this->topShift;
+  word = (word & ~this->pathMasks[top]) | this->pathBits[top];
+}
+
+/* Follow the bits from the root to a leaf,
+ * the right half is skipped when it only holds blocks past numWays (numWays is not a power of 2)
+ */
+unsigned BlockPLRU::victim(unsigned set_id) const {
+  unsigned node = 1, first = 0, span = this->leaves;
+
+  while (node < this->leaves) {
+    span /= 2;
+    bool right = this->getBit(set_id, node) && first + span < this->numWays;
+    node = 2*node + right;
+    first += right ? span : 0;
+  }
+
+  return first;
+}
+
+/* Clear all the bits */
+void BlockPLRU::reset() {
+  for (auto &word : this->bits)
+    word = 0;
+  for (auto &block_id : this->mru)
+    block_id = UINT32_MAX;
+}
+
+/* Write the bits of the trees to a checkpoint (and the most recently used blocks) */
+void BlockPLRU::save(CheckpointWriter &w) const {
+  w.put(this->bits);
+  w.put(this->mru);
+}
+
+/* Read the bits of the trees back from a checkpoint */
+void BlockPLRU::restore(CheckpointReader &r) {
+  r.get(this->bits);
+  r.get(this->mru);
+}
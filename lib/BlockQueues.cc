@@ -47,6 +47,47 @@ void BlockQueues::push(unsigned set_id, unsigned block_id) {
   this->queues[set_id].push_front(block_id);
 }
 
+/* Remove the block number from the queue specified by set id */
+void BlockQueues::remove(unsigned set_id, unsigned block_id) {
+  deque<unsigned> &q = this->queues[set_id];
+  for (auto it = q.begin(); it != q.end(); ++it)
+    if (*it == block_id) {
+      q.erase(it);
+      return;
+    }
+}
+
+/* Empty all the queues */
+void BlockQueues::reset() {
+  for (auto &q : this->queues)
+    q.clear();
+}
+
+/* Write the queues to a checkpoint (the size of each, and its blocks from the oldest) */
+void BlockQueues::save(CheckpointWriter &w) const {
+  w.put(this->numSets);
+  for (auto &q : this->queues) {
+    w.put((uint64_t)q.size());
+    for (auto block_id : q)
+      w.put(block_id);
+  }
+}
+
+/* Read the queues back from a checkpoint */
+void BlockQueues::restore(CheckpointReader &r) {
+  unsigned n_sets;
+  r.get(n_sets);
+  if (n_sets != this->numSets)
+    CheckpointReader::mismatch();
+  for (auto &q : this->queues) {
+    uint64_t size;
+    r.get(size);
+    q.resize(size);
+    for (auto &block_id : q)
+      r.get(block_id);
+  }
+}
+
 /* Show the runtime memory status of the data structure */
 void BlockQueues::show() {
   unsigned ct = 0;
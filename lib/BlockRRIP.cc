@@ -0,0 +1,82 @@
+/* ./lib/BlockRRIP.cc
+ * BlockRRIP is a data structure in the library
+ *  BlockRRIP is a vector of words holding the 2-bit RRPVs of the blocks, set by set,
+ *    32 blocks per word, so a set is searched (and aged) a word at a time
+ * Cache with n sets of m blocks will have a BlockRRIP with n*ceil(m/32) words
+ */
+
+#include "containers.hh"
+#include <iostream>
+
+/* The low bit of every 2-bit lane */
+#define LANE_LOW 0x5555555555555555ull
+
+/* Allocate the RRPVs of n_sets sets of n_ways blocks, all RRPVs are 0 */
+void BlockRRIP::initialize(unsigned n_sets, unsigned n_ways, unsigned max_rrpv) {
+  this->numSets = n_sets;
+  this->numWays = n_ways;
+  this->maxRRPV = max_rrpv;
+  this->wordsPerSet = (n_ways + 31) / 32;
+
+  // The lanes of the blocks in the last word of a set
+  unsigned last = n_ways - (this->wordsPerSet - 1) * 32;
+  this->lastMask = last == 32 ? ~0ull : (1ull << (2*last)) - 1;
+
+  this->lanes.assign((size_t)n_sets * this->wordsPerSet, 0);
+}
+
+/* The first block of the set whose RRPV is value, numWays if none */
+unsigned BlockRRIP::findValue(unsigned set_id, unsigned value) const {
+  const uint64_t *words = this->lanes.data() + (size_t)set_id * this->wordsPerSet;
+  const uint64_t pattern = LANE_LOW * value;
+
+  for (unsigned w=0; w!=this->wordsPerSet; ++w) {
+    // A lane equals value iff both of its bits are 0 after the xor
+    uint64_t diff = words[w] ^ pattern;
+    uint64_t match = ~(diff | diff >> 1) & LANE_LOW;
+    if (w == this->wordsPerSet - 1)
+      match &= this->lastMask;
+    if (match)
+      return w*32 + __builtin_ctzll(match)/2;
+  }
+
+  return this->numWays;
+}
+
+/* The first distant block, after aging the set just enough to have one */
+unsigned BlockRRIP::victim(unsigned set_id) {
+  unsigned block_id = this->findValue(set_id, this->maxRRPV);
+  if (block_id != this->numWays)
+    return block_id;
+
+  // Find the largest RRPV of the set, and age every block by the distance to maxRRPV
+  unsigned largest = this->maxRRPV;
+  do {
+    --largest;
+    block_id = this->findValue(set_id, largest);
+  } while (block_id == this->numWays);
+
+  uint64_t *words = this->lanes.data() + (size_t)set_id * this->wordsPerSet;
+  const uint64_t age = LANE_LOW * (this->maxRRPV - largest);
+  for (unsigned w=0; w!=this->wordsPerSet; ++w)
+    // No lane carries, all of them are at most largest
+    words[w] += age & (w == this->wordsPerSet - 1 ? this->lastMask : ~0ull);
+
+  return block_id;
+}
+
+/* Set all the RRPVs to 0 */
+void BlockRRIP::reset() {
+  for (auto &word : this->lanes)
+    word = 0;
+}
+
+/* Write the RRPVs to a checkpoint */
+void BlockRRIP::save(CheckpointWriter &w) const {
+  w.put(this->lanes);
+}
+
+/* Read the RRPVs back from a checkpoint */
+void BlockRRIP::restore(CheckpointReader &r) {
+  r.get(this->lanes);
+}
@@ -0,0 +1,79 @@
+/* ./lib/Checkpoint.cc
+ * CheckpointWriter and CheckpointReader are data structures in the library
+ *  They write and read the state of a simulation (the components put and get their own state in order),
+ *  through the buffered stdio of the host, so a checkpoint is written and read at the speed of the disk.
+ */
+
+#include "containers.hh"
+#include <stdexcept>
+#include <cstring>
+
+/* Constructor: create the file, and write the magic and the version */
+CheckpointWriter::CheckpointWriter(const string &path) {
+  this->path = path;
+  this->file = fopen(path.c_str(), "wb");
+  if (!this->file)
+    throw runtime_error("Cannot create the checkpoint " + path + " (Code: 010).");
+  this->write(CHECKPOINT_MAGIC, 8);
+  this->put((uint32_t)CHECKPOINT_VERSION);
+}
+
+/* Destructor: close the file (an error is not reported, close() first to see it) */
+CheckpointWriter::~CheckpointWriter() {
+  if (this->file)
+    fclose(this->file);
+}
+
+/* Write bytes */
+void CheckpointWriter::write(const void *bytes, size_t n) {
+  if (n != 0 && fwrite(bytes, 1, n, this->file) != n)
+    throw runtime_error("Cannot write the checkpoint " + this->path + " (Code: 010).");
+}
+
+/* Flush and close the file */
+void CheckpointWriter::close() {
+  if (!this->file)
+    return;
+  int status = fclose(this->file);
+  this->file = nullptr;
+  if (status != 0)
+    throw runtime_error("Cannot write the checkpoint " + this->path + " (Code: 010).");
+}
+
+/* Constructor: open the file, and check the magic and the version */
+CheckpointReader::CheckpointReader(const string &path) {
+  this->path = path;
+  this->file = fopen(path.c_str(), "rb");
+  if (!this->file)
+    throw runtime_error("Cannot open the checkpoint " + path + " (Code: 010).");
+  char magic[8];
+  uint32_t version;
+  this->read(magic, sizeof(magic));
+  this->get(version);
+  if (memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || version != CHECKPOINT_VERSION)
+    throw runtime_error("Not a checkpoint, or a checkpoint of another version: " + path + " (Code: 010).");
+}
+
+/* Destructor: close the file */
+CheckpointReader::~CheckpointReader() {
+  fclose(this->file);
+}
+
+/* Read a string */
+void CheckpointReader::get(string &text) {
+  uint64_t size;
+  this->get(size);
+  text.resize(size);
+  this->read(&text[0], size);
+}
+
+/* Read bytes, the checkpoint must hold them */
+void CheckpointReader::read(void *bytes, size_t n) {
+  if (n != 0 && fread(bytes, 1, n, this->file) != n)
+    throw runtime_error("The checkpoint " + this->path + " is cut short (Code: 010).");
+}
+
+/* A component read a state that does not fit it */
+void CheckpointReader::mismatch() {
+  throw runtime_error("The checkpoint was taken on another simulation (Code: 010).");
+}
@@ -0,0 +1,341 @@
+/* ./lib/ExternalTrace.cc
+ * ExternalTrace is a data structure in the library
+ *  ExternalTrace reads the traces of other tools (Dinero, lackey, ChampSim) on a thread of its own:
+ *    the file (or the pipe of gzip, xz or zstd) is read in blocks, parsed into batches of records,
+ *    and the batches are handed to the simulation through a bounded ring, so the reader stays at most
+ *    TRACE_RING_BATCHES batches ahead, and the decompression and the parsing overlap with the simulation
+ */
+
+#include "containers.hh"
+#include <stdexcept>
+#include <cstring>
+
+/* Thrown in the reader when the trace is closed before its end */
+namespace { struct ReaderStopped {}; }
+
+/* Quote a path for the shell */
+static string quote(const string &path) {
+  string quoted = "'";
+  for (char c : path)
+    if (c == '\'')
+      quoted += "'\\''";
+    else
+      quoted += c;
+  return quoted + "'";
+}
+
+/* Constructor: open the file, through its decompressor if it is compressed, and start the reader */
+ExternalTrace::ExternalTrace(const string &path, TraceFormat fmt) {
+  this->format = fmt;
+  this->file = fopen(path.c_str(), "rb");
+  if (!this->file)
+    throw runtime_error("Cannot open the trace " + path + " (Code: 009).");
+
+  // Recognize the compression by the magic bytes
+  unsigned char magic[6] = {0};
+  size_t n = fread(magic, 1, sizeof(magic), this->file);
+  const char *tool = nullptr;
+  if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    tool = "gzip";
+  else if (n >= 6 && memcmp(magic, "\xfd" "7zXZ\0", 6) == 0)
+    tool = "xz";
+  else if (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+    tool = "zstd";
+
+  if (tool) {
+    fclose(this->file);
+    string command = string(tool) + " -dc < " + quote(path);
+    this->file = popen(command.c_str(), "r");
+    if (!this->file)
+      throw runtime_error("Cannot run " + string(tool) + " on the trace " + path + " (Code: 009).");
+    this->pipe = true;
+  } else
+    rewind(this->file);
+
+  this->block.resize(TRACE_READ_BLOCK);
+  for (auto &b : this->batches)
+    b.reserve(TRACE_BATCH);
+  this->batch = &this->batches[0];
+  this->reader = thread(&ExternalTrace::read, this);
+}
+
+/* Destructor: stop the reader (it may wait for room in the ring), and close the file */
+ExternalTrace::~ExternalTrace() {
+  {
+    lock_guard<mutex> guard(this->lock);
+    this->stopping = true;
+  }
+  this->room.notify_all();
+  this->reader.join();
+  if (this->file) {
+    if (this->pipe)
+      pclose(this->file);
+    else
+      fclose(this->file);
+  }
+}
+
+/* The format named by the extension of the path (after the extension of the compression) */
+TraceFormat ExternalTrace::formatOf(const string &path) {
+  string name = path;
+  for (const char *compressed : {".gz", ".xz", ".zst", ".zstd"}) {
+    size_t length = strlen(compressed);
+    if (name.size() > length && name.compare(name.size() - length, length, compressed) == 0) {
+      name.resize(name.size() - length);
+      break;
+    }
+  }
+  size_t dot = name.rfind('.');
+  string extension = dot == string::npos ? "" : name.substr(dot + 1);
+  if (extension == "din")
+    return TRACE_DINERO;
+  if (extension == "lackey")
+    return TRACE_LACKEY;
+  if (extension == "champsim" || extension == "champsimtrace")
+    return TRACE_CHAMPSIM;
+  return TRACE_NATIVE;
+}
+
+/* The format of a name given on the command line */
+TraceFormat ExternalTrace::formatNamed(const string &name) {
+  if (name == "native")
+    return TRACE_NATIVE;
+  if (name == "din")
+    return TRACE_DINERO;
+  if (name == "lackey")
+    return TRACE_LACKEY;
+  if (name == "champsim")
+    return TRACE_CHAMPSIM;
+  throw runtime_error("Unknown trace format " + name + " (Code: 009).");
+}
+
+/* The next batch of records, nullptr after the last one */
+const vector<TraceRecord> *ExternalTrace::acquire() {
+  unique_lock<mutex> guard(this->lock);
+  this->ready.wait(guard, [this] { return this->filled != 0 || this->done; });
+  if (this->filled != 0)
+    return &this->batches[this->head];
+  if (this->error)
+    rethrow_exception(this->error);
+  return nullptr;
+}
+
+/* Hand the batch returned by acquire() back to the reader */
+void ExternalTrace::release() {
+  {
+    lock_guard<mutex> guard(this->lock);
+    this->head = (this->head + 1) % TRACE_RING_BATCHES;
+    --this->filled;
+  }
+  this->room.notify_one();
+}
+
+/* The reader thread: parse the whole trace, then mark the end (and the error, if any) */
+void ExternalTrace::read() {
+  try {
+    if (this->format == TRACE_DINERO)
+      this->parseDinero();
+    else if (this->format == TRACE_LACKEY)
+      this->parseLackey();
+    else if (this->format == TRACE_CHAMPSIM)
+      this->parseChampSim();
+    else
+      throw runtime_error("Not an external trace format (Code: 009).");
+    // The last instruction, and the last batch
+    if (this->pending)
+      this->emit(1, TRACE_COMPUTE);
+    if (!this->batch->empty())
+      this->publish();
+    if (this->pipe) {
+      int status = pclose(this->file);
+      this->file = nullptr;
+      if (status != 0)
+        throw runtime_error("The decompression of the trace failed (Code: 009).");
+    }
+  } catch (ReaderStopped &) {
+  } catch (...) {
+    this->error = current_exception();
+  }
+  {
+    lock_guard<mutex> guard(this->lock);
+    this->done = true;
+  }
+  this->ready.notify_all();
+}
+
+/* Move the batch being filled to the ring, and wait for room for the next one */
+void ExternalTrace::publish() {
+  unique_lock<mutex> guard(this->lock);
+  ++this->filled;
+  this->tail = (this->tail + 1) % TRACE_RING_BATCHES;
+  this->ready.notify_one();
+  this->room.wait(guard, [this] { return this->filled != TRACE_RING_BATCHES || this->stopping; });
+  if (this->stopping)
+    throw ReaderStopped();
+  this->batch = &this->batches[this->tail];
+  this->batch->clear();
+}
+
+/* Append a record to the batch (the instruction counts are merged) */
+void ExternalTrace::emit(uint64_t value, TraceOp op) {
+  if (op == TRACE_COMPUTE && !this->batch->empty() && this->batch->back().op == TRACE_COMPUTE) {
+    this->batch->back().value += value;
+    return;
+  }
+  TraceRecord record = {value, op};
+  this->batch->push_back(record);
+  if (this->batch->size() == TRACE_BATCH)
+    this->publish();
+}
+
+/* An instruction, counted when the next one starts without an access of its own */
+void ExternalTrace::instruction() {
+  if (this->pending)
+    this->emit(1, TRACE_COMPUTE);
+  this->pending = true;
+}
+
+/* Read the next block of the file after the bytes not parsed yet, false at the end of the file */
+bool ExternalTrace::fill() {
+  if (this->position != 0) {
+    memmove(this->block.data(), this->block.data() + this->position, this->end - this->position);
+    this->end -= this->position;
+    this->position = 0;
+  }
+  if (this->end == this->block.size())
+    throw runtime_error("Line too long in the trace (Code: 009).");
+  size_t n = fread(this->block.data() + this->end, 1, this->block.size() - this->end, this->file);
+  this->end += n;
+  return n != 0;
+}
+
+/* The next line [first, last) of a text trace, false at the end of the file */
+bool ExternalTrace::nextLine(const char *&first, const char *&last) {
+  while (true) {
+    const char *start = this->block.data() + this->position;
+    const char *newline = static_cast<const char *>(memchr(start, '\n', this->end - this->position));
+    if (newline) {
+      first = start;
+      last = newline;
+      this->position = newline + 1 - this->block.data();
+      ++this->line;
+      return true;
+    }
+    if (!this->fill()) {
+      // The last line, without a newline
+      if (this->position == this->end)
+        return false;
+      first = this->block.data() + this->position;
+      last = this->block.data() + this->end;
+      this->position = this->end;
+      ++this->line;
+      return true;
+    }
+  }
+}
+
+/* Skip the blanks of a line */
+static inline void skipBlanks(const char *&p, const char *last) {
+  while (p != last && (*p == ' ' || *p == '\t' || *p == '\r'))
+    ++p;
+}
+
+/* Read a hexadecimal number (with or without 0x), false if there is none */
+static inline bool readHex(const char *&p, const char *last, uint64_t &value) {
+  if (last - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    p += 2;
+  const char *start = p;
+  value = 0;
+  for (; p != last; ++p) {
+    unsigned digit;
+    if (*p >= '0' && *p <= '9')
+      digit = *p - '0';
+    else if (*p >= 'a' && *p <= 'f')
+      digit = *p - 'a' + 10;
+    else if (*p >= 'A' && *p <= 'F')
+      digit = *p - 'A' + 10;
+    else
+      break;
+    value = value << 4 | digit;
+  }
+  return p != start;
+}
+
+/* Dinero: "label address [...]" per line */
+void ExternalTrace::parseDinero() {
+  const char *p, *last;
+  while (this->nextLine(p, last)) {
+    skipBlanks(p, last);
+    if (p == last)
+      continue;
+    unsigned label = *p++ - '0';
+    uint64_t address;
+    skipBlanks(p, last);
+    if (label > 9 || !readHex(p, last, address))
+      throw runtime_error("Malformed Dinero line " + to_string(this->line) + " (Code: 009).");
+    if (label == 0 || label == 1) {
+      this->pending = false;
+      this->emit(address, label == 0 ? TRACE_READ : TRACE_WRITE);
+    } else if (label == 2)
+      this->instruction();
+    else if (label > 4)
+      throw runtime_error("Unknown Dinero label on line " + to_string(this->line) + " (Code: 009).");
+  }
+}
+
+/* lackey: "I  address,size", " L address,size", " S address,size", or " M address,size" per line */
+void ExternalTrace::parseLackey() {
+  const char *p, *last;
+  while (this->nextLine(p, last)) {
+    skipBlanks(p, last);
+    // The lines of valgrind itself
+    if (p == last || *p == '=')
+      continue;
+    char kind = *p++;
+    uint64_t address;
+    skipBlanks(p, last);
+    if (!readHex(p, last, address) || p == last || *p != ',')
+      throw runtime_error("Malformed lackey line " + to_string(this->line) + " (Code: 009).");
+    if (kind == 'I')
+      this->instruction();
+    else if (kind == 'L' || kind == 'S' || kind == 'M') {
+      this->pending = false;
+      if (kind != 'S')
+        this->emit(address, TRACE_READ);
+      if (kind != 'L')
+        this->emit(address, TRACE_WRITE);
+    } else
+      throw runtime_error("Unknown lackey reference on line " + to_string(this->line) + " (Code: 009).");
+  }
+}
+
+/* ChampSim: input_instr records, the ip, the branch and register bytes, 2 destination and 4 source memory operands */
+void ExternalTrace::parseChampSim() {
+  const size_t RECORD = 64, OPERANDS = 16;
+  while (true) {
+    if (this->end - this->position < RECORD && !this->fill()) {
+      if (this->position != this->end)
+        throw runtime_error("Truncated ChampSim record at the end of the trace (Code: 009).");
+      return;
+    }
+    if (this->end - this->position < RECORD)
+      continue;
+    const char *record = this->block.data() + this->position;
+    this->position += RECORD;
+
+    this->instruction();
+    uint64_t operands[6];
+    memcpy(operands, record + OPERANDS, sizeof(operands));
+    // The sources are read before the destinations are written
+    for (unsigned i=2; i!=6; ++i)
+      if (operands[i]) {
+        this->pending = false;
+        this->emit(operands[i], TRACE_READ);
+      }
+    for (unsigned i=0; i!=2; ++i)
+      if (operands[i]) {
+        this->pending = false;
+        this->emit(operands[i], TRACE_WRITE);
+      }
+  }
+}
@@ -0,0 +1,138 @@
+/* ./lib/MissClassifier.cc
+ * MissClassifier is a data structure in the library
+ *  MissClassifier tells the class of every miss of a cache (compulsory, capacity, conflict):
+ *    a bitmap of the blocks touched finds the first touches, and a fully associative LRU shadow of the same size
+ *    (a hash table of the blocks, threaded by a list in the order of use) finds the misses of capacity,
+ *    every access costs a few probes of the table and a few links, whatever the size of the cache
+ */
+
+#include "containers.hh"
+#include <algorithm>
+
+const uint64_t MissClassifier::EMPTY;
+const unsigned MissClassifier::NIL;
+
+/* Constructor: Initialize with the number of blocks of the cache */
+MissClassifier::MissClassifier(unsigned n_blocks) {
+  this->initialize(n_blocks);
+}
+
+/* Allocate the shadow (its table at least twice as large, so the probes stay short), empty */
+void MissClassifier::initialize(unsigned n_blocks) {
+  size_t size = 1;
+  while (size < 2 * (size_t)n_blocks)
+    size *= 2;
+  Entry free = {EMPTY, NIL, NIL};
+  this->table.assign(size, free);
+  this->mask = size - 1;
+  this->head = this->tail = NIL;
+  this->numBlocks = n_blocks;
+  this->used = 0;
+  this->dense.clear();
+  this->sparse.clear();
+}
+
+/* Mark a block touched, true if it was not yet */
+bool MissClassifier::touch(uint64_t block) {
+  if (block >= CLASSIFY_DENSE_BLOCKS)
+    return this->sparse.insert(block).second;
+  size_t word = block >> 6;
+  if (word >= this->dense.size())
+    this->dense.resize(max(word + 1, 2 * this->dense.size()), 0);
+  uint64_t bit = 1ull << (block & 63);
+  bool first = !(this->dense[word] & bit);
+  this->dense[word] |= bit;
+  return first;
+}
+
+/* The entry of a block in the shadow, NIL if it is not in it */
+unsigned MissClassifier::find(uint64_t block) const {
+  for (size_t i=this->home(block); ; i=(i+1) & this->mask) {
+    if (this->table[i].block == block)
+      return i;
+    if (this->table[i].block == EMPTY)
+      return NIL;
+  }
+}
+
+/* Detach an entry from the list */
+void MissClassifier::unlink(unsigned i) {
+  Entry &e = this->table[i];
+  if (e.prev == NIL)
+    this->head = e.next;
+  else
+    this->table[e.prev].next = e.next;
+  if (e.next == NIL)
+    this->tail = e.prev;
+  else
+    this->table[e.next].prev = e.prev;
+}
+
+/* Attach an entry (not in the list) at the head of the list */
+void MissClassifier::push(unsigned i) {
+  Entry &e = this->table[i];
+  e.prev = NIL;
+  e.next = this->head;
+  if (this->head == NIL)
+    this->tail = i;
+  else
+    this->table[this->head].prev = i;
+  this->head = i;
+}
+
+/* Erase an entry (unlinked already), the entries after it move back into the hole when their home allows it,
+ * and their neighbours in the list follow them */
+void MissClassifier::erase(unsigned i) {
+  size_t hole = i;
+  for (size_t j=(hole+1) & this->mask; this->table[j].block != EMPTY; j=(j+1) & this->mask)
+    if (((j - this->home(this->table[j].block)) & this->mask) >= ((j - hole) & this->mask)) {
+      Entry &e = this->table[hole];
+      e = this->table[j];
+      if (e.prev == NIL)
+        this->head = hole;
+      else
+        this->table[e.prev].next = hole;
+      if (e.next == NIL)
+        this->tail = hole;
+      else
+        this->table[e.next].prev = hole;
+      hole = j;
+    }
+  this->table[hole].block = EMPTY;
+}
+
+/* Classify an access (not to the most recent block): look it up in the shadow, a hit moves it to the head
+ * (it was touched already), a miss marks it touched and fills it in the shadow (the least recently used block leaves a full one) */
+MissKind MissClassifier::update(uint64_t block, bool fill) {
+  unsigned i = this->find(block);
+  if (i != NIL) {
+    this->unlink(i);
+    this->push(i);
+    return MISS_CONFLICT;
+  }
+  bool first = this->touch(block);
+  if (fill && this->numBlocks != 0) {
+    if (this->used == this->numBlocks) {
+      unsigned victim = this->tail;
+      this->unlink(victim);
+      this->erase(victim);
+    } else
+      ++this->used;
+    size_t j = this->home(block);
+    while (this->table[j].block != EMPTY)
+      j = (j + 1) & this->mask;
+    this->table[j].block = block;
+    this->push(j);
+  }
+  return first ? MISS_COMPULSORY : MISS_CAPACITY;
+}
+
+/* Empty the shadow, and forget the blocks touched */
+void MissClassifier::reset() {
+  Entry free = {EMPTY, NIL, NIL};
+  this->table.assign(this->table.size(), free);
+  this->head = this->tail = NIL;
+  this->used = 0;
+  this->dense.assign(this->dense.size(), 0);
+  this->sparse.clear();
+}
@@ -0,0 +1,102 @@
+/* ./lib/NextUse.cc
+ * NextUse is a data structure in the library
+ *  NextUse is a stream of block numbers in a temporary file, turned into a stream of next-use distances
+ *    (in a second temporary file) by a backward pass, one chunk at a time
+ * A run of n accesses uses 12n bytes of disk, and two chunks (NEXTUSE_CHUNK accesses) of memory,
+ *  plus a table of the last use of every block (the footprint of the run)
+ */
+
+#include "containers.hh"
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+/* The number of accesses in a chunk */
+#define NEXTUSE_CHUNK (1u<<20)
+/* The last uses are kept in a flat table (rather than a hash map) below this many blocks */
+#define NEXTUSE_DENSE_BLOCKS (1ull<<24)
+
+const uint64_t NextUse::NEVER;
+const uint32_t NextUse::NEVER_DISTANCE;
+
+/* Constructor: open the temporary files */
+NextUse::NextUse() {
+  this->blocks = tmpfile();
+  this->distances = tmpfile();
+  if (!this->blocks || !this->distances)
+    throw runtime_error("Cannot create the temporary files of the next uses (Code: 006).");
+  this->blockBuffer.reserve(NEXTUSE_CHUNK);
+}
+
+/* Destructor: the temporary files are removed when closed */
+NextUse::~NextUse() {
+  if (this->blocks)
+    fclose(this->blocks);
+  if (this->distances)
+    fclose(this->distances);
+}
+
+/* Write the chunk of blocks in memory to the file */
+void NextUse::flushBlocks() {
+  size_t n = this->blockBuffer.size();
+  if (fwrite(this->blockBuffer.data(), sizeof(uint64_t), n, this->blocks) != n)
+    throw runtime_error("Cannot write the block stream (Code: 006).");
+  this->count += n;
+  this->blockBuffer.clear();
+}
+
+/* Read the next chunk of distances, returns false at the end of the stream */
+bool NextUse::readDistances() {
+  this->distanceBuffer.resize(NEXTUSE_CHUNK);
+  size_t n = fread(this->distanceBuffer.data(), sizeof(uint32_t), NEXTUSE_CHUNK, this->distances);
+  this->distanceBuffer.resize(n);
+  this->cursor = 0;
+  return n != 0;
+}
+
+/* Compute the distance from every access to the next use of its block, from the last chunk to the first */
+void NextUse::finish() {
+  this->flushBlocks();
+  vector<uint64_t>().swap(this->blockBuffer);
+
+  // The time of the last use seen (going backward) of every block
+  bool dense = this->maxBlock < NEXTUSE_DENSE_BLOCKS;
+  vector<uint64_t> lastDense(dense ? this->maxBlock + 1 : 0, NEVER);
+  unordered_map<uint64_t, uint64_t> lastSparse;
+
+  vector<uint64_t> chunk(NEXTUSE_CHUNK);
+  vector<uint32_t> result(NEXTUSE_CHUNK);
+  uint64_t chunks = (this->count + NEXTUSE_CHUNK - 1) / NEXTUSE_CHUNK;
+
+  for (uint64_t k = chunks; k-- > 0; ) {
+    uint64_t start = k * NEXTUSE_CHUNK;
+    size_t n = this->count - start < NEXTUSE_CHUNK ? this->count - start : NEXTUSE_CHUNK;
+
+    fseek(this->blocks, start * sizeof(uint64_t), SEEK_SET);
+    if (fread(chunk.data(), sizeof(uint64_t), n, this->blocks) != n)
+      throw runtime_error("Cannot read the block stream (Code: 006).");
+
+    for (size_t j = n; j-- > 0; ) {
+      uint64_t now = start + j;
+      uint64_t &last = dense ? lastDense[chunk[j]] : lastSparse.emplace(chunk[j], NEVER).first->second;
+      uint64_t distance = last == NEVER ? NEVER_DISTANCE : last - now;
+      result[j] = distance < NEVER_DISTANCE ? distance : NEVER_DISTANCE;
+      last = now;
+    }
+
+    fseek(this->distances, start * sizeof(uint32_t), SEEK_SET);
+    if (fwrite(result.data(), sizeof(uint32_t), n, this->distances) != n)
+      throw runtime_error("Cannot write the next uses (Code: 006).");
+  }
+
+  // The block stream is not needed anymore
+  fclose(this->blocks);
+  this->blocks = nullptr;
+
+  // Rewind for the replay
+  fflush(this->distances);
+  rewind(this->distances);
+  this->time = 0;
+  this->cursor = 0;
+  this->distanceBuffer.clear();
+}
@@ -0,0 +1,223 @@
+/* ./lib/Prefetcher.cc
+ * Prefetcher is a data structure in the library
+ *  The prefetchers of a cache (next-line, stride, stream buffers, delta correlation) see the addresses of the demand accesses,
+ *    and append the blocks to prefetch to their candidates; the cache drops the ones it holds already, fills the others
+ *    (or counts them as fetched into a stream buffer), and measures how useful they were
+ */
+
+#include "containers.hh"
+#include <stdexcept>
+
+/* The block (or address) at a delta from another one, false if it would be below 0 */
+static inline bool offset(uint64_t block, int64_t delta, uint64_t &next) {
+  if (delta < 0 && (uint64_t)-delta > block)
+    return false;
+  next = block + delta;
+  return true;
+}
+
+/* Constructor: the degree, and the offset bits of a block */
+Prefetcher::Prefetcher(unsigned deg, unsigned block_size) {
+  this->degree = deg;
+  while ((1u << this->shift) < block_size)
+    ++this->shift;
+}
+
+/* The prefetcher of a name given to -F */
+PrefetchKind Prefetcher::kindNamed(const string &name) {
+  if (name == "nextline")
+    return PREFETCH_NEXT_LINE;
+  if (name == "stride")
+    return PREFETCH_STRIDE;
+  if (name == "stream")
+    return PREFETCH_STREAM;
+  if (name == "delta")
+    return PREFETCH_DELTA;
+  throw runtime_error("Unknown prefetcher " + name + ", use nextline, stride, stream, or delta (Code: 011).");
+}
+
+/* A prefetcher of a kind (none for PREFETCH_NONE) */
+unique_ptr<Prefetcher> Prefetcher::create(PrefetchKind kind, unsigned deg, unsigned block_size) {
+  if (deg == 0)
+    throw runtime_error("A prefetcher fetches one block ahead at least (Code: 011).");
+  switch (kind) {
+    case PREFETCH_NEXT_LINE:
+      return unique_ptr<Prefetcher>(new NextLinePrefetcher(deg, block_size));
+    case PREFETCH_STRIDE:
+      return unique_ptr<Prefetcher>(new StridePrefetcher(deg, block_size));
+    case PREFETCH_STREAM:
+      return unique_ptr<Prefetcher>(new StreamBufferPrefetcher(deg, block_size));
+    case PREFETCH_DELTA:
+      return unique_ptr<Prefetcher>(new DeltaPrefetcher(deg, block_size));
+    default:
+      return nullptr;
+  }
+}
+
+/* Next-line: a miss, or the first hit on a prefetched block (tagged), prefetches the blocks after it */
+void NextLinePrefetcher::train(uint64_t address, bool miss, bool useful) {
+  if (!miss && !useful)
+    return;
+  uint64_t block = address >> this->shift;
+  for (unsigned k=1; k<=this->degree; ++k)
+    this->candidates.push_back(block + k);
+}
+
+/* Constructor: every stream of the table is empty (never used) */
+StridePrefetcher::StridePrefetcher(unsigned deg, unsigned block_size) : Prefetcher(deg, block_size) {
+  this->reset();
+}
+
+/* Empty every stream */
+void StridePrefetcher::reset() {
+  Prefetcher::reset();
+  Stream empty = {0, 0, 0, 0};
+  this->streams.assign(PREFETCH_TABLE, empty);
+}
+
+/* Stride: find the stream of the address (the one that predicted it, or the nearest one), or replace the least recently used one,
+ * then train its stride on the delta from its last address, and prefetch ahead of a confident stream when it moves to another block */
+void StridePrefetcher::train(uint64_t address, bool miss, bool useful) {
+  Stream *stream = nullptr, *nearest = nullptr, *oldest = &this->streams[0];
+  uint64_t distance = ((uint64_t)PREFETCH_REGION << this->shift) + 1;
+  for (auto &s : this->streams) {
+    if (s.used < oldest->used)
+      oldest = &s;
+    if (s.used == 0)
+      continue;
+    if (s.stride != 0 && s.last + s.stride == address) {
+      stream = &s;
+      break;
+    }
+    uint64_t d = s.last > address ? s.last - address : address - s.last;
+    if (d < distance) {
+      distance = d;
+      nearest = &s;
+    }
+  }
+  if (!stream)
+    stream = nearest;
+  if (!stream) {
+    Stream fresh = {address, 0, 0, this->clock};
+    *oldest = fresh;
+    return;
+  }
+  stream->used = this->clock;
+  if (address == stream->last)
+    return;
+
+  int64_t delta = (int64_t)(address - stream->last);
+  bool moved = address >> this->shift != stream->last >> this->shift;
+  stream->last = address;
+  if (delta == stream->stride) {
+    if (stream->confidence != 3)
+      ++stream->confidence;
+  } else if (stream->confidence != 0)
+    --stream->confidence;
+  else
+    stream->stride = delta;
+  if (stream->confidence < 2 || !moved)
+    return;
+  // A stride of a block or more is followed stride by stride, a shorter one block by block (in its direction)
+  int64_t size = (int64_t)1 << this->shift;
+  int64_t step = stream->stride <= -size || stream->stride >= size ? stream->stride : stream->stride < 0 ? -size : size;
+  uint64_t next = address;
+  for (unsigned k=0; k!=this->degree && offset(next, step, next); ++k)
+    this->candidates.push_back(next >> this->shift);
+}
+
+/* Constructor: every buffer is empty */
+StreamBufferPrefetcher::StreamBufferPrefetcher(unsigned deg, unsigned block_size) : Prefetcher(deg, block_size) {
+  this->reset();
+}
+
+/* Empty every buffer */
+void StreamBufferPrefetcher::reset() {
+  Prefetcher::reset();
+  this->buffers.assign(PREFETCH_STREAMS, Buffer());
+  for (auto &buffer : this->buffers)
+    buffer.used = 0;
+}
+
+/* Fetch a block at the tail of a buffer */
+void StreamBufferPrefetcher::fetch(Buffer &buffer, uint64_t block) {
+  buffer.blocks.push_back(make_pair(block, this->clock));
+  this->candidates.push_back(block);
+}
+
+/* Take a missed block from the buffer that holds it: the blocks before it are dropped (the stream skipped them),
+ * and the buffer fetches as many blocks after its tail */
+bool StreamBufferPrefetcher::supply(uint64_t block, uint64_t &issued) {
+  for (auto &buffer : this->buffers)
+    for (size_t i=0; i!=buffer.blocks.size(); ++i) {
+      if (buffer.blocks[i].first != block)
+        continue;
+      issued = buffer.blocks[i].second;
+      buffer.blocks.erase(buffer.blocks.begin(), buffer.blocks.begin() + i + 1);
+      buffer.used = this->clock;
+      while (buffer.blocks.size() != this->degree)
+        this->fetch(buffer, (buffer.blocks.empty() ? block : buffer.blocks.back().first) + 1);
+      return true;
+    }
+  return false;
+}
+
+/* A miss no buffer held starts a stream after it, in the least recently used buffer */
+void StreamBufferPrefetcher::train(uint64_t address, bool miss, bool useful) {
+  if (!miss)
+    return;
+  uint64_t block = address >> this->shift;
+  Buffer *oldest = &this->buffers[0];
+  for (auto &buffer : this->buffers)
+    if (buffer.used < oldest->used)
+      oldest = &buffer;
+  oldest->blocks.clear();
+  oldest->used = this->clock;
+  for (unsigned k=1; k<=this->degree; ++k)
+    this->fetch(*oldest, block + k);
+}
+
+/* Constructor: the history is empty */
+DeltaPrefetcher::DeltaPrefetcher(unsigned deg, unsigned block_size) : Prefetcher(deg, block_size) {
+  this->reset();
+}
+
+/* Empty the history */
+void DeltaPrefetcher::reset() {
+  Prefetcher::reset();
+  this->deltas.assign(PREFETCH_HISTORY, 0);
+  this->head = this->count = 0;
+  this->last = 0;
+  this->started = false;
+}
+
+/* Delta correlation: push the delta of the miss, find the last earlier occurrence of the last two deltas,
+ * and replay the deltas that followed it (the pattern between the two occurrences repeats) */
+void DeltaPrefetcher::train(uint64_t address, bool miss, bool useful) {
+  if (!miss && !useful)
+    return;
+  uint64_t block = address >> this->shift;
+  if (!this->started) {
+    this->started = true;
+    this->last = block;
+    return;
+  }
+  int64_t delta = (int64_t)(block - this->last);
+  this->last = block;
+  if (delta == 0)
+    return;
+  this->deltas[this->head] = delta;
+  this->head = (this->head + 1) % PREFETCH_HISTORY;
+  if (this->count != PREFETCH_HISTORY)
+    ++this->count;
+
+  // The delta i misses back (0 is the newest)
+  auto back = [this](unsigned i) { return this->deltas[(this->head + PREFETCH_HISTORY - 1 - i) % PREFETCH_HISTORY]; };
+  for (unsigned i=1; i+1 < this->count; ++i)
+    if (back(i) == back(0) && back(i+1) == back(1)) {
+      uint64_t next = block;
+      for (unsigned k=0; k!=this->degree && offset(next, back(i - 1 - k % i), next); ++k)
+        this->candidates.push_back(next);
+      return;
+    }
+}
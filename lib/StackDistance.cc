@@ -0,0 +1,220 @@
+/* ./lib/StackDistance.cc
+ * StackDistance is a data structure in the library
+ *  StackDistance keeps one LRU stack per set, for every power-of-two number of sets,
+ *    a stack is a Fenwick tree over the clock of its set, marking the time of the last use of each of its blocks
+ * A stack is cut at the largest associativity of its set count (a deeper block misses in every cache measured),
+ *  so the clocks of a set count have 2*maxBlocks times in all, and their trees stay in the host cache.
+ *  The stacks of few ways are lists: scanning up to STACK_LIST_WAYS ids beats walking a tree.
+ * With set counts 1 to 2^k, an access updates k+1 stacks in O(log maxBlocks) each,
+ *  and the histograms of the distances give the misses of every cache of up to maxBlocks blocks
+ */
+
+#include "containers.hh"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+/* The smallest clock of a set */
+#define STACK_MIN_CLOCK 16u
+/* Blocks are numbered through a flat table (rather than a hash map) below this block number */
+#define STACK_DENSE_BLOCKS (1ull<<24)
+
+const uint32_t StackDistance::NONE;
+
+/* Constructor: Initialize with the largest set count and the largest cache (in blocks) */
+StackDistance::StackDistance(unsigned max_sets, unsigned max_blocks) {
+  this->initialize(max_sets, max_blocks);
+}
+
+/* Allocate the stacks of the set counts 1, 2, 4, ..., max_sets (both rounded down to powers of two) */
+void StackDistance::initialize(unsigned max_sets, unsigned max_blocks) {
+  if (max_blocks == 0)
+    throw runtime_error("The largest cache has no block (Code: 007).");
+  this->maxBlocks = 1;
+  while (this->maxBlocks * 2 <= max_blocks)
+    this->maxBlocks *= 2;
+  this->numCounts = 1;
+  while ((2u << (this->numCounts - 1)) <= max_sets && (2u << (this->numCounts - 1)) <= this->maxBlocks)
+    ++this->numCounts;
+
+  // The clock of a set holds twice the largest associativity, so a compaction frees half of it at least,
+  // a list holds the largest associativity
+  size_t total = 0, listed = 0;
+  this->sizes.resize(this->numCounts);
+  this->bases.resize(this->numCounts);
+  for (unsigned e=0; e!=this->numCounts; ++e) {
+    unsigned ways = this->maxBlocks >> e;
+    if (ways <= STACK_LIST_WAYS) {
+      this->sizes[e] = ways;
+      this->bases[e] = listed;
+      listed += (size_t)ways << e;
+    } else {
+      this->sizes[e] = 2 * ways > STACK_MIN_CLOCK ? 2 * ways : STACK_MIN_CLOCK;
+      this->bases[e] = total;
+      total += (size_t)(this->sizes[e] + 1) << e;
+    }
+  }
+  this->trees.resize(total);
+  this->owners.resize(total);
+  this->lists.resize(listed);
+  this->clocks.resize((1u << this->numCounts) - 1);
+
+  this->stamps.clear();
+  this->denseIds.clear();
+  this->sparseIds.clear();
+  this->numIds = 0;
+  for (auto &histogram : this->histograms)
+    histogram.resize((size_t)this->numCounts * (this->maxBlocks + 1));
+  this->reset();
+}
+
+/* The id of a block (ids are given in the order of the first uses) */
+uint32_t StackDistance::idOf(uint64_t block) {
+  uint32_t *id;
+  if (block < STACK_DENSE_BLOCKS) {
+    if (block >= this->denseIds.size())
+      this->denseIds.resize(block + 1 > 2 * this->denseIds.size() ? block + 1 : 2 * this->denseIds.size(), NONE);
+    id = &this->denseIds[block];
+  } else
+    id = &this->sparseIds.emplace(block, NONE).first->second;
+
+  if (*id == NONE) {
+    // First use: the block has no stamp in any set count
+    *id = this->numIds++;
+    this->stamps.resize((size_t)this->numIds * this->numCounts, NONE);
+  }
+  return *id;
+}
+
+/* Measure an access to a block */
+void StackDistance::access(uint64_t block, bool write) {
+  uint32_t id = this->idOf(block);
+  uint32_t *stamp = &this->stamps[(size_t)id * this->numCounts];
+  uint64_t *histogram = this->histograms[write].data();
+  ++this->accesses[write];
+
+  for (unsigned e=0; e!=this->numCounts; ++e) {
+    unsigned set_id = block & ((1u << e) - 1);
+    unsigned ways = this->maxBlocks >> e;
+    uint32_t distance;
+
+    if (ways <= STACK_LIST_WAYS)
+      distance = this->reuseList(e, set_id, id);
+    else if (stamp[e] != NONE && stamp[e] + 1 == this->clocks[(1u << e) - 1 + set_id].time)
+      // Still the most recently used block of its set
+      distance = 0;
+    else
+      distance = this->reuse(e, set_id, stamp[e], id);
+
+    ++histogram[(size_t)e * (this->maxBlocks + 1) + (distance < ways ? distance : ways)];
+  }
+}
+
+/* Move a block to the top of the stack of a set, returns its distance (NONE on the first use, or below the bottom) */
+uint32_t StackDistance::reuse(unsigned e, unsigned set_id, uint32_t &stamp, uint32_t id) {
+  Clock &clock = this->clocks[(1u << e) - 1 + set_id];
+  const uint32_t size = this->sizes[e];
+  uint32_t *tree = &this->trees[this->bases[e] + (size_t)set_id * (size + 1)];
+  uint32_t *owner = &this->owners[this->bases[e] + (size_t)set_id * (size + 1)];
+  uint32_t distance = NONE;
+
+  if (stamp == NONE) {
+    // The stack holds as many blocks as the largest associativity of the set count, drop the bottom one
+    if (++clock.live > (this->maxBlocks >> e)) {
+      while (owner[clock.bottom] == NONE)
+        ++clock.bottom;
+      this->stamps[(size_t)owner[clock.bottom] * this->numCounts + e] = NONE;
+      owner[clock.bottom] = NONE;
+      for (uint32_t i=clock.bottom+1; i<=size; i+=i&-i)
+        --tree[i];
+      --clock.live;
+    }
+  } else {
+    // The blocks used after the last use are the marks after it
+    uint32_t before = 0;
+    for (uint32_t i=stamp+1; i; i&=i-1)
+      before += tree[i];
+    distance = clock.live - before;
+    for (uint32_t i=stamp+1; i<=size; i+=i&-i)
+      --tree[i];
+    owner[stamp] = NONE;
+  }
+
+  if (clock.time == size)
+    this->compact(e, clock, tree, owner);
+
+  stamp = clock.time++;
+  owner[stamp] = id;
+  for (uint32_t i=stamp+1; i<=size; i+=i&-i)
+    ++tree[i];
+
+  return distance;
+}
+
+/* Move a block to the front of the list of a set, returns its position (the size of the list if absent) */
+uint32_t StackDistance::reuseList(unsigned e, unsigned set_id, uint32_t id) {
+  const uint32_t ways = this->sizes[e];
+  uint32_t *list = &this->lists[this->bases[e] + (size_t)set_id * ways];
+
+  uint32_t distance = 0;
+  while (distance != ways && list[distance] != id)
+    ++distance;
+  // Shift the more recently used blocks (or all but the bottom one) down by one
+  for (uint32_t i=(distance == ways ? ways - 1 : distance); i; --i)
+    list[i] = list[i - 1];
+  list[0] = id;
+
+  return distance;
+}
+
+/* Renumber the marks of a full clock from 0 */
+void StackDistance::compact(unsigned e, Clock &clock, uint32_t *tree, uint32_t *owner) {
+  const uint32_t size = this->sizes[e];
+  uint32_t marked = 0;
+  for (uint32_t t=0; t!=clock.time; ++t)
+    if (owner[t] != NONE) {
+      this->stamps[(size_t)owner[t] * this->numCounts + e] = marked;
+      owner[marked++] = owner[t];
+    }
+  fill(owner + marked, owner + size, NONE);
+  clock.time = marked;
+  clock.bottom = 0;
+
+  // Build the tree of the marks 0 to marked-1 in linear time
+  fill(tree, tree + size + 1, 0);
+  for (uint32_t i=1; i<=marked; ++i)
+    tree[i] = 1;
+  for (uint32_t i=1; i<=size; ++i) {
+    uint32_t parent = i + (i & -i);
+    if (parent <= size)
+      tree[parent] += tree[i];
+  }
+}
+
+/* The misses of an LRU cache of n_sets sets (a power of two) of n_ways ways */
+uint64_t StackDistance::misses(unsigned n_sets, unsigned n_ways, bool write) const {
+  unsigned e = 0;
+  while ((1u << e) < n_sets)
+    ++e;
+  if ((1u << e) != n_sets || e >= this->numCounts || n_ways == 0 || n_ways > (this->maxBlocks >> e))
+    throw runtime_error("No stack distances for this cache (Code: 007).");
+
+  const uint64_t *histogram = this->histograms[write].data() + (size_t)e * (this->maxBlocks + 1);
+  uint64_t hits = 0;
+  for (unsigned distance=0; distance!=n_ways; ++distance)
+    hits += histogram[distance];
+  return this->accesses[write] - hits;
+}
+
+/* Empty the stacks (every block is used for the first time again), and clear the counters */
+void StackDistance::reset() {
+  Clock empty = {0, 0, 0};
+  fill(this->clocks.begin(), this->clocks.end(), empty);
+  fill(this->trees.begin(), this->trees.end(), 0);
+  fill(this->owners.begin(), this->owners.end(), NONE);
+  fill(this->lists.begin(), this->lists.end(), NONE);
+  fill(this->stamps.begin(), this->stamps.end(), NONE);
+  for (auto &histogram : this->histograms)
+    fill(histogram.begin(), histogram.end(), 0);
+  this->accesses[0] = this->accesses[1] = 0;
+}
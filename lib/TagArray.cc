@@ -0,0 +1,169 @@
+/* ./lib/TagArray.cc
+ * TagArray is a data structure in the library
+ *  TagArray is a single vector of tags, laid out set by set,
+ *    each set is a row padded to the host cache line, so probing a set touches one line
+ *    for associativities up to HOST_LINE_SIZE/sizeof(Tag)
+ * Cache with n sets and m ways will have one TagArray with n rows
+ *
+ * The row is searched by a tag comparison kernel, chosen at runtime:
+ *  AVX-512 (8 ways per compare), AVX2 (4 ways), SSE2 (2 ways), or a scalar loop.
+ *  The vector kernels compare whole chunks of the row, the padding holds INVALID_TAG,
+ *  so they may report a padding way only when searching for INVALID_TAG (find() clamps it).
+ */
+
+#include "containers.hh"
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TAG_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* Scalar kernel: linear search */
+static unsigned findScalar(const Tag *row, unsigned n, Tag tag) {
+  for (unsigned way=0; way!=n; ++way)
+    if (row[way] == tag)
+      return way;
+  return n;
+}
+
+#ifdef TAG_SIMD
+/* SSE2 kernel: 2 ways per compare (SSE2 compares 32-bit lanes, a way matches when both of its halves do) */
+static unsigned findSSE2(const Tag *row, unsigned n, Tag tag) {
+  const __m128i key = _mm_set1_epi64x(static_cast<long long>(tag));
+  for (unsigned way=0; way<n; way+=2) {
+    __m128i chunk = _mm_load_si128(reinterpret_cast<const __m128i *>(row + way));
+    __m128i halves = _mm_cmpeq_epi32(chunk, key);
+    __m128i both = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+    int mask = _mm_movemask_pd(_mm_castsi128_pd(both));
+    if (mask)
+      return way + __builtin_ctz(mask);
+  }
+  return n;
+}
+
+/* AVX2 kernel: 4 ways per compare */
+__attribute__((target("avx2")))
+static unsigned findAVX2(const Tag *row, unsigned n, Tag tag) {
+  const __m256i key = _mm256_set1_epi64x(static_cast<long long>(tag));
+  for (unsigned way=0; way<n; way+=4) {
+    __m256i chunk = _mm256_load_si256(reinterpret_cast<const __m256i *>(row + way));
+    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(chunk, key)));
+    if (mask)
+      return way + __builtin_ctz(mask);
+  }
+  return n;
+}
+
+/* AVX-512 kernel: 8 ways (one host line) per compare */
+__attribute__((target("avx512f")))
+static unsigned findAVX512(const Tag *row, unsigned n, Tag tag) {
+  const __m512i key = _mm512_set1_epi64(static_cast<long long>(tag));
+  for (unsigned way=0; way<n; way+=8) {
+    __m512i chunk = _mm512_load_si512(reinterpret_cast<const void *>(row + way));
+    unsigned mask = _mm512_cmpeq_epi64_mask(chunk, key);
+    if (mask)
+      return way + __builtin_ctz(mask);
+  }
+  return n;
+}
+#endif
+
+/* Whether the host supports a kernel */
+static bool kernelSupported(TagKernel k) {
+#ifdef TAG_SIMD
+  __builtin_cpu_init();
+  switch (k) {
+    case TAG_SCALAR: return true;
+    case TAG_SSE2: return __builtin_cpu_supports("sse2");
+    case TAG_AVX2: return __builtin_cpu_supports("avx2");
+    case TAG_AVX512: return __builtin_cpu_supports("avx512f");
+    default: return false;
+  }
+#else
+  return k == TAG_SCALAR;
+#endif
+}
+
+/* Constructor: Initialize the TagArray with the number of sets and ways */
+TagArray::TagArray(unsigned n_sets, unsigned n_ways) {
+  this->initialize(n_sets, n_ways);
+}
+
+/* Allocate the rows of the array, all ways are invalid */
+void TagArray::initialize(unsigned n_sets, unsigned n_ways) {
+  const unsigned line_tags = HOST_LINE_SIZE / sizeof(Tag);
+
+  this->numSets = n_sets;
+  this->numWays = n_ways;
+  // Round the row up to whole lines
+  this->stride = (n_ways + line_tags - 1) / line_tags * line_tags;
+
+  // Reserve one extra line to align the first row
+  this->storage.assign((size_t)n_sets * this->stride + line_tags, INVALID_TAG);
+  uintptr_t start = reinterpret_cast<uintptr_t>(this->storage.data());
+  this->base = (HOST_LINE_SIZE - start % HOST_LINE_SIZE) % HOST_LINE_SIZE / sizeof(Tag);
+
+  this->setKernel(TAG_AUTO);
+}
+
+/* Select the tag comparison kernel,
+ * TAG_AUTO uses the scalar loop for small sets (where it is the fastest) and the widest vector kernel otherwise
+ */
+void TagArray::setKernel(TagKernel k) {
+  if (k == TAG_AUTO) {
+    k = TAG_SCALAR;
+    if (this->numWays > 4)
+      for (TagKernel wide : {TAG_SSE2, TAG_AVX2, TAG_AVX512})
+        if (kernelSupported(wide))
+          k = wide;
+  } else if (!kernelSupported(k))
+    k = TAG_SCALAR;
+
+  this->kernel = k;
+  switch (k) {
+#ifdef TAG_SIMD
+    case TAG_SSE2: this->finder = findSSE2; break;
+    case TAG_AVX2: this->finder = findAVX2; break;
+    case TAG_AVX512: this->finder = findAVX512; break;
+#endif
+    default: this->finder = findScalar; break;
+  }
+}
+
+/* The name of a kernel (for reports) */
+const char *TagArray::kernelName(TagKernel k) {
+  switch (k) {
+    case TAG_AUTO: return "auto";
+    case TAG_SCALAR: return "scalar";
+    case TAG_SSE2: return "SSE2";
+    case TAG_AVX2: return "AVX2";
+    case TAG_AVX512: return "AVX-512";
+  }
+  return "unknown";
+}
+
+/* Invalidate all the ways of the array */
+void TagArray::reset() {
+  for (auto &tag : this->storage)
+    tag = INVALID_TAG;
+}
+
+/* Write the tags to a checkpoint (the geometry, then the ways of every row, without the padding) */
+void TagArray::save(CheckpointWriter &w) const {
+  w.put(this->numSets);
+  w.put(this->numWays);
+  for (unsigned set_id=0; set_id != this->numSets; ++set_id)
+    w.write(this->row(set_id), this->numWays * sizeof(Tag));
+}
+
+/* Read the tags back from a checkpoint */
+void TagArray::restore(CheckpointReader &r) {
+  unsigned n_sets, n_ways;
+  r.get(n_sets);
+  r.get(n_ways);
+  if (n_sets != this->numSets || n_ways != this->numWays)
+    CheckpointReader::mismatch();
+  for (unsigned set_id=0; set_id != this->numSets; ++set_id)
+    r.read(this->row(set_id), this->numWays * sizeof(Tag));
+}
@@ -0,0 +1,176 @@
+/* ./lib/Trace.cc
+ * TraceWriter and TraceReader are data structures in the library
+ *  TraceWriter codes the records of a chunk in memory, and writes every full chunk to the file,
+ *    the index is kept in memory and written at the end, then the header is written over the placeholder
+ *  TraceReader maps the whole file (read only), so the chunks are decoded straight from the page cache
+ */
+
+#include "containers.hh"
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* A base whose delta codes in two bytes or less is near (11 bits of zigzag), otherwise the least recently used base is taken */
+#define TRACE_NEAR (1ull<<11)
+/* Addresses are below 2^60, so a token fits in 64 bits */
+#define TRACE_ADDRESS_BITS 60
+
+/* Constructor: create the file, with a placeholder for the header */
+TraceWriter::TraceWriter(const string &path) {
+  this->file = fopen(path.c_str(), "wb");
+  if (!this->file)
+    throw runtime_error("Cannot create the trace " + path + " (Code: 009).");
+  TraceHeader header;
+  memset(&header, 0, sizeof(header));
+  fwrite(&header, sizeof(header), 1, this->file);
+  this->bytes = sizeof(header);
+
+  memset(&this->current, 0, sizeof(this->current));
+  this->current.offset = this->bytes;
+  memset(this->slots, 0, sizeof(this->slots));
+  memset(this->lastUse, 0, sizeof(this->lastUse));
+  this->buffer.reserve(TRACE_CHUNK * 3);
+}
+
+/* Destructor: finish the file */
+TraceWriter::~TraceWriter() {
+  this->close();
+}
+
+/* Append a record to the chunk, on the nearest base */
+void TraceWriter::append(uint64_t address, bool write) {
+  if (address >> TRACE_ADDRESS_BITS)
+    throw runtime_error("Address beyond the trace format (Code: 009).");
+
+  unsigned slot = 0, oldest = 0;
+  uint64_t nearest = UINT64_MAX;
+  for (unsigned s=0; s!=TRACE_SLOTS; ++s) {
+    int64_t delta = address - this->slots[s];
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    if (zigzag < nearest) {
+      nearest = zigzag;
+      slot = s;
+    }
+    if (this->lastUse[s] < this->lastUse[oldest])
+      oldest = s;
+  }
+  // A new stream takes the least recently used base
+  if (nearest >= TRACE_NEAR && slot != oldest) {
+    slot = oldest;
+    int64_t delta = address - this->slots[slot];
+    nearest = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+  }
+  this->slots[slot] = address;
+  this->lastUse[slot] = ++this->records;
+
+  uint64_t token = nearest << (TRACE_SLOT_BITS + 1) | slot << 1 | (write ? 1 : 0);
+  while (token >= 0x80) {
+    this->buffer.push_back(static_cast<uint8_t>(token | 0x80));
+    token >>= 7;
+  }
+  this->buffer.push_back(static_cast<uint8_t>(token));
+
+  if (++this->current.records == TRACE_CHUNK)
+    this->cut();
+}
+
+/* Write the chunk being coded, and start the next one (the bases start over) */
+void TraceWriter::cut() {
+  if (this->current.records == 0 && this->current.instructions == 0 && this->current.flags == 0)
+    return;
+  if (fwrite(this->buffer.data(), 1, this->buffer.size(), this->file) != this->buffer.size())
+    throw runtime_error("Cannot write the trace (Code: 009).");
+  this->current.bytes = this->buffer.size();
+  this->bytes += this->buffer.size();
+  this->index.push_back(this->current);
+
+  this->buffer.clear();
+  memset(&this->current, 0, sizeof(this->current));
+  this->current.offset = this->bytes;
+  memset(this->slots, 0, sizeof(this->slots));
+  memset(this->lastUse, 0, sizeof(this->lastUse));
+}
+
+/* Cut the chunk, the replay resets its cache (and counters) before the next one */
+void TraceWriter::reset() {
+  this->cut();
+  this->current.flags |= TRACE_RESET;
+}
+
+/* Write the last chunk, the index, and the header */
+void TraceWriter::close() {
+  if (!this->file)
+    return;
+  this->cut();
+
+  TraceHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.slots = TRACE_SLOTS;
+  header.chunks = this->index.size();
+  header.indexOffset = this->bytes;
+
+  size_t n = this->index.size();
+  bool written = fwrite(this->index.data(), sizeof(TraceChunk), n, this->file) == n;
+  this->bytes += n * sizeof(TraceChunk);
+  written = written && fseek(this->file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, this->file) == 1;
+  written = fclose(this->file) == 0 && written;
+  this->file = nullptr;
+  if (!written)
+    throw runtime_error("Cannot write the trace (Code: 009).");
+}
+
+/* Constructor: map the file, and check it */
+TraceReader::TraceReader(const string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0) {
+    if (fd >= 0)
+      ::close(fd);
+    throw runtime_error("Cannot open the trace " + path + " (Code: 009).");
+  }
+  this->length = status.st_size;
+  void *mapping = this->length ? mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    throw runtime_error("Cannot map the trace " + path + " (Code: 009).");
+  this->data = static_cast<const uint8_t *>(mapping);
+  madvise(mapping, this->length, MADV_SEQUENTIAL);
+
+  // Check the header and the index (unmap on failure, the destructor does not run)
+  try {
+    this->readIndex(path);
+  } catch (...) {
+    munmap(mapping, this->length);
+    throw;
+  }
+}
+
+/* Read the index of the mapped file, after checking the header */
+void TraceReader::readIndex(const string &path) {
+  TraceHeader header;
+  if (this->length < sizeof(header))
+    throw runtime_error("Not a trace: " + path + " (Code: 009).");
+  memcpy(&header, this->data, sizeof(header));
+  if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != TRACE_VERSION
+      || header.slots != TRACE_SLOTS || header.indexOffset > this->length
+      || header.chunks > (this->length - header.indexOffset) / sizeof(TraceChunk))
+    throw runtime_error("Not a trace, or a trace of another version: " + path + " (Code: 009).");
+
+  this->index.resize(header.chunks);
+  memcpy(this->index.data(), this->data + header.indexOffset, header.chunks * sizeof(TraceChunk));
+  for (auto &chunk : this->index)
+    if (chunk.offset + chunk.bytes > header.indexOffset)
+      throw runtime_error("Corrupted trace index: " + path + " (Code: 009).");
+}
+
+/* Destructor: unmap the file */
+TraceReader::~TraceReader() {
+  if (this->data)
+    munmap(const_cast<uint8_t *>(this->data), this->length);
+}
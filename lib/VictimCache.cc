@@ -0,0 +1,52 @@
+/* ./lib/VictimCache.cc
+ * VictimCache is a data structure in the library
+ *  VictimCache is a small fully associative buffer of the blocks beside a cache (a victim cache, or a miss cache),
+ *    the blocks of its entries are searched linearly, and the entries are replaced in LRU order
+ */
+
+#include "containers.hh"
+
+const uint64_t VictimCache::EMPTY;
+
+/* Constructor: Initialize with the number of entries */
+VictimCache::VictimCache(unsigned n_entries) {
+  this->initialize(n_entries);
+}
+
+/* Allocate the entries, all empty */
+void VictimCache::initialize(unsigned n_entries) {
+  this->blocks.assign(n_entries, EMPTY);
+  this->dirty.assign(n_entries, 0);
+  this->lru.initialize(1, n_entries);
+}
+
+/* Remove the block of an entry (the cache takes it back), returns whether it was dirty */
+bool VictimCache::take(unsigned entry) {
+  bool wasDirty = this->dirty[entry];
+  this->blocks[entry] = EMPTY;
+  this->dirty[entry] = 0;
+  this->lru.remove(0, entry);
+  return wasDirty;
+}
+
+/* Insert a block in an empty entry, or in the one of the least recently used block (evicted) */
+bool VictimCache::insert(uint64_t block, bool dirtyBlock, uint64_t &evicted, bool &evictedDirty) {
+  unsigned entry = this->find(EMPTY);
+  bool full = entry == this->blocks.size();
+  if (full) {
+    entry = this->lru.pop(0);
+    evicted = this->blocks[entry];
+    evictedDirty = this->dirty[entry];
+  }
+  this->blocks[entry] = block;
+  this->dirty[entry] = dirtyBlock;
+  this->lru.push(0, entry);
+  return full;
+}
+
+/* Empty every entry */
+void VictimCache::reset() {
+  this->blocks.assign(this->blocks.size(), EMPTY);
+  this->dirty.assign(this->dirty.size(), 0);
+  this->lru.reset();
+}
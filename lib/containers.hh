@@ -1,10 +1,36 @@
 #include <vector>
+#include <cstdint>
+#include <cstdio>
 #include <deque>
-#include <list>
 #include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <atomic>
+#include <memory>
 
 using namespace::std;
 
+/* A line in the host cache (bytes), the rows of the TagArray are aligned to it */
+#define HOST_LINE_SIZE 64
+/* The tag of an invalid way, no valid address produces this tag */
+#define INVALID_TAG UINT64_MAX
+
+typedef uint64_t Tag; // Tag of a cache block (the high bits of a 64-bit address)
+
+/* Tag comparison kernels of the TagArray, TAG_AUTO picks the widest one the host supports */
+enum TagKernel { TAG_AUTO, TAG_SCALAR, TAG_SSE2, TAG_AVX2, TAG_AVX512 };
+
+/* A stack of StackDistance with up to STACK_LIST_WAYS blocks is searched linearly (rather than through a Fenwick tree) */
+#define STACK_LIST_WAYS 64
+
+/* The state of the data structures is written to a checkpoint, and read back from it (see CheckpointWriter) */
+class CheckpointWriter;
+class CheckpointReader;
+
 /* Type declarations: Advanced Data Structures */
 
 /* BlockQueue is a vector of set queues (of block numbers),
@@ -17,6 +43,9 @@ using namespace::std;
  *    void initialize(unsigned): Fill a BLockQueue with the number of sets given, can only be used with numSets=0
  *    unsigned pop(unsigned): Pop a block from the set number given
  *    void push(unsigned, unsigned): Push a block into the set queue given
+ *    void remove(unsigned, unsigned): Remove a block from the set queue given (a block invalidated in the cache)
+ *    void reset(): Empty all the set queues
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&): Write the state to a checkpoint, read it back (same geometry)
  *    void show(): Print out the memory status of the data structure at runtime
  *  Private:
  *    queues: collection of set queues, each queue is represented as deque
@@ -29,40 +58,911 @@ public:
   void initialize(unsigned n_sets);
   unsigned pop(unsigned set_id);
   void push(unsigned set_id, unsigned block_id);
+  void remove(unsigned set_id, unsigned block_id);
+  void reset();
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
   void show();
 private:
   vector<deque<unsigned>> queues;
   unsigned numSets = 0;
 };
 
-/* BlockLRU is a list of set queues (of block numbers), with unordered_map for fast indexing
+/* BlockLRU is a flat array of intrusive doubly-linked lists of block numbers, one list per set,
  *  set queue uses the policy: LRU,
  *  it records the sequence of the block numbers being used.
+ *  The links of block block_id of set set_id are stored at set_id*numWays+block_id,
+ *  so push, pop and update are O(1) and never allocate.
  * It has the following members:
  *  Public:
  *    BlockLRU(): Default constructor, should be used with caution;
- *    BlockLRU(unsigned): Constructor by specifying the number of sets in the BlockLRU
- *    void initialize(unsigned): Fill a BlockLRU with the number of sets given, can only be used with numSets=0
- *    unsigned pop(unsigned): Pop a block from the set number given
- *    void update(unsigned, unsigned): Update the order of a block of a set sequence (to lowest)
- *    void push(unsigned, unsigned): Push a block into the set queue given
+ *    BlockLRU(unsigned, unsigned): Constructor by specifying the number of sets and blocks per set in the BlockLRU
+ *    void initialize(unsigned, unsigned): Fill a BlockLRU with the number of sets and blocks per set given, can only be used with numSets=0
+ *    unsigned pop(unsigned): Pop a block (the least recently used) from the set number given
+ *    void update(unsigned, unsigned): Update the order of a block of a set sequence (to most recently used)
+ *    void push(unsigned, unsigned): Push a block into the set queue given (as most recently used)
+ *    void remove(unsigned, unsigned): Remove a block (which must be in the list) from the set queue given
+ *    void reset(): Empty all the set queues
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&): Write the state to a checkpoint, read it back (same geometry)
  *    void show(): Print out the memory status of the data structure at runtime
  *  Private:
- *    lists: collection of set queues, each queue is represented as a list
- *    maps: an unordered_map of <block_id, block_id iterator> pairs
- *    numSets: the number of sets in the data structures
+ *    links: the previous and next block of each block, NIL ends a list
+ *    heads, tails: the most and least recently used block of each set
+ *    numSets, numWays: the number of sets and blocks per set in the data structures
  */
 class BlockLRU {
 public:
   BlockLRU() {};
-  BlockLRU(unsigned n_sets);
-  void initialize(unsigned n_sets);
+  BlockLRU(unsigned n_sets, unsigned n_ways);
+  void initialize(unsigned n_sets, unsigned n_ways);
   unsigned pop(unsigned set_id);
-  void update(unsigned set_id, unsigned block_id);
+  inline void update(unsigned set_id, unsigned block_id) {
+    // Already the most recently used (the common hit is checked inline)
+    if (this->heads[set_id] != block_id)
+      this->promote(set_id, block_id); }
   void push(unsigned set_id, unsigned block_id);
+  inline void remove(unsigned set_id, unsigned block_id) { this->unlink(set_id, block_id); }
+  void reset();
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
   void show();
 private:
-  vector<list<unsigned>> lists;
-  vector<unordered_map<unsigned, list<unsigned>::iterator>> maps;
+  static const unsigned NIL = UINT32_MAX;
+  struct Link { unsigned prev, next; };
+  vector<Link> links;
+  vector<unsigned> heads;
+  vector<unsigned> tails;
   unsigned numSets = 0;
+  unsigned numWays = 0;
+  inline Link &link(unsigned set_id, unsigned block_id) { return this->links[(size_t)set_id*this->numWays + block_id]; }
+  void unlink(unsigned set_id, unsigned block_id);
+  void promote(unsigned set_id, unsigned block_id);
+};
+
+/* TagArray is a flat, set-major array of the tags in a cache,
+ *  each set is one row of the array, and each row is padded to (and aligned on) HOST_LINE_SIZE,
+ *  an invalid way holds INVALID_TAG, so a lookup is a single scan over one contiguous row.
+ * It has the following members:
+ *  Public:
+ *    TagArray(): Default constructor, should be used with caution;
+ *    TagArray(unsigned, unsigned): Constructor by specifying the number of sets and ways
+ *    No copy (a copied storage is allocated anew, base would not align its rows), a move keeps the allocation
+ *    void initialize(unsigned, unsigned): Allocate the rows, can only be used with numSets=0
+ *    void setKernel(TagKernel): Select the tag comparison kernel (falls back to scalar if unsupported)
+ *    TagKernel getKernel(): The tag comparison kernel in use
+ *    static const char *kernelName(TagKernel): The name of a kernel
+ *    unsigned find(unsigned, Tag): Return the way holding the tag in the set, numWays if absent
+ *    unsigned findInvalid(unsigned): Return the first invalid way in the set, numWays if the set is full
+ *    Tag get(unsigned, unsigned): Get the tag of a way
+ *    void set(unsigned, unsigned, Tag): Set the tag of a way
+ *    void invalidate(unsigned, unsigned): Invalidate a way
+ *    void reset(): Invalidate all the ways
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&): Write the state to a checkpoint, read it back (same geometry)
+ *    unsigned getStride(): The number of tags in a (padded) row
+ *  Private:
+ *    storage: the tags, with extra room at the front to align the first row
+ *    base: the index of the first row in storage
+ *    stride: the number of tags in a row (numWays rounded up to a line)
+ *    numSets, numWays: the geometry of the cache
+ *    kernel, finder: the tag comparison kernel, finder(row, n, tag) returns the first match in the row or n
+ */
+class TagArray {
+public:
+  TagArray() {};
+  TagArray(const TagArray &) = delete;
+  TagArray &operator=(const TagArray &) = delete;
+  TagArray(TagArray &&) = default;
+  TagArray &operator=(TagArray &&) = default;
+  TagArray(unsigned n_sets, unsigned n_ways);
+  void initialize(unsigned n_sets, unsigned n_ways);
+  void setKernel(TagKernel k);
+  inline TagKernel getKernel() const { return this->kernel; }
+  static const char *kernelName(TagKernel k);
+  inline unsigned find(unsigned set_id, Tag tag) const {
+    // The scalar loop is inlined (small sets), the vector kernels are called through finder
+    if (this->kernel == TAG_SCALAR) {
+      const Tag *ways = this->row(set_id);
+      unsigned way = 0;
+      while (way != this->numWays && ways[way] != tag)
+        ++way;
+      return way;
+    }
+    unsigned way = this->finder(this->row(set_id), this->numWays, tag);
+    return way < this->numWays ? way : this->numWays; }
+  inline unsigned findInvalid(unsigned set_id) const { return this->find(set_id, INVALID_TAG); }
+  inline Tag get(unsigned set_id, unsigned way) const { return this->row(set_id)[way]; }
+  inline void set(unsigned set_id, unsigned way, Tag tag) { this->row(set_id)[way] = tag; }
+  inline void invalidate(unsigned set_id, unsigned way) { this->row(set_id)[way] = INVALID_TAG; }
+  void reset();
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
+  inline unsigned getStride() const { return this->stride; }
+private:
+  vector<Tag> storage;
+  size_t base = 0;
+  unsigned stride = 0;
+  unsigned numSets = 0;
+  unsigned numWays = 0;
+  TagKernel kernel = TAG_SCALAR;
+  unsigned (*finder)(const Tag *row, unsigned n, Tag tag) = nullptr;
+  inline const Tag *row(unsigned set_id) const { return this->storage.data() + this->base + (size_t)set_id * this->stride; }
+  inline Tag *row(unsigned set_id) { return this->storage.data() + this->base + (size_t)set_id * this->stride; }
+};
+
+/* BlockPLRU is a tree pseudo-LRU of the blocks of every set,
+ *  each set keeps a binary tree of bits over its blocks (node i has children 2i and 2i+1, leaves are blocks),
+ *  a bit points to the half that holds the next victim, the bits of all sets are packed in one vector of words.
+ *  The top 6 levels of a tree (nodes 1 to 63) share its first word, the part of the path of a block in them is
+ *  precomputed, so an update is one masked store plus one bit per deeper level (none with up to 64 blocks).
+ * It has the following members:
+ *  Public:
+ *    BlockPLRU(): Default constructor, should be used with caution;
+ *    BlockPLRU(unsigned, unsigned): Constructor by specifying the number of sets and blocks per set
+ *    void initialize(unsigned, unsigned): Allocate the trees, can only be used with numSets=0
+ *    void update(unsigned, unsigned): Point the path of a block away from it (O(log ways))
+ *    unsigned victim(unsigned): Follow the bits from the root to the victim block (O(log ways))
+ *    void reset(): Clear all the bits
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&): Write the state to a checkpoint, read it back (same geometry)
+ *  Private:
+ *    bits: the tree bits, set set_id starts at word set_id*wordsPerSet
+ *    leaves: the number of leaves of a tree (numWays rounded up to a power of 2)
+ *    pathMasks, pathBits: the nodes on the path in the first word, and their values after an update,
+ *      indexed by the ancestor of the block on level 6 (block_id >> topShift)
+ *    topShift: the number of levels below level 6
+ *    mru: the last block updated in each set (its update is a no-op)
+ *    wordsPerSet, numSets, numWays: the geometry
+ */
+class BlockPLRU {
+public:
+  BlockPLRU() {};
+  BlockPLRU(unsigned n_sets, unsigned n_ways);
+  void initialize(unsigned n_sets, unsigned n_ways);
+  void update(unsigned set_id, unsigned block_id);
+  unsigned victim(unsigned set_id) const;
+  void reset();
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
+private:
+  vector<uint64_t> bits;
+  vector<uint64_t> pathMasks;
+  vector<uint64_t> pathBits;
+  vector<unsigned> mru;
+  unsigned leaves = 1;
+  unsigned topShift = 0;
+  unsigned wordsPerSet = 0;
+  unsigned numSets = 0;
+  unsigned numWays = 0;
+  inline bool getBit(unsigned set_id, unsigned node) const {
+    return (this->bits[(size_t)set_id*this->wordsPerSet + node/64] >> (node%64)) & 1; }
+  inline void setBit(unsigned set_id, unsigned node, bool value) {
+    uint64_t &word = this->bits[(size_t)set_id*this->wordsPerSet + node/64];
+    word = (word & ~(1ull << (node%64))) | ((uint64_t)value << (node%64)); }
+};
+
+/* BlockRRIP keeps a re-reference prediction value (RRPV, 0 to maxRRPV <= 3) for the blocks of every set,
+ *  the RRPVs are packed as 2-bit lanes (32 blocks per word), and searched a word at a time,
+ *  it is the state of the NRU (maxRRPV 1) and the SRRIP/BRRIP/DRRIP (maxRRPV 3) policies.
+ * It has the following members:
+ *  Public:
+ *    BlockRRIP(): Default constructor, should be used with caution;
+ *    void initialize(unsigned, unsigned, unsigned): Allocate the RRPVs of n_sets sets of n_ways blocks, with the maximum RRPV
+ *    void set(unsigned, unsigned, unsigned): Set the RRPV of a block
+ *    unsigned get(unsigned, unsigned): Get the RRPV of a block
+ *    unsigned victim(unsigned): The first block predicted distant (RRPV == maxRRPV),
+ *      the set is aged (all RRPVs increased) until there is one
+ *    unsigned getMaxRRPV(): The maximum RRPV
+ *    void reset(): Set all the RRPVs to 0
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&): Write the state to a checkpoint, read it back (same geometry)
+ *  Private:
+ *    lanes: the RRPVs, set set_id starts at word set_id*wordsPerSet
+ *    lastMask: the valid lanes of the last word of a set
+ *    wordsPerSet, numSets, numWays, maxRRPV
+ */
+class BlockRRIP {
+public:
+  BlockRRIP() {};
+  void initialize(unsigned n_sets, unsigned n_ways, unsigned max_rrpv);
+  inline void set(unsigned set_id, unsigned block_id, unsigned rrpv) {
+    uint64_t &word = this->lanes[(size_t)set_id*this->wordsPerSet + block_id/32];
+    unsigned shift = block_id%32*2;
+    word = (word & ~(3ull << shift)) | ((uint64_t)rrpv << shift); }
+  inline unsigned get(unsigned set_id, unsigned block_id) const {
+    return (this->lanes[(size_t)set_id*this->wordsPerSet + block_id/32] >> (block_id%32*2)) & 3; }
+  unsigned victim(unsigned set_id);
+  inline unsigned getMaxRRPV() const { return this->maxRRPV; }
+  void reset();
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
+private:
+  vector<uint64_t> lanes;
+  uint64_t lastMask = 0;
+  unsigned wordsPerSet = 0;
+  unsigned numSets = 0;
+  unsigned numWays = 0;
+  unsigned maxRRPV = 3;
+  // The first block of the set whose RRPV is value, numWays if none
+  unsigned findValue(unsigned set_id, unsigned value) const;
+};
+
+/* BlockHeap keeps a 64-bit key for the blocks of every set, and a binary min-heap per set ordered by
+ *  (key, block_id), so the block with the smallest key is at the top of the heap,
+ *  it is the state of the LFU (key: access count) and OPT (key: complement of the next use) policies.
+ *  The heaps, the positions of the blocks in them, and the keys are flat vectors of numSets*numWays.
+ * It has the following members:
+ *  Public:
+ *    BlockHeap(): Default constructor, should be used with caution;
+ *    BlockHeap(unsigned, unsigned): Constructor by specifying the number of sets and blocks per set
+ *    void initialize(unsigned, unsigned): Allocate the heaps, can only be used with numSets=0
+ *    void setKey(unsigned, unsigned, uint64_t): Set the key of a block, adding it to the heap if absent (O(log ways))
+ *    unsigned top(unsigned): The block with the smallest key (O(1))
+ *    uint64_t getKey(unsigned, unsigned): The key of a block
+ *    void reset(): Empty all the heaps
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&): Write the state to a checkpoint, read it back (same geometry)
+ *  Private:
+ *    heaps, positions, keys, sizes: the heaps (block ids), the heap index of a block (NIL if absent),
+ *      the keys, and the number of blocks in each heap
+ */
+class BlockHeap {
+public:
+  BlockHeap() {};
+  BlockHeap(unsigned n_sets, unsigned n_ways);
+  void initialize(unsigned n_sets, unsigned n_ways);
+  void setKey(unsigned set_id, unsigned block_id, uint64_t key);
+  inline unsigned top(unsigned set_id) const { return this->heaps[(size_t)set_id*this->numWays]; }
+  inline uint64_t getKey(unsigned set_id, unsigned block_id) const {
+    return this->keys[(size_t)set_id*this->numWays + block_id]; }
+  void reset();
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
+private:
+  static const unsigned NIL = UINT32_MAX;
+  vector<unsigned> heaps;
+  vector<unsigned> positions;
+  vector<uint64_t> keys;
+  vector<unsigned> sizes;
+  unsigned numSets = 0;
+  unsigned numWays = 0;
+  // Whether block a goes above block b in the heap of set_id
+  inline bool before(unsigned set_id, unsigned a, unsigned b) const {
+    uint64_t ka = this->getKey(set_id, a), kb = this->getKey(set_id, b);
+    return ka < kb || (ka == kb && a < b); }
+  void siftUp(unsigned set_id, unsigned index);
+  void siftDown(unsigned set_id, unsigned index);
+  void place(unsigned set_id, unsigned index, unsigned block_id);
+};
+
+/* NextUse records a stream of block numbers, and replays the time of the next use of each of them
+ *  (the time of an access is its index in the stream), as needed by Belady's OPT replacement.
+ *  The stream and the next uses are kept in temporary files, and only a chunk of each is in memory:
+ *  the next uses are computed in a single backward pass over the chunks of the recorded stream.
+ * It has the following members:
+ *  Public:
+ *    NextUse(): Constructor, opens the temporary files
+ *    void record(uint64_t): Append a block to the stream (first pass)
+ *    void finish(): Compute the next uses, and rewind for the replay
+ *    uint64_t next(): The time of the next use of the block of the next access of the replay, NEVER if none
+ *    uint64_t size(): The number of accesses recorded
+ *  Private:
+ *    blocks, distances: the files of the stream, and of the distance from each access to the next use of its block
+ *      (distances saturate to NEVER_DISTANCE, which also marks a last use)
+ *    blockBuffer, distanceBuffer: the chunk in memory
+ *    count, time, cursor: accesses recorded, accesses replayed, and position in distanceBuffer
+ *    maxBlock: the largest block recorded (the last uses are tracked in a flat table when it is small)
+ */
+class NextUse {
+public:
+  static const uint64_t NEVER = UINT64_MAX;
+  NextUse();
+  ~NextUse();
+  inline void record(uint64_t block) {
+    this->blockBuffer.push_back(block);
+    this->maxBlock = block > this->maxBlock ? block : this->maxBlock;
+    if (this->blockBuffer.size() == this->blockBuffer.capacity())
+      this->flushBlocks(); }
+  void finish();
+  inline uint64_t next() {
+    if (this->cursor == this->distanceBuffer.size() && !this->readDistances())
+      return NEVER;
+    uint32_t distance = this->distanceBuffer[this->cursor++];
+    uint64_t now = this->time++;
+    return distance == NEVER_DISTANCE ? NEVER : now + distance; }
+  inline uint64_t size() const { return this->count; }
+private:
+  static const uint32_t NEVER_DISTANCE = UINT32_MAX;
+  FILE *blocks = nullptr;
+  FILE *distances = nullptr;
+  vector<uint64_t> blockBuffer;
+  vector<uint32_t> distanceBuffer;
+  uint64_t count = 0;
+  uint64_t time = 0;
+  size_t cursor = 0;
+  uint64_t maxBlock = 0;
+  void flushBlocks();
+  bool readDistances();
+};
+
+/* StackDistance measures the LRU stack distance of every access of a stream of blocks (Mattson),
+ *  for every power-of-two number of sets from 1 (fully associative) to maxSets at once:
+ *  an access hits in an LRU cache of s sets and w ways iff fewer than w other blocks of its set were used since its last use.
+ * Every set of every set count keeps its stack as marks on its own clock (a Fenwick tree over the times of the last uses),
+ *  so the distance is the number of marks after the last use, in O(log n); the clock is compacted when it is full.
+ *  A stack only holds as many blocks as the largest associativity of its set count, the deeper ones are dropped,
+ *  and a stack of up to STACK_LIST_WAYS blocks is a plain list (most recently used first), searched linearly.
+ * It has the following members:
+ *  Public:
+ *    StackDistance(unsigned, unsigned): Constructor, with maxSets and maxBlocks (powers of two, the largest cache in blocks)
+ *    void access(uint64_t, bool): Measure an access (read or write) to a block
+ *    uint64_t misses(unsigned, unsigned, bool): The read or write misses of an LRU cache of n_sets sets of n_ways ways
+ *    uint64_t count(bool): The number of reads or writes
+ *    void reset(): Empty the stacks, and the counters
+ *  Private:
+ *    Clock: the clock of a set (time, live blocks, the time of the bottom block or before it)
+ *    clocks: the clocks of set count 2^e start at clocks[2^e - 1]
+ *    trees, owners: the Fenwick trees and the blocks (ids) of the marks, of all the sets, in a flat array each,
+ *      the clock of a set of set count 2^e has sizes[e] times (twice the largest associativity), at bases[e] + set*(sizes[e]+1)
+ *    lists: the stacks of the set counts with few ways, the list of a set is at bases[e] + set*sizes[e] (sizes[e] ways)
+ *    stamps: the time of the last use of every block (by id) in each set count, id*numCounts + e
+ *    ids: the id of every block (dense table for small block numbers, hash map otherwise)
+ *    histograms: distances of reads (0) and writes (1) for each set count, capped at the largest associativity
+ */
+class StackDistance {
+public:
+  StackDistance() {};
+  StackDistance(unsigned max_sets, unsigned max_blocks);
+  void initialize(unsigned max_sets, unsigned max_blocks);
+  void access(uint64_t block, bool write);
+  uint64_t misses(unsigned n_sets, unsigned n_ways, bool write) const;
+  inline uint64_t count(bool write) const { return this->accesses[write]; }
+  void reset();
+private:
+  static const uint32_t NONE = UINT32_MAX;
+  struct Clock {
+    uint32_t time;
+    uint32_t live;
+    uint32_t bottom;
+  };
+  unsigned numCounts = 0;
+  unsigned maxBlocks = 0;
+  vector<Clock> clocks;
+  vector<uint32_t> trees;
+  vector<uint32_t> owners;
+  vector<uint32_t> lists;
+  vector<uint32_t> sizes;
+  vector<size_t> bases;
+  vector<uint32_t> stamps;
+  vector<uint32_t> denseIds;
+  unordered_map<uint64_t, uint32_t> sparseIds;
+  uint32_t numIds = 0;
+  vector<uint64_t> histograms[2];
+  uint64_t accesses[2] = {0, 0};
+  uint32_t idOf(uint64_t block);
+  uint32_t reuse(unsigned e, unsigned set_id, uint32_t &stamp, uint32_t id);
+  uint32_t reuseList(unsigned e, unsigned set_id, uint32_t id);
+  void compact(unsigned e, Clock &clock, uint32_t *tree, uint32_t *owner);
+};
+
+/* Hardware prefetchers (Prefetcher), they see the addresses of the demand accesses of a cache, and name the blocks to prefetch
+ *  PREFETCH_NEXT_LINE: tagged next-line, a miss or the first hit on a prefetched block prefetches the next degree blocks
+ *  PREFETCH_STRIDE: a reference prediction table of PREFETCH_TABLE streams; there is no program counter in the simulation,
+ *    so an access belongs to the stream that predicted it, or else to the nearest one (within PREFETCH_REGION blocks);
+ *    the strides are in bytes, a stream whose stride repeats is prefetched degree strides ahead (or degree blocks ahead,
+ *    if its stride is shorter than a block) whenever it moves to another block
+ *  PREFETCH_STREAM: PREFETCH_STREAMS stream buffers of degree blocks (Jouppi), a miss no buffer holds starts a sequential stream
+ *    in the least recently used buffer; the prefetched blocks wait in the buffers, apart from the cache (they evict nothing),
+ *    and a miss on a block a buffer holds moves it to the cache, then the buffer fetches one more block
+ *  PREFETCH_DELTA: delta correlation on a global history of PREFETCH_HISTORY misses (and first hits on prefetched blocks),
+ *    the last two deltas are searched for in the history, and the deltas that followed them are replayed, degree of them
+ */
+enum PrefetchKind { PREFETCH_NONE, PREFETCH_NEXT_LINE, PREFETCH_STRIDE, PREFETCH_STREAM, PREFETCH_DELTA };
+#define PREFETCH_TABLE 16
+#define PREFETCH_REGION 256
+#define PREFETCH_STREAMS 4
+#define PREFETCH_HISTORY 64
+
+/* Prefetcher is the interface of the prefetchers
+ * It has the following members:
+ *  Public:
+ *    Prefetcher(unsigned, unsigned): Constructor, with the degree (the blocks prefetched ahead, the depth of a stream buffer)
+ *      and the block size (a power of two)
+ *    static PrefetchKind kindNamed(const string&): The prefetcher of a name given to -F (nextline, stride, stream, delta)
+ *    static unique_ptr<Prefetcher> create(PrefetchKind, unsigned, unsigned): A prefetcher of a kind, a degree and a block size
+ *    void access(uint64_t, bool, bool): A demand access to an address, whether it missed, and whether it used a prefetched block
+ *      (the first hit on it), the blocks to prefetch are appended to candidates (the cache clears it)
+ *    bool buffered(): Whether the prefetched blocks wait in the prefetcher rather than in the cache (stream buffers)
+ *    bool supply(uint64_t, uint64_t&): Take a block missed by the cache from the buffers, true if one held it
+ *      (and the time it was prefetched is set)
+ *    uint64_t time(): The clock of the prefetcher, the number of accesses it saw (the time a block is prefetched)
+ *    void reset(): Forget the streams and the history (the cache is invalidated)
+ *  Protected:
+ *    degree, shift (the bits of the offset in a block), clock
+ *    void train(uint64_t, bool, bool): The access, as seen by each prefetcher
+ */
+class Prefetcher {
+public:
+  Prefetcher(unsigned deg, unsigned block_size);
+  virtual ~Prefetcher() {}
+  static PrefetchKind kindNamed(const string &name);
+  static unique_ptr<Prefetcher> create(PrefetchKind kind, unsigned deg, unsigned block_size);
+  inline void access(uint64_t address, bool miss, bool useful) { ++this->clock; this->train(address, miss, useful); }
+  virtual bool buffered() const { return false; }
+  virtual bool supply(uint64_t block, uint64_t &issued) { return false; }
+  inline uint64_t time() const { return this->clock; }
+  virtual void reset() { this->clock = 0; this->candidates.clear(); }
+  vector<uint64_t> candidates;
+protected:
+  unsigned degree;
+  unsigned shift = 0;
+  uint64_t clock = 0;
+  virtual void train(uint64_t address, bool miss, bool useful) = 0;
+};
+
+/* NextLinePrefetcher: the next degree blocks of a miss, or of the first hit on a prefetched block */
+class NextLinePrefetcher : public Prefetcher {
+public:
+  NextLinePrefetcher(unsigned deg, unsigned block_size) : Prefetcher(deg, block_size) {}
+protected:
+  void train(uint64_t address, bool miss, bool useful);
+};
+
+/* StridePrefetcher: the streams of the table, each with its last address, stride, confidence (0 to 3, prefetched from 2)
+ *  and the time of its last access (the least recently used stream is replaced) */
+class StridePrefetcher : public Prefetcher {
+public:
+  StridePrefetcher(unsigned deg, unsigned block_size);
+  void reset();
+protected:
+  void train(uint64_t address, bool miss, bool useful);
+private:
+  struct Stream {
+    uint64_t last;
+    int64_t stride;
+    unsigned confidence;
+    uint64_t used;
+  };
+  vector<Stream> streams;
+};
+
+/* StreamBufferPrefetcher: the buffers, each a FIFO of the blocks it prefetched (and when), and the time of its last use */
+class StreamBufferPrefetcher : public Prefetcher {
+public:
+  StreamBufferPrefetcher(unsigned deg, unsigned block_size);
+  bool buffered() const { return true; }
+  bool supply(uint64_t block, uint64_t &issued);
+  void reset();
+protected:
+  void train(uint64_t address, bool miss, bool useful);
+private:
+  struct Buffer {
+    deque<pair<uint64_t, uint64_t>> blocks;
+    uint64_t used;
+  };
+  vector<Buffer> buffers;
+  void fetch(Buffer &buffer, uint64_t block);
+};
+
+/* DeltaPrefetcher: the deltas between the last PREFETCH_HISTORY blocks missed (a ring, count of them are valid), and the last block */
+class DeltaPrefetcher : public Prefetcher {
+public:
+  DeltaPrefetcher(unsigned deg, unsigned block_size);
+  void reset();
+protected:
+  void train(uint64_t address, bool miss, bool useful);
+private:
+  vector<int64_t> deltas;
+  unsigned head = 0, count = 0;
+  uint64_t last = 0;
+  bool started = false;
+};
+
+/* The three classes of a miss (3C): the first touch of a block, a miss of a fully associative LRU cache of the same size too,
+ *  or a miss that only the mapping of the blocks to the sets causes */
+enum MissKind { MISS_COMPULSORY, MISS_CAPACITY, MISS_CONFLICT };
+/* The blocks touched are marked in a flat bitmap below this block number (in a hash set above it) */
+#define CLASSIFY_DENSE_BLOCKS (1ull<<28)
+
+/* MissClassifier classifies the misses of a cache, it sees every access of the cache (hits too):
+ *  the blocks touched are marked in a bitmap, and a fully associative LRU shadow of as many blocks as the cache
+ *  holds the blocks of the stream; the shadow is an open addressing hash table of the blocks (linear probing, erased by
+ *  shifting back), threaded by an intrusive doubly-linked list in the order of use, so O(1) per access
+ * It has the following members:
+ *  Public:
+ *    MissClassifier(): Default constructor, initialize() before use
+ *    MissClassifier(unsigned): Constructor, with the number of blocks of the cache
+ *    void initialize(unsigned): Allocate the shadow of a cache of n_blocks blocks, empty, and no block touched
+ *    MissKind classify(uint64_t, bool): An access to a block, and whether a miss on it fills the cache (a write without
+ *      write-allocate does not); returns the class it has if it misses in the cache: compulsory if the block was never touched,
+ *      capacity if it missed in the shadow, conflict otherwise (the shadow and the bitmap are updated in any case)
+ *    void reset(): Empty the shadow, and forget the blocks touched (the cache is invalidated, the misses after it are cold)
+ *  Private:
+ *    table, mask: the entries of the hash table (a block, EMPTY if free, and the links of the list), mask is its size minus one
+ *      (a power of two, at least twice the blocks of the shadow)
+ *    head, tail: the most and least recently used entries (NIL if the shadow is empty), update() classifies the access
+ *      to any block but the head
+ *    numBlocks, used: the blocks the shadow holds at most, and now
+ *    dense, sparse: the blocks touched, below CLASSIFY_DENSE_BLOCKS (one bit each, grown on demand) and above it
+ */
+class MissClassifier {
+public:
+  MissClassifier() {};
+  MissClassifier(unsigned n_blocks);
+  void initialize(unsigned n_blocks);
+  inline MissKind classify(uint64_t block, bool fill) {
+    // The most recently used block of the shadow was touched already (the common hit is checked inline)
+    return this->head != NIL && this->table[this->head].block == block ? MISS_CONFLICT : this->update(block, fill); }
+  void reset();
+private:
+  static const uint64_t EMPTY = UINT64_MAX;
+  static const unsigned NIL = UINT32_MAX;
+  struct Entry { uint64_t block; unsigned prev, next; };
+  vector<Entry> table;
+  uint64_t mask = 0;
+  unsigned head = NIL, tail = NIL;
+  unsigned numBlocks = 0, used = 0;
+  vector<uint64_t> dense;
+  unordered_set<uint64_t> sparse;
+  inline size_t home(uint64_t block) const { return (block * 0x9E3779B97F4A7C15ull >> 32) & this->mask; }
+  bool touch(uint64_t block);
+  unsigned find(uint64_t block) const;
+  void unlink(unsigned i);
+  void push(unsigned i);
+  void erase(unsigned i);
+  MissKind update(uint64_t block, bool fill);
+};
+
+/* VictimCache is a small fully associative buffer of blocks beside a cache, it holds the tags only (the payload is in the ram):
+ *  as a victim cache it receives the blocks the cache evicts (dirty or not), and gives one back on a miss of the cache (a swap);
+ *  as a miss cache it receives a clean copy of every block the cache missed, and keeps it when it supplies it again;
+ *  the blocks are searched linearly (there are a handful, like the entries of the CAM of the hardware),
+ *  and replaced in LRU order (a BlockLRU of a single set over the entries)
+ * It has the following members:
+ *  Public:
+ *    VictimCache(): Default constructor, initialize() before use
+ *    VictimCache(unsigned): Constructor, with the number of entries
+ *    void initialize(unsigned): Allocate the entries, all empty
+ *    unsigned find(uint64_t): The entry that holds a block, size() if none
+ *    void touch(unsigned): An entry supplied its block (it becomes the most recently used)
+ *    bool take(unsigned): Remove the block of an entry, returns whether it was dirty (the entry is empty afterwards)
+ *    bool insert(uint64_t, bool, uint64_t&, bool&): Insert a block (not held yet), dirty or not, in an empty entry or in the one
+ *      of the least recently used block; true if a block was evicted (the block and whether it was dirty are set)
+ *    unsigned size(): The number of entries
+ *    void reset(): Empty every entry
+ *  Private:
+ *    blocks (the block of every entry, EMPTY if none), dirty (whether it is dirty), lru (the order of the entries held)
+ */
+class VictimCache {
+public:
+  VictimCache() {};
+  VictimCache(unsigned n_entries);
+  void initialize(unsigned n_entries);
+  inline unsigned find(uint64_t block) const {
+    unsigned entry = 0;
+    while (entry != this->blocks.size() && this->blocks[entry] != block)
+      ++entry;
+    return entry; }
+  inline void touch(unsigned entry) { this->lru.update(0, entry); }
+  bool take(unsigned entry);
+  bool insert(uint64_t block, bool dirtyBlock, uint64_t &evicted, bool &evictedDirty);
+  inline unsigned size() const { return this->blocks.size(); }
+  void reset();
+private:
+  static const uint64_t EMPTY = UINT64_MAX;
+  vector<uint64_t> blocks;
+  vector<uint8_t> dirty;
+  BlockLRU lru;
+};
+
+/* A binary trace of memory accesses (TraceWriter, TraceReader)
+ *  The file is a header, the chunks, and the index of the chunks (TraceChunk, at indexOffset), all little-endian.
+ *  A chunk holds up to TRACE_CHUNK records, each a LEB128 varint of
+ *    zigzag(address - slots[s]) << (TRACE_SLOT_BITS + 1) | s << 1 | write,
+ *  where slots are the addresses last coded on each of TRACE_SLOTS bases (all 0 at the start of a chunk),
+ *  so interleaved sequential streams (the rows and columns of a matrix) are coded in a byte or two each.
+ *  A chunk records the instructions that are not memory accesses as a count, and is cut at every reset
+ *  (the next chunk has the TRACE_RESET flag), so the counters of a replay match the ones of the capture.
+ */
+#define TRACE_MAGIC "CACHESIM"
+#define TRACE_VERSION 1u
+#define TRACE_CHUNK (1u<<16)
+#define TRACE_SLOT_BITS 2
+#define TRACE_SLOTS (1u<<TRACE_SLOT_BITS)
+#define TRACE_RESET 1u
+
+struct TraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t slots;
+  uint64_t chunks;
+  uint64_t indexOffset;
+};
+
+struct TraceChunk {
+  uint64_t offset;
+  uint32_t bytes;
+  uint32_t records;
+  uint64_t instructions;
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+/* TraceWriter writes a trace, chunk by chunk
+ * It has the following members:
+ *  Public:
+ *    TraceWriter(const string&): Constructor, creates the file
+ *    ~TraceWriter(): close() the trace
+ *    void append(uint64_t, bool): Append a read (false) or write (true) to an address
+ *    void instructions(uint64_t): Count instructions that are not memory accesses
+ *    void reset(): Cut the chunk, the next one starts with a reset
+ *    void close(): Write the last chunk, the index, and the header
+ *    uint64_t getRecords(), getBytes(), getChunks(): The records, bytes and chunks written
+ *  Private:
+ *    file, buffer (the chunk being coded), current (its index entry), index, slots (the bases), lastUse (their order)
+ *    void cut(): Write the chunk being coded
+ */
+class TraceWriter {
+public:
+  TraceWriter(const string &path);
+  ~TraceWriter();
+  void append(uint64_t address, bool write);
+  inline void instructions(uint64_t count) { this->current.instructions += count; }
+  void reset();
+  void close();
+  inline uint64_t getRecords() const { return this->records; }
+  inline uint64_t getBytes() const { return this->bytes; }
+  inline uint64_t getChunks() const { return this->index.size(); }
+private:
+  FILE *file = nullptr;
+  vector<uint8_t> buffer;
+  TraceChunk current;
+  vector<TraceChunk> index;
+  uint64_t slots[TRACE_SLOTS];
+  uint64_t lastUse[TRACE_SLOTS];
+  uint64_t records = 0;
+  uint64_t bytes = 0;
+  void cut();
+};
+
+/* TraceReader maps a trace to memory, and decodes it chunk by chunk
+ * It has the following members:
+ *  Public:
+ *    TraceReader(const string&): Constructor, maps the file and checks the header and the index
+ *    ~TraceReader(): Unmap the file
+ *    size_t size(): The number of chunks
+ *    const TraceChunk &getChunk(size_t): The index entry of a chunk
+ *    void decode(size_t, F): Call f(address, write) on every record of a chunk
+ *  Private:
+ *    data, length (the mapping), index
+ *    void readIndex(const string&): Check the header, and read the index
+ */
+class TraceReader {
+public:
+  TraceReader(const string &path);
+  ~TraceReader();
+  inline size_t size() const { return this->index.size(); }
+  inline const TraceChunk &getChunk(size_t chunk_id) const { return this->index[chunk_id]; }
+  template <class F>
+  void decode(size_t chunk_id, F f) const {
+    const TraceChunk &chunk = this->index[chunk_id];
+    const uint8_t *p = this->data + chunk.offset;
+    uint64_t slots[TRACE_SLOTS] = {0};
+    for (uint32_t r=0; r!=chunk.records; ++r) {
+      uint64_t token = 0;
+      for (unsigned shift=0; ; shift+=7) {
+        uint8_t byte = *p++;
+        token |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          break;
+      }
+      unsigned slot = (token >> 1) & (TRACE_SLOTS - 1);
+      uint64_t zigzag = token >> (TRACE_SLOT_BITS + 1);
+      slots[slot] += (zigzag >> 1) ^ -(zigzag & 1);
+      f(slots[slot], (token & 1) != 0);
+    }
+  }
+private:
+  const uint8_t *data = nullptr;
+  size_t length = 0;
+  vector<TraceChunk> index;
+  void readIndex(const string &path);
+};
+
+/* The traces of other tools (ExternalTrace)
+ *  TRACE_DINERO: Dinero .din, a line "label address" per reference (hex address; label 0 read, 1 write, 2 instruction fetch,
+ *    3 and 4 escapes, which are skipped)
+ *  TRACE_LACKEY: the output of valgrind --tool=lackey --trace-mem=yes, a line per reference
+ *    ("I  addr,size", " L addr,size", " S addr,size", " M addr,size" (a load and a store), and "==" lines of valgrind)
+ *  TRACE_CHAMPSIM: ChampSim input_instr records (64 bytes, little-endian), one per instruction,
+ *    up to 4 source (read) and 2 destination (written) memory operands, 0 when unused
+ *  Any of them may be compressed with gzip, xz or zstd (recognized by the magic bytes, decompressed by the tool through a pipe).
+ *  An instruction without a memory reference is counted as a TRACE_COMPUTE record (an access counts its own instruction).
+ */
+enum TraceFormat { TRACE_NATIVE, TRACE_DINERO, TRACE_LACKEY, TRACE_CHAMPSIM };
+enum TraceOp : uint8_t { TRACE_READ, TRACE_WRITE, TRACE_COMPUTE };
+/* A decoded reference: the address of a read or write, or the instruction count of TRACE_COMPUTE */
+struct TraceRecord {
+  uint64_t value;
+  TraceOp op;
+};
+/* The batches of records in flight between the reader thread and the simulation */
+#define TRACE_RING_BATCHES 4
+#define TRACE_BATCH (1u<<14)
+/* The reader reads the (decompressed) file in blocks of TRACE_READ_BLOCK bytes */
+#define TRACE_READ_BLOCK (1u<<16)
+
+/* ExternalTrace reads an external trace on a thread of its own, which decompresses and parses it ahead of the simulation
+ *  into a bounded ring of TRACE_RING_BATCHES batches of up to TRACE_BATCH records
+ * It has the following members:
+ *  Public:
+ *    ExternalTrace(const string&, TraceFormat): Constructor, opens the file (or the pipe of the decompressor), starts the reader
+ *    ~ExternalTrace(): Stop the reader, and close the file
+ *    static TraceFormat formatOf(const string&): The format named by the extension (before .gz, .xz or .zst), or TRACE_NATIVE
+ *    static TraceFormat formatNamed(const string&): The format of a name given to -e (din, lackey, champsim)
+ *    const vector<TraceRecord> *acquire(): The next batch (nullptr at the end), rethrows the error of the reader
+ *    void release(): Hand the batch back to the reader
+ *  Private:
+ *    file, pipe (whether file is a pipe to the decompressor), format, the ring (batches, head, tail, filled, lock, ready, room),
+ *    done, stopping, error (of the reader), reader, and the parsing state (block, position, end, line, pending)
+ *    void read(), parse*(): The reader thread, and the parser of each format
+ */
+class ExternalTrace {
+public:
+  ExternalTrace(const string &path, TraceFormat fmt);
+  ~ExternalTrace();
+  static TraceFormat formatOf(const string &path);
+  static TraceFormat formatNamed(const string &name);
+  const vector<TraceRecord> *acquire();
+  void release();
+private:
+  FILE *file = nullptr;
+  bool pipe = false;
+  TraceFormat format;
+  vector<TraceRecord> batches[TRACE_RING_BATCHES];
+  unsigned head = 0, tail = 0, filled = 0;
+  mutex lock;
+  condition_variable ready, room;
+  bool done = false, stopping = false;
+  exception_ptr error;
+  thread reader;
+  vector<char> block;
+  size_t position = 0, end = 0;
+  uint64_t line = 0;
+  bool pending = false;
+  vector<TraceRecord> *batch = nullptr;
+  void read();
+  void parseDinero();
+  void parseLackey();
+  void parseChampSim();
+  bool fill();
+  bool nextLine(const char *&first, const char *&last);
+  void emit(uint64_t value, TraceOp op);
+  void instruction();
+  void publish();
+};
+
+/* RingQueue is a bounded lock-free queue between one producer thread and one consumer thread, of a trivially copyable type,
+ *  the capacity is a power of two, head and tail count the elements popped and pushed (the slot is the count masked),
+ *  each of them is written by one side only, and sits on a host line of its own, with the copy of the other one
+ *  that its side last read (the atomic of the other side is read only when the copy says the ring is full, or empty)
+ * It has the following members:
+ *  Public:
+ *    RingQueue(size_t): Constructor, the capacity is rounded up to a power of two
+ *    size_t push(const T*, size_t): Append up to n elements (as many as there is room for), returns how many (producer)
+ *    size_t pop(T*, size_t): Remove up to n elements (as many as there are) into out, returns how many (consumer)
+ *    void close(): No element will be pushed anymore (producer)
+ *    bool closed(): Whether the ring is closed, read it before a pop() that finds the ring empty (consumer)
+ *  Private:
+ *    items (the slots), mask (capacity-1), tail and knownHead (producer), head and knownTail (consumer), done (closed)
+ */
+template <class T>
+class RingQueue {
+public:
+  explicit RingQueue(size_t capacity) : tail(0), head(0), done(false) {
+    size_t size = 1;
+    while (size < capacity)
+      size <<= 1;
+    this->items.resize(size);
+    this->mask = size - 1;
+  }
+  size_t push(const T *first, size_t n) {
+    size_t t = this->tail.load(memory_order_relaxed);
+    if (t - this->knownHead + n > this->mask + 1)
+      this->knownHead = this->head.load(memory_order_acquire);
+    size_t room = this->mask + 1 - (t - this->knownHead);
+    if (n > room)
+      n = room;
+    for (size_t i=0; i!=n; ++i)
+      this->items[(t + i) & this->mask] = first[i];
+    this->tail.store(t + n, memory_order_release);
+    return n;
+  }
+  size_t pop(T *out, size_t n) {
+    size_t h = this->head.load(memory_order_relaxed);
+    if (this->knownTail - h < n)
+      this->knownTail = this->tail.load(memory_order_acquire);
+    size_t count = this->knownTail - h;
+    if (n > count)
+      n = count;
+    for (size_t i=0; i!=n; ++i)
+      out[i] = this->items[(h + i) & this->mask];
+    this->head.store(h + n, memory_order_release);
+    return n;
+  }
+  inline void close() { this->done.store(true, memory_order_release); }
+  inline bool closed() const { return this->done.load(memory_order_acquire); }
+private:
+  vector<T> items;
+  size_t mask = 0;
+  char padProducer[HOST_LINE_SIZE];
+  atomic<size_t> tail;
+  size_t knownHead = 0;
+  char padConsumer[HOST_LINE_SIZE];
+  atomic<size_t> head;
+  size_t knownTail = 0;
+  char padEnd[HOST_LINE_SIZE];
+  atomic<bool> done;
+};
+
+/* A checkpoint of the state of a simulation (CheckpointWriter, CheckpointReader)
+ *  The file is the magic and the version, then the values and vectors put by the components in order (native byte order),
+ *  a vector is its size (64 bits) and its elements, a string its length and its characters.
+ *  The reader reads them back in the same order: a vector is read into one of the same size (the geometry of the component
+ *  that restores it must be the one that saved it), anything else is an error.
+ */
+#define CHECKPOINT_MAGIC "CACHECKP"
+#define CHECKPOINT_VERSION 1u
+
+/* CheckpointWriter writes a checkpoint
+ * It has the following members:
+ *  Public:
+ *    CheckpointWriter(const string&): Constructor, creates the file and writes the magic
+ *    ~CheckpointWriter(): close() the file
+ *    void put(const T&), put(const vector<T>&), put(const string&): Write a value (of a trivially copyable type), a vector, a string
+ *    void write(const void*, size_t): Write bytes
+ *    void close(): Flush and close the file
+ *  Private:
+ *    file, path
+ */
+class CheckpointWriter {
+public:
+  CheckpointWriter(const string &path);
+  ~CheckpointWriter();
+  template <class T> inline void put(const T &value) { this->write(&value, sizeof(T)); }
+  template <class T> inline void put(const vector<T> &values) {
+    this->put((uint64_t)values.size());
+    this->write(values.data(), values.size() * sizeof(T)); }
+  inline void put(const string &text) { this->put((uint64_t)text.size()); this->write(text.data(), text.size()); }
+  void write(const void *bytes, size_t n);
+  void close();
+private:
+  FILE *file = nullptr;
+  string path;
+};
+
+/* CheckpointReader reads a checkpoint
+ * It has the following members:
+ *  Public:
+ *    CheckpointReader(const string&): Constructor, opens the file and checks the magic and the version
+ *    ~CheckpointReader(): Close the file
+ *    void get(T&), get(vector<T>&), get(string&): Read a value, a vector (of the size of the one given), a string
+ *    void read(void*, size_t): Read bytes (a checkpoint cut short is an error)
+ *    static void mismatch(): Throw the error of a checkpoint taken on another simulation
+ *  Private:
+ *    file, path
+ */
+class CheckpointReader {
+public:
+  CheckpointReader(const string &path);
+  ~CheckpointReader();
+  template <class T> inline void get(T &value) { this->read(&value, sizeof(T)); }
+  template <class T> inline void get(vector<T> &values) {
+    uint64_t size;
+    this->get(size);
+    if (size != values.size())
+      mismatch();
+    this->read(values.data(), values.size() * sizeof(T)); }
+  void get(string &text);
+  void read(void *bytes, size_t n);
+  static void mismatch();
+private:
+  FILE *file = nullptr;
+  string path;
 };
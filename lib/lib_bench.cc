@@ -0,0 +1,65 @@
+/* ./lib/lib_bench.cc
+ * The micro-benchmark for the library:
+ *  times TagArray lookups with each tag comparison kernel, for associativities 1 to 1024 */
+
+#define BENCH_TAGS (1u<<16)
+#define BENCH_LOOKUPS (1u<<22)
+
+#include "containers.hh"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+using namespace::std;
+
+int main() {
+  const TagKernel kernels[] = {TAG_SCALAR, TAG_SSE2, TAG_AVX2, TAG_AVX512};
+
+  cout << "---TagArray lookup benchmark (ns per lookup, half hits)---" << endl;
+  cout << setw(8) << "ways";
+  for (auto k : kernels)
+    cout << setw(10) << TagArray::kernelName(k);
+  cout << setw(10) << "auto" << endl;
+
+  for (unsigned ways=1; ways<=1024; ways*=2) {
+    // Keep the array at BENCH_TAGS tags, so every associativity has the same footprint
+    unsigned sets = BENCH_TAGS / ways;
+    TagArray tags(sets, ways);
+    srand(ways);
+    for (unsigned s=0; s!=sets; ++s)
+      for (unsigned w=0; w!=ways; ++w)
+        tags.set(s, w, s*ways + w);
+
+    // The lookups: a random set, and a tag that hits half of the time
+    vector<unsigned> qsets(BENCH_LOOKUPS), qtags(BENCH_LOOKUPS);
+    for (unsigned i=0; i!=BENCH_LOOKUPS; ++i) {
+      qsets[i] = rand() % sets;
+      qtags[i] = rand() % 2 ? qsets[i]*ways + rand() % ways : BENCH_TAGS + i;
+    }
+
+    cout << setw(8) << ways;
+    unsigned long check = 0;
+    for (auto k : kernels) {
+      tags.setKernel(k);
+      if (tags.getKernel() != k) {
+        cout << setw(10) << "n/a";
+        continue;
+      }
+      auto start = chrono::steady_clock::now();
+      for (unsigned i=0; i!=BENCH_LOOKUPS; ++i)
+        check += tags.find(qsets[i], qtags[i]);
+      auto stop = chrono::steady_clock::now();
+      double ns = chrono::duration<double, nano>(stop - start).count() / BENCH_LOOKUPS;
+      cout << setw(10) << fixed << setprecision(2) << ns;
+    }
+    tags.setKernel(TAG_AUTO);
+    cout << setw(10) << TagArray::kernelName(tags.getKernel());
+    // Print the checksum so the lookups are not optimized away
+    cout << "  (checksum " << check << ")" << endl;
+  }
+
+  cout << "---TagArray lookup benchmark complete---" << endl;
+
+  return 0;
+}
@@ -3,12 +3,558 @@
 
 #define TEST_SIZE 3
 #define TEST_ARRAY 10
+#define TEST_RANDOM_OPS 200000
+#define TEST_STACK_BLOCKS 256
+#define TEST_STACK_ACCESSES 20000
+#define TEST_TRACE_ACCESSES 300000
+#define TEST_EXTERNAL_LINES 200000
+#define TEST_RING_ITEMS 1000000
+#define TEST_RING_CAPACITY 64
+#define TEST_CHECKPOINT_OPS 20000
+#define TEST_CLASSIFY_BLOCKS 100
+#define TEST_POLICY_SETS 128
 
-#include "containers.hh"
+#include "policies.hh"
 #include <iostream>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
 
 using namespace::std;
 
+/* The previous BlockLRU (a list of block_ids per set, with an unordered_map for fast indexing),
+ *  kept as the reference of the randomized BlockLRU test */
+class ReferenceLRU {
+public:
+  ReferenceLRU(unsigned n_sets) : lists(n_sets), maps(n_sets) {}
+  unsigned pop(unsigned set_id) {
+    unsigned ret = this->lists[set_id].back();
+    this->lists[set_id].pop_back();
+    this->maps[set_id].erase(ret);
+    return ret;
+  }
+  void update(unsigned set_id, unsigned block_id) {
+    this->lists[set_id].erase(this->maps[set_id][block_id]);
+    this->push(set_id, block_id);
+  }
+  void push(unsigned set_id, unsigned block_id) {
+    this->lists[set_id].push_front(block_id);
+    this->maps[set_id][block_id] = this->lists[set_id].begin();
+  }
+  inline size_t size(unsigned set_id) const { return this->lists[set_id].size(); }
+  inline bool contains(unsigned set_id, unsigned block_id) const { return this->maps[set_id].count(block_id) != 0; }
+private:
+  vector<list<unsigned>> lists;
+  vector<unordered_map<unsigned, list<unsigned>::iterator>> maps;
+};
+
+/* Run random push/update/pop sequences on BlockLRU and ReferenceLRU, return the number of mismatching pops */
+unsigned crossCheckLRU(unsigned n_sets, unsigned n_ways) {
+  BlockLRU ql(n_sets, n_ways);
+  ReferenceLRU ref(n_sets);
+  unsigned mismatches = 0;
+
+  for (unsigned op=0; op!=TEST_RANDOM_OPS; ++op) {
+    unsigned set_id = rand() % n_sets;
+    unsigned block_id = rand() % n_ways;
+    unsigned action = rand() % 4;
+
+    if (ref.contains(set_id, block_id) && action != 0) {
+      // Hit: update the priority
+      ql.update(set_id, block_id);
+      ref.update(set_id, block_id);
+    } else if (!ref.contains(set_id, block_id)) {
+      // Miss: evict when the set is full, then insert
+      if (ref.size(set_id) == n_ways && ql.pop(set_id) != ref.pop(set_id))
+        ++mismatches;
+      if (!ref.contains(set_id, block_id)) {
+        ql.push(set_id, block_id);
+        ref.push(set_id, block_id);
+      }
+    } else if (ref.size(set_id) != 0 && ql.pop(set_id) != ref.pop(set_id)) {
+      // Evict without a refill
+      ++mismatches;
+    }
+  }
+
+  // Drain the sets in LRU order
+  for (unsigned set_id=0; set_id!=n_sets; ++set_id)
+    while (ref.size(set_id) != 0)
+      if (ql.pop(set_id) != ref.pop(set_id))
+        ++mismatches;
+
+  return mismatches;
+}
+
+/* Measure a random stream with StackDistance, and simulate it on ReferenceLRU for every cache of up to TEST_STACK_BLOCKS blocks,
+ *  return the number of caches with mismatching misses */
+unsigned crossCheckStack() {
+  StackDistance distances(TEST_STACK_BLOCKS, TEST_STACK_BLOCKS);
+  vector<unsigned> stream(TEST_STACK_ACCESSES);
+  for (auto &block : stream)
+    // Half of the accesses go to a few hot blocks, the rest to 4 times as many blocks as the largest cache
+    block = rand() % 2 ? rand() % (TEST_STACK_BLOCKS / 2) : rand() % (4 * TEST_STACK_BLOCKS);
+  for (auto block : stream)
+    distances.access(block, false);
+
+  unsigned mismatches = 0;
+  for (unsigned blocks=1; blocks<=TEST_STACK_BLOCKS; blocks*=2)
+    for (unsigned ways=1; ways<=blocks; ways*=2) {
+      unsigned n_sets = blocks / ways;
+      ReferenceLRU ref(n_sets);
+      uint64_t misses = 0;
+      for (auto block : stream) {
+        unsigned set_id = block % n_sets;
+        if (ref.contains(set_id, block))
+          ref.update(set_id, block);
+        else {
+          ++misses;
+          if (ref.size(set_id) == ways)
+            ref.pop(set_id);
+          ref.push(set_id, block);
+        }
+      }
+      mismatches += misses != distances.misses(n_sets, ways, false);
+    }
+  return mismatches;
+}
+
+/* The RRIP policies and LFU of policies.hh written plainly, one value per way (an RRPV, or an access count),
+ *  kept as the reference of the randomized policy test:
+ *  an RRIP victim is the first distant way, after aging the whole set one step at a time until there is one,
+ *  BRRIP fills long once every BRRIP_EPSILON fills, DRRIP duels a SRRIP and a BRRIP leader in every region of sets
+ *  on a selector saturating at 0 and PSEL_MAX, and the LFU victim is the lowest (count, way) */
+class ReferencePolicy {
+public:
+  ReferencePolicy(const string &policy, unsigned n_sets, unsigned n_ways)
+    : name(policy), numWays(n_ways), values((size_t)n_sets * n_ways, 0) {
+    this->maxRRPV = name == "NRU" ? 1 : 3;
+    this->region = max(2u, n_sets / DUEL_LEADERS);
+  }
+  void touch(unsigned set_id, unsigned way) {
+    unsigned &value = this->values[(size_t)set_id*this->numWays + way];
+    value = this->name == "LFU" ? value + 1 : 0;
+  }
+  void insert(unsigned set_id, unsigned way) {
+    unsigned &value = this->values[(size_t)set_id*this->numWays + way];
+    bool bimodal = this->name == "BRRIP";
+    if (this->name == "DRRIP") {
+      if (set_id % this->region == 0)
+        this->psel = min(this->psel + 1, PSEL_MAX);
+      else if (set_id % this->region == 1)
+        this->psel = max(this->psel - 1, 0);
+      bimodal = set_id % this->region == 1 || (set_id % this->region != 0 && this->psel > PSEL_MAX / 2);
+    }
+    if (this->name == "LFU")
+      value = 1;
+    else if (this->name == "NRU")
+      value = 0;
+    else if (bimodal)
+      value = ++this->fills % BRRIP_EPSILON == 0 ? 2 : 3;
+    else
+      value = 2;
+  }
+  unsigned victim(unsigned set_id) {
+    unsigned *row = this->values.data() + (size_t)set_id*this->numWays;
+    if (this->name == "LFU")
+      return min_element(row, row + this->numWays) - row;
+    for (;;) {
+      for (unsigned way=0; way!=this->numWays; ++way)
+        if (row[way] == this->maxRRPV)
+          return way;
+      for (unsigned way=0; way!=this->numWays; ++way)
+        ++row[way];
+    }
+  }
+private:
+  string name;
+  unsigned numWays, maxRRPV, region;
+  vector<unsigned> values;
+  int psel = PSEL_MAX / 2;
+  unsigned fills = 0;
+};
+
+/* Run a random stream on a cache of a policy and of ReferencePolicy, return the number of mismatching victims;
+ *  the stream goes in fifths to the follower sets of DRRIP (its selector stays at PSEL_MAX/2, they fill as SRRIP),
+ *  to the SRRIP leader sets (the selector saturates at PSEL_MAX), to every set, to the BRRIP leader sets
+ *  (it saturates at 0), then to every set again */
+template <class Policy>
+unsigned crossCheckPolicy(unsigned n_ways) {
+  const unsigned n_sets = TEST_POLICY_SETS, region = max(2u, n_sets / DUEL_LEADERS);
+  Policy policy;
+  policy.initialize(n_sets, n_ways);
+  ReferencePolicy ref(Policy::name(), n_sets, n_ways);
+  vector<uint64_t> blocks((size_t)n_sets * n_ways, UINT64_MAX);
+  unsigned mismatches = 0;
+
+  for (unsigned op=0; op!=TEST_RANDOM_OPS; ++op) {
+    unsigned phase = op / (TEST_RANDOM_OPS / 5);
+    unsigned set_id = rand() % n_sets;
+    if (phase == 0)
+      set_id = set_id / region * region + 2 + rand() % (region - 2);
+    else if (phase == 1 || phase == 3)
+      set_id = set_id / region * region + (phase == 3);
+    // Twice as many blocks as the ways of the set, about half of the accesses hit
+    uint64_t block = (uint64_t)(rand() % (2 * n_ways)) * n_sets + set_id;
+    uint64_t *row = blocks.data() + (size_t)set_id*n_ways;
+    unsigned way = find(row, row + n_ways, block) - row;
+    if (way != n_ways) {
+      policy.touch(set_id, way);
+      ref.touch(set_id, way);
+      continue;
+    }
+    way = find(row, row + n_ways, UINT64_MAX) - row;
+    if (way == n_ways) {
+      way = policy.victim(set_id);
+      mismatches += ref.victim(set_id) != way;
+    }
+    row[way] = block;
+    policy.insert(set_id, way);
+    ref.insert(set_id, way);
+  }
+  return mismatches;
+}
+
+/* Write a random stream (strides, random jumps, resets and instruction counts) to a trace, and read it back,
+ *  return the number of records (and chunks) that differ */
+unsigned roundTripTrace() {
+  const string path = "lib_test.trace";
+  vector<pair<uint64_t, bool>> stream(TEST_TRACE_ACCESSES);
+  uint64_t address = 0;
+  for (auto &access : stream) {
+    // Mostly strided accesses around a few bases, sometimes anywhere below 2^40
+    address = rand() % 8 ? address + 8 * (rand() % 4) - 8 : (uint64_t)rand() << 9;
+    access = make_pair(address, rand() % 3 == 0);
+  }
+
+  unsigned differences = 0;
+  {
+    TraceWriter writer(path);
+    for (size_t i=0; i!=stream.size(); ++i) {
+      if (i == stream.size() / 2) {
+        writer.instructions(12345);
+        writer.reset();
+      }
+      writer.append(stream[i].first, stream[i].second);
+    }
+    writer.close();
+    differences += writer.getRecords() != stream.size();
+  }
+
+  TraceReader reader(path);
+  size_t i = 0;
+  bool sawReset = false;
+  for (size_t c=0; c!=reader.size(); ++c) {
+    const TraceChunk &chunk = reader.getChunk(c);
+    if (chunk.flags & TRACE_RESET) {
+      // The reset cuts the chunk at the middle of the stream, and the instructions go with the chunk before it
+      sawReset = true;
+      differences += i != stream.size() / 2 || c == 0 || reader.getChunk(c-1).instructions != 12345;
+    }
+    reader.decode(c, [&](uint64_t a, bool w) {
+      differences += i >= stream.size() || stream[i].first != a || stream[i].second != w;
+      ++i;
+    });
+  }
+  differences += i != stream.size() || !sawReset;
+  remove(path.c_str());
+  return differences;
+}
+
+/* Read the whole of an external trace into a vector */
+vector<TraceRecord> readExternal(const string &path, TraceFormat format) {
+  vector<TraceRecord> records;
+  ExternalTrace trace(path, format);
+  while (const vector<TraceRecord> *batch = trace.acquire()) {
+    records.insert(records.end(), batch->begin(), batch->end());
+    trace.release();
+  }
+  return records;
+}
+
+/* Compare the records read from a trace to the expected ones, return 1 if they differ */
+unsigned compareRecords(const vector<TraceRecord> &records, const vector<TraceRecord> &expected) {
+  if (records.size() != expected.size())
+    return 1;
+  for (size_t i=0; i!=records.size(); ++i)
+    if (records[i].value != expected[i].value || records[i].op != expected[i].op)
+      return 1;
+  return 0;
+}
+
+/* Read the same references from a Dinero, a lackey, a ChampSim and a gzipped Dinero trace,
+ *  and close a long trace before its end, return the number of traces read wrong */
+unsigned readExternalTraces() {
+  // An instruction without an access, a read, an instruction with a read and a write (M in lackey), a write, the last instruction
+  const vector<TraceRecord> expected = {{1, TRACE_COMPUTE}, {0x1000, TRACE_READ}, {0x2008, TRACE_READ},
+    {0x2008, TRACE_WRITE}, {0x7ff000398, TRACE_WRITE}, {1, TRACE_COMPUTE}};
+  unsigned wrong = 0;
+
+  ofstream("lib_test.din") << "2 400000\n2 400004\n0 1000\n2 400008\n0 2008\n1 2008\n1 7ff000398\n2 40000c";
+  ofstream("lib_test.lackey") << "==1== Lackey\nI  00400000,4\nI  00400004,4\n L 00001000,8\n"
+    "I  00400008,4\n M 00002008,8\n S 7ff000398,8\nI  0040000c,4\n==1== done\n";
+  {
+    ofstream champsim("lib_test.champsim", ios::binary);
+    const uint64_t operands[][6] = {{0, 0, 0, 0, 0, 0}, {0, 0, 0x1000, 0, 0, 0}, {0x2008, 0, 0x2008, 0, 0, 0},
+      {0x7ff000398, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}};
+    for (auto &instr : operands) {
+      char record[64];
+      memset(record, 0, sizeof(record));
+      memcpy(record + 16, instr, sizeof(instr));
+      champsim.write(record, sizeof(record));
+    }
+  }
+  wrong += compareRecords(readExternal("lib_test.din", TRACE_DINERO), expected);
+  wrong += compareRecords(readExternal("lib_test.lackey", ExternalTrace::formatOf("lib_test.lackey")), expected);
+  wrong += compareRecords(readExternal("lib_test.champsim", TRACE_CHAMPSIM), expected);
+  if (system("gzip -f lib_test.din") == 0) {
+    wrong += compareRecords(readExternal("lib_test.din.gz", ExternalTrace::formatOf("lib_test.din.gz")), expected);
+    remove("lib_test.din.gz");
+  }
+
+  // A trace longer than the ring, closed after its first batch (the reader must not block)
+  {
+    ofstream din("lib_test.din");
+    for (unsigned i=0; i!=TEST_EXTERNAL_LINES; ++i)
+      din << i % 2 << " " << hex << i * 8 << "\n";
+  }
+  {
+    ExternalTrace trace("lib_test.din", TRACE_DINERO);
+    const vector<TraceRecord> *batch = trace.acquire();
+    wrong += !batch || batch->size() != TRACE_BATCH || (*batch)[1].value != 8 || (*batch)[1].op != TRACE_WRITE;
+  }
+
+  remove("lib_test.din");
+  remove("lib_test.lackey");
+  remove("lib_test.champsim");
+  return wrong;
+}
+
+/* Fill sets of every associativity with tags that differ only above their low 32 bits, and find them with every kernel,
+ *  return the number of lookups that found the wrong way */
+unsigned findWideTags() {
+  unsigned wrong = 0;
+  for (unsigned ways : {1u, 2u, 3u, 8u, 13u, 64u})
+    for (TagKernel k : {TAG_SCALAR, TAG_SSE2, TAG_AVX2, TAG_AVX512}) {
+      TagArray tags(2, ways);
+      tags.setKernel(k);
+      for (unsigned way=0; way+1<ways; ++way)
+        tags.set(1, way, (Tag)(way + 1) << 32 | 0x1234);
+      for (unsigned way=0; way+1<ways; ++way)
+        wrong += tags.find(1, (Tag)(way + 1) << 32 | 0x1234) != way;
+      // The low 32 bits alone, a tag of another set, and the last (invalid) way
+      wrong += tags.find(1, 0x1234) != ways;
+      wrong += tags.find(0, (Tag)1 << 32 | 0x1234) != ways;
+      wrong += tags.findInvalid(1) != ways - 1;
+    }
+  return wrong;
+}
+
+/* Stream TEST_RING_ITEMS numbers through a small RingQueue, pushed and popped in chunks of varying sizes by two threads,
+ *  return the number of elements popped out of order (or missing) */
+unsigned streamRing() {
+  RingQueue<uint64_t> ring(TEST_RING_CAPACITY);
+  thread producer([&ring] {
+    vector<uint64_t> chunk;
+    for (uint64_t next=0; next!=TEST_RING_ITEMS; ) {
+      chunk.clear();
+      for (uint64_t i=0; i!=1+next%37 && next!=TEST_RING_ITEMS; ++i)
+        chunk.push_back(next++);
+      for (size_t done=0; (done += ring.push(chunk.data() + done, chunk.size() - done)) != chunk.size(); )
+        this_thread::yield();
+    }
+    ring.close();
+  });
+  unsigned wrong = 0;
+  uint64_t expected = 0;
+  uint64_t out[TEST_RING_CAPACITY];
+  for (;;) {
+    bool closed = ring.closed();
+    size_t n = ring.pop(out, 1 + expected%29);
+    if (n == 0 && closed)
+      break;
+    if (n == 0)
+      this_thread::yield();
+    for (size_t i=0; i!=n; ++i)
+      wrong += out[i] != expected++;
+  }
+  producer.join();
+  return wrong + (expected != TEST_RING_ITEMS);
+}
+
+/* Checkpoint a BlockLRU, a BlockQueues and a TagArray after a random stream, restore them into empty ones of the same geometry,
+ *  return the number of differences between the victims (and tags) of the originals and the restored ones,
+ *  and of the checkpoints restored into another geometry without an error */
+unsigned checkpointContainers() {
+  const string path = "lib_test.checkpoint";
+  const unsigned n_sets = 4, n_ways = 8;
+  BlockLRU lru(n_sets, n_ways), lruBack(n_sets, n_ways), lruOther(2*n_sets, n_ways);
+  BlockQueues fifo, fifoBack;
+  fifo.initialize(n_sets);
+  fifoBack.initialize(n_sets);
+  TagArray tags(n_sets, n_ways), tagsBack(n_sets, n_ways);
+  vector<unsigned> filled(n_sets, 0);
+  for (unsigned i=0; i!=TEST_CHECKPOINT_OPS; ++i) {
+    unsigned set_id = rand() % n_sets;
+    if (filled[set_id] != n_ways) {
+      lru.push(set_id, filled[set_id]);
+      fifo.push(set_id, filled[set_id]);
+      ++filled[set_id];
+    } else if (rand() % 2)
+      lru.update(set_id, rand() % n_ways);
+    else {
+      unsigned block_id = lru.pop(set_id);
+      lru.push(set_id, block_id);
+      fifo.push(set_id, fifo.pop(set_id));
+    }
+    tags.set(set_id, rand() % n_ways, (Tag)rand() << 20);
+  }
+
+  {
+    CheckpointWriter writer(path);
+    lru.save(writer);
+    fifo.save(writer);
+    tags.save(writer);
+    writer.close();
+  }
+  unsigned differences = 0;
+  {
+    CheckpointReader reader(path);
+    lruBack.restore(reader);
+    fifoBack.restore(reader);
+    tagsBack.restore(reader);
+  }
+  for (unsigned set_id=0; set_id!=n_sets; ++set_id)
+    for (unsigned way=0; way!=n_ways; ++way) {
+      differences += tags.get(set_id, way) != tagsBack.get(set_id, way);
+      differences += lru.pop(set_id) != lruBack.pop(set_id);
+      differences += fifo.pop(set_id) != fifoBack.pop(set_id);
+    }
+  try {
+    CheckpointReader reader(path);
+    lruOther.restore(reader);
+    ++differences;
+  } catch (runtime_error &) {
+  }
+  remove(path.c_str());
+  return differences;
+}
+
+/* Feed every prefetcher a short pattern (blocks of 64 bytes), return the number of candidates that differ from the expected ones,
+ *  and of the names that should not resolve but did */
+unsigned testPrefetchers() {
+  unsigned wrong = 0;
+  auto expect = [&wrong](Prefetcher &p, vector<uint64_t> blocks) {
+    wrong += p.candidates != blocks;
+    p.candidates.clear();
+  };
+  // Next-line: a miss and the first hit on a prefetched block trigger it, a plain hit does not
+  unique_ptr<Prefetcher> next = Prefetcher::create(PREFETCH_NEXT_LINE, 2, 64);
+  next->access(10*64, true, false);
+  expect(*next, {11, 12});
+  next->access(11*64, false, false);
+  expect(*next, {});
+  next->access(11*64 + 8, false, true);
+  expect(*next, {12, 13});
+  // Stride: a stride of 800 bytes is confident on its third repeat, and prefetched two strides ahead
+  unique_ptr<Prefetcher> stride = Prefetcher::create(PREFETCH_STRIDE, 2, 64);
+  for (uint64_t address=0; address!=2400; address+=800) {
+    stride->access(address, true, false);
+    expect(*stride, {});
+  }
+  stride->access(2400, true, false);
+  expect(*stride, {3200/64, 4000/64});
+  // Stream buffers: a miss starts a stream, a miss on its second block takes it, and the buffer fetches two more
+  unique_ptr<Prefetcher> stream = Prefetcher::create(PREFETCH_STREAM, 3, 64);
+  uint64_t issued = 0;
+  stream->access(100*64, true, false);
+  expect(*stream, {101, 102, 103});
+  wrong += !stream->buffered() || !stream->supply(102, issued) || issued != 1;
+  expect(*stream, {104, 105});
+  wrong += stream->supply(500, issued);
+  // Delta correlation: the deltas 1, 4 repeat, the two after the last pair are replayed
+  unique_ptr<Prefetcher> delta = Prefetcher::create(PREFETCH_DELTA, 2, 64);
+  for (uint64_t block : {0, 1, 5, 6, 10}) {
+    delta->access(block*64, true, false);
+    delta->candidates.clear();
+  }
+  delta->access(11*64, true, false);
+  expect(*delta, {15, 16});
+  // Names
+  wrong += Prefetcher::create(PREFETCH_NONE, 1, 64) != nullptr;
+  try {
+    Prefetcher::kindNamed("bogus");
+    ++wrong;
+  } catch (runtime_error &) {
+  }
+  return wrong;
+}
+
+/* Classify a random stream with MissClassifier, and with ReferenceLRU (a single set, as the shadow) and the set of the blocks touched,
+ *  a few blocks are above CLASSIFY_DENSE_BLOCKS, some accesses do not fill, and the shadow is reset halfway;
+ *  return the number of accesses of mismatching classes */
+unsigned crossCheckClassifier() {
+  MissClassifier classifier(TEST_CLASSIFY_BLOCKS);
+  ReferenceLRU ref(1);
+  unordered_map<unsigned, bool> touched;
+  unsigned mismatches = 0;
+
+  for (unsigned op=0; op!=TEST_RANDOM_OPS; ++op) {
+    if (op == TEST_RANDOM_OPS / 2) {
+      classifier.reset();
+      ref = ReferenceLRU(1);
+      touched.clear();
+    }
+    unsigned block = rand() % 2 ? rand() % TEST_CLASSIFY_BLOCKS : rand() % (4 * TEST_CLASSIFY_BLOCKS);
+    if (rand() % 8 == 0)
+      block += CLASSIFY_DENSE_BLOCKS;
+    bool fill = rand() % 4 != 0;
+
+    MissKind expected = MISS_CONFLICT;
+    if (ref.contains(0, block))
+      ref.update(0, block);
+    else {
+      expected = touched[block] ? MISS_CAPACITY : MISS_COMPULSORY;
+      touched[block] = true;
+      if (fill) {
+        if (ref.size(0) == TEST_CLASSIFY_BLOCKS)
+          ref.pop(0);
+        ref.push(0, block);
+      }
+    }
+    mismatches += classifier.classify(block, fill) != expected;
+  }
+  return mismatches;
+}
+
+/* VictimCache of 2 entries: the blocks leave it in LRU order (with their dirty bit), a block taken frees its entry,
+ *  return the number of wrong answers */
+unsigned testVictimCache() {
+  VictimCache victims(2);
+  unsigned wrong = 0;
+  uint64_t evicted = 0;
+  bool evictedDirty = false;
+  wrong += victims.insert(10, true, evicted, evictedDirty);
+  wrong += victims.insert(11, false, evicted, evictedDirty);
+  wrong += victims.find(12) != victims.size();
+  // 10 is used, 11 is the least recently used one
+  victims.touch(victims.find(10));
+  wrong += !victims.insert(12, false, evicted, evictedDirty) || evicted != 11 || evictedDirty;
+  wrong += victims.find(11) != victims.size();
+  // 10 is taken back (dirty), its entry is free for 13
+  wrong += !victims.take(victims.find(10));
+  wrong += victims.insert(13, false, evicted, evictedDirty);
+  wrong += !victims.insert(14, true, evicted, evictedDirty) || evicted != 12;
+  victims.reset();
+  wrong += victims.find(13) != victims.size() || victims.find(14) != victims.size();
+  return wrong;
+}
+
 int main() {
   /* Part 1: BlockQueues */
 
@@ -26,6 +572,11 @@ int main() {
   // Show the memory status
   qs.show();
 
+  // Remove a block from the middle of a queue
+  cout << "Removing 3 from set 0\n";
+  qs.remove(0, 3);
+  qs.show();
+
   // Pop the elements
   cout << "Popping out the elements\n";
   for (unsigned i=0; i<TEST_SIZE; ++i) {
@@ -43,7 +594,7 @@ int main() {
 
   // Initialize the queues
   BlockLRU ql;
-  ql.initialize(TEST_SIZE);
+  ql.initialize(TEST_SIZE, TEST_ARRAY);
 
   cout << "Putting 0 to " << TEST_ARRAY-1 << " into the BlockLRU" << endl;
 
@@ -61,6 +612,11 @@ int main() {
 
   ql.show();
 
+  // Remove a block from the middle of a list
+  cout << "Removing 6 from set 0\n";
+  ql.remove(0, 6);
+  ql.show();
+
   // Pop the elements
   cout << "Popping out the elements\n";
   for (unsigned i=0; i<TEST_SIZE; ++i) {
@@ -69,6 +625,172 @@ int main() {
 
   cout << "---BlockLRU test complete---" << endl;
 
-  return 0;
+  /* Part 3: BlockLRU against the list-based reference, on random sequences */
+
+  cout << "\n---BlockLRU randomized test start---" << endl;
+
+  unsigned failures = 0;
+  const unsigned geometries[][2] = {{1, 1}, {4, 2}, {16, 4}, {8, 16}, {1, 1024}};
+  srand(TEST_RANDOM_OPS);
+  for (auto &g : geometries) {
+    unsigned mismatches = crossCheckLRU(g[0], g[1]);
+    cout << "Sets " << g[0] << " ways " << g[1] << ": " << (mismatches ? "FAIL" : "pass");
+    cout << " (" << mismatches << " mismatching pops)\n";
+    failures += mismatches != 0;
+  }
+
+  cout << "---BlockLRU randomized test complete---" << endl;
+
+  /* Part 4: BlockPLRU, BlockRRIP and BlockHeap (one set of 4 blocks) */
+
+  cout << "\n---BlockPLRU/BlockRRIP/BlockHeap test start---" << endl;
+
+  BlockPLRU tree(1, 4);
+  for (unsigned i=0; i<4; ++i)
+    tree.update(0, i);
+  unsigned first = tree.victim(0);
+  tree.update(0, 0);
+  unsigned second = tree.victim(0);
+  cout << "PLRU: victims after using 0 to 3: " << first << ", then after using 0: " << second << "\n";
+  failures += first != 0 || second != 2;
+
+  BlockRRIP rrip;
+  rrip.initialize(1, 4, 3);
+  const unsigned rrpvs[] = {0, 2, 1, 0};
+  for (unsigned i=0; i<4; ++i)
+    rrip.set(0, i, rrpvs[i]);
+  unsigned distant = rrip.victim(0);
+  cout << "RRIP: victim of RRPVs 0 2 1 0: " << distant << ", RRPVs after aging:";
+  for (unsigned i=0; i<4; ++i)
+    cout << " " << rrip.get(0, i);
+  cout << "\n";
+  failures += distant != 1 || rrip.get(0, 0) != 1 || rrip.get(0, 1) != 3 || rrip.get(0, 2) != 2;
+
+  BlockHeap heap(1, 4);
+  const unsigned counts[] = {3, 2, 1, 2};
+  for (unsigned i=0; i<4; ++i)
+    heap.setKey(0, i, counts[i]);
+  unsigned rare = heap.top(0);
+  heap.setKey(0, rare, 3);
+  cout << "Heap: top of keys 3 2 1 2: " << rare << ", then of keys 3 2 3 2: " << heap.top(0) << "\n";
+  failures += rare != 2 || heap.top(0) != 1;
+
+  cout << "---BlockPLRU/BlockRRIP/BlockHeap test complete (" << (failures ? "FAIL" : "pass") << ")---" << endl;
+
+  // The policies on them, against the reference (4 ways, and 40 ways over two words of RRPVs)
+  cout << "\n---Policy test start---" << endl;
+  unsigned victims = 0;
+  for (unsigned ways : {4u, 40u}) {
+    unsigned nru = crossCheckPolicy<NRUPolicy>(ways), srrip = crossCheckPolicy<SRRIPPolicy>(ways);
+    unsigned brrip = crossCheckPolicy<BRRIPPolicy>(ways), drrip = crossCheckPolicy<DRRIPPolicy>(ways);
+    unsigned lfu = crossCheckPolicy<LFUPolicy>(ways);
+    cout << ways << " ways, mismatching victims: NRU " << nru << ", SRRIP " << srrip << ", BRRIP " << brrip
+         << ", DRRIP " << drrip << ", LFU " << lfu << "\n";
+    victims += nru + srrip + brrip + drrip + lfu;
+  }
+  /* NRU ages on one bit: with every way recent, the victim search marks them all not recent and takes way 0,
+   *  the next fills then take the ways in order (a clock), until every way is recent again */
+  NRUPolicy nru;
+  nru.initialize(1, 4);
+  for (unsigned way=0; way!=4; ++way)
+    nru.insert(0, way);
+  string nruVictims;
+  for (unsigned fill=0; fill!=8; ++fill) {
+    unsigned way = nru.victim(0);
+    nruVictims += char('0' + way);
+    nru.insert(0, way);
+  }
+  bool nruPass = nruVictims == "01230123";
+  cout << "NRU victims: " << nruVictims << " (" << (nruPass ? "pass" : "FAIL") << ")\n";
+  failures += victims != 0 || !nruPass;
+  cout << "---Policy test complete (" << (victims || !nruPass ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 5: NextUse, the next use of every access of a short stream */
+  cout << "\n---NextUse test start---" << endl;
+  NextUse stream;
+  const uint64_t accesses[] = {7, 3, 7, 9, 3, 7};
+  const uint64_t expected[] = {2, 4, 5, NextUse::NEVER, NextUse::NEVER, NextUse::NEVER, NextUse::NEVER};
+  for (auto block : accesses)
+    stream.record(block);
+  stream.finish();
+  unsigned wrong = 0;
+  cout << "Next uses of 7 3 7 9 3 7 (and past the end):";
+  for (auto e : expected) {
+    uint64_t next = stream.next();
+    wrong += next != e;
+    if (next == NextUse::NEVER)
+      cout << " never";
+    else
+      cout << " " << next;
+  }
+  cout << "\n";
+  failures += wrong != 0;
+
+  cout << "---NextUse test complete (" << (wrong ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 6: StackDistance against ReferenceLRU, for every cache of up to TEST_STACK_BLOCKS blocks */
+  cout << "\n---StackDistance test start---" << endl;
+  unsigned caches = crossCheckStack();
+  cout << "Caches with mismatching misses: " << caches << "\n";
+  failures += caches != 0;
+  cout << "---StackDistance test complete (" << (caches ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 7: TraceWriter and TraceReader, a round trip of a random stream */
+  cout << "\n---Trace test start---" << endl;
+  unsigned differences = roundTripTrace();
+  cout << "Differences after the round trip: " << differences << "\n";
+  failures += differences != 0;
+  cout << "---Trace test complete (" << (differences ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 8: ExternalTrace, the same references in every format */
+  cout << "\n---ExternalTrace test start---" << endl;
+  unsigned misread = readExternalTraces();
+  cout << "Traces read wrong: " << misread << "\n";
+  failures += misread != 0;
+  cout << "---ExternalTrace test complete (" << (misread ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 9: TagArray, 64-bit tags with every kernel */
+  cout << "\n---TagArray test start---" << endl;
+  unsigned lookups = findWideTags();
+  cout << "Wrong lookups: " << lookups << "\n";
+  failures += lookups != 0;
+  cout << "---TagArray test complete (" << (lookups ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 10: RingQueue, a stream between two threads */
+  cout << "\n---RingQueue test start---" << endl;
+  unsigned disordered = streamRing();
+  cout << "Elements out of order: " << disordered << "\n";
+  failures += disordered != 0;
+  cout << "---RingQueue test complete (" << (disordered ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 11: CheckpointWriter and CheckpointReader, a round trip of the replacement state and the tags */
+  cout << "\n---Checkpoint test start---" << endl;
+  unsigned restoredWrong = checkpointContainers();
+  cout << "Differences after the round trip: " << restoredWrong << "\n";
+  failures += restoredWrong != 0;
+  cout << "---Checkpoint test complete (" << (restoredWrong ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 12: the prefetchers, the candidates of a short pattern */
+  cout << "\n---Prefetcher test start---" << endl;
+  unsigned prefetchWrong = testPrefetchers();
+  cout << "Wrong candidates: " << prefetchWrong << "\n";
+  failures += prefetchWrong != 0;
+  cout << "---Prefetcher test complete (" << (prefetchWrong ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 13: MissClassifier against ReferenceLRU and the blocks touched, on a random stream */
+  cout << "\n---MissClassifier test start---" << endl;
+  unsigned misclassified = crossCheckClassifier();
+  cout << "Misclassified accesses: " << misclassified << "\n";
+  failures += misclassified != 0;
+  cout << "---MissClassifier test complete (" << (misclassified ? "FAIL" : "pass") << ")---" << endl;
+
+  /* Part 14: VictimCache, the order and the dirty bits of the blocks of a short sequence */
+  cout << "\n---VictimCache test start---" << endl;
+  unsigned victimWrong = testVictimCache();
+  cout << "Wrong answers: " << victimWrong << "\n";
+  failures += victimWrong != 0;
+  cout << "---VictimCache test complete (" << (victimWrong ? "FAIL" : "pass") << ")---" << endl;
+
+  return failures != 0;
 
 }
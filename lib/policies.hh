@@ -0,0 +1,257 @@
+#include <cstdlib>
+#include <string>
+#include "containers.hh"
+
+using namespace::std;
+
+/* BRRIP inserts a block at long (rather than distant) re-reference once every BRRIP_EPSILON fills */
+#define BRRIP_EPSILON 32
+/* DRRIP dedicates DUEL_LEADERS sets to SRRIP and DUEL_LEADERS sets to BRRIP */
+#define DUEL_LEADERS 32
+/* The saturating policy selector of DRRIP counts from 0 to PSEL_MAX */
+#define PSEL_MAX 1023
+
+/* Replacement policies
+ *
+ *  A replacement policy keeps the replacement state of every set of a cache,
+ *  the cache is templated on it, so every call below is resolved (and inlined) at compile time.
+ *  A policy has the following members:
+ *    static const char *name(): The name of the policy, as given to -r
+ *    void initialize(unsigned, unsigned): Allocate the state of n_sets sets of n_ways ways, all empty
+ *    void touch(unsigned, unsigned): A hit on a way of a set
+ *    void insert(unsigned, unsigned): A block is filled into a way of a set
+ *    unsigned victim(unsigned): The way to evict from a full set (insert() is called on it right after)
+ *    void invalidate(unsigned, unsigned): A valid way is invalidated (a level of a hierarchy), it is filled
+ *      (insert()) before any victim() of its set, so only the policies that order the ways need to forget it
+ *    void bypass(): An access goes around the cache (a write miss without write-allocate), no way is touched or filled
+ *    void reset(): Forget the state (called when all the ways are invalidated)
+ *    static const bool setLocal: Whether the state of a set depends on the accesses to that set only,
+ *      so that the sets can be simulated apart, by several threads (-P)
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&): Write the state to a checkpoint, read it back
+ *
+ *  To add a policy, define it below and add it to FOR_EACH_POLICY.
+ */
+
+/* LRUPolicy: evict the least recently used way (BlockLRU) */
+struct LRUPolicy {
+  static const char *name() { return "LRU"; }
+  static const bool setLocal = true;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->lru.initialize(n_sets, n_ways); }
+  inline void touch(unsigned set_id, unsigned way) { this->lru.update(set_id, way); }
+  inline void insert(unsigned set_id, unsigned way) { this->lru.push(set_id, way); }
+  inline unsigned victim(unsigned set_id) { return this->lru.pop(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) { this->lru.remove(set_id, way); }
+  inline void bypass() {}
+  inline void reset() { this->lru.reset(); }
+  inline void save(CheckpointWriter &w) const { this->lru.save(w); }
+  inline void restore(CheckpointReader &r) { this->lru.restore(r); }
+private:
+  BlockLRU lru;
+};
+
+/* FIFOPolicy: evict the way filled first (BlockQueues), hits do not change the order */
+struct FIFOPolicy {
+  static const char *name() { return "FIFO"; }
+  static const bool setLocal = true;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->queue.initialize(n_sets); }
+  inline void touch(unsigned set_id, unsigned way) {}
+  inline void insert(unsigned set_id, unsigned way) { this->queue.push(set_id, way); }
+  inline unsigned victim(unsigned set_id) { return this->queue.pop(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) { this->queue.remove(set_id, way); }
+  inline void bypass() {}
+  inline void reset() { this->queue.reset(); }
+  inline void save(CheckpointWriter &w) const { this->queue.save(w); }
+  inline void restore(CheckpointReader &r) { this->queue.restore(r); }
+private:
+  BlockQueues queue;
+};
+
+/* RandomPolicy: evict a random way (rand_r() on a seed of its own, so caches simulated side by side do not interfere) */
+struct RandomPolicy {
+  static const char *name() { return "random"; }
+  static const bool setLocal = false;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->numWays = n_ways; }
+  inline void touch(unsigned set_id, unsigned way) {}
+  inline void insert(unsigned set_id, unsigned way) {}
+  inline unsigned victim(unsigned set_id) { return rand_r(&this->seed) % this->numWays; }
+  inline void invalidate(unsigned set_id, unsigned way) {}
+  inline void bypass() {}
+  inline void reset() {}
+  inline void save(CheckpointWriter &w) const { w.put(this->seed); }
+  inline void restore(CheckpointReader &r) { r.get(this->seed); }
+private:
+  unsigned numWays = 0;
+  unsigned seed = 1;
+};
+
+/* PLRUPolicy: tree pseudo-LRU (BlockPLRU), O(log ways) per access */
+struct PLRUPolicy {
+  static const char *name() { return "PLRU"; }
+  static const bool setLocal = true;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->tree.initialize(n_sets, n_ways); }
+  inline void touch(unsigned set_id, unsigned way) { this->tree.update(set_id, way); }
+  inline void insert(unsigned set_id, unsigned way) { this->tree.update(set_id, way); }
+  inline unsigned victim(unsigned set_id) { return this->tree.victim(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) {}
+  inline void bypass() {}
+  inline void reset() { this->tree.reset(); }
+  inline void save(CheckpointWriter &w) const { this->tree.save(w); }
+  inline void restore(CheckpointReader &r) { this->tree.restore(r); }
+private:
+  BlockPLRU tree;
+};
+
+/* NRUPolicy: not recently used, a 1-bit RRIP (BlockRRIP with maxRRPV 1), accessed blocks are marked recent */
+struct NRUPolicy {
+  static const char *name() { return "NRU"; }
+  static const bool setLocal = true;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->rrip.initialize(n_sets, n_ways, 1); }
+  inline void touch(unsigned set_id, unsigned way) { this->rrip.set(set_id, way, 0); }
+  inline void insert(unsigned set_id, unsigned way) { this->rrip.set(set_id, way, 0); }
+  inline unsigned victim(unsigned set_id) { return this->rrip.victim(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) {}
+  inline void bypass() {}
+  inline void reset() { this->rrip.reset(); }
+  inline void save(CheckpointWriter &w) const { this->rrip.save(w); }
+  inline void restore(CheckpointReader &r) { this->rrip.restore(r); }
+private:
+  BlockRRIP rrip;
+};
+
+/* SRRIPPolicy: static RRIP (2-bit RRPV), hits are predicted near, fills long */
+struct SRRIPPolicy {
+  static const char *name() { return "SRRIP"; }
+  static const bool setLocal = true;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->rrip.initialize(n_sets, n_ways, 3); }
+  inline void touch(unsigned set_id, unsigned way) { this->rrip.set(set_id, way, 0); }
+  inline void insert(unsigned set_id, unsigned way) { this->rrip.set(set_id, way, 2); }
+  inline unsigned victim(unsigned set_id) { return this->rrip.victim(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) {}
+  inline void bypass() {}
+  inline void reset() { this->rrip.reset(); }
+  inline void save(CheckpointWriter &w) const { this->rrip.save(w); }
+  inline void restore(CheckpointReader &r) { this->rrip.restore(r); }
+private:
+  BlockRRIP rrip;
+};
+
+/* BRRIPPolicy: bimodal RRIP, fills are predicted distant, except one in BRRIP_EPSILON (long) */
+struct BRRIPPolicy {
+  static const char *name() { return "BRRIP"; }
+  static const bool setLocal = false;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->rrip.initialize(n_sets, n_ways, 3); }
+  inline void touch(unsigned set_id, unsigned way) { this->rrip.set(set_id, way, 0); }
+  inline void insert(unsigned set_id, unsigned way) {
+    this->rrip.set(set_id, way, ++this->fills % BRRIP_EPSILON ? 3 : 2); }
+  inline unsigned victim(unsigned set_id) { return this->rrip.victim(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) {}
+  inline void bypass() {}
+  inline void reset() { this->rrip.reset(); this->fills = 0; }
+  inline void save(CheckpointWriter &w) const { this->rrip.save(w); w.put(this->fills); }
+  inline void restore(CheckpointReader &r) { this->rrip.restore(r); r.get(this->fills); }
+private:
+  BlockRRIP rrip;
+  unsigned fills = 0;
+};
+
+/* DRRIPPolicy: dynamic RRIP, set dueling between SRRIP and BRRIP,
+ *  DUEL_LEADERS sets always use each of them, and a miss in a leader set moves the selector (psel) against it,
+ *  the other (follower) sets use BRRIP when psel is above the middle
+ */
+struct DRRIPPolicy {
+  static const char *name() { return "DRRIP"; }
+  static const bool setLocal = false;
+  inline void initialize(unsigned n_sets, unsigned n_ways) {
+    this->rrip.initialize(n_sets, n_ways, 3);
+    // Every region of sets holds one leader of each kind (there are no followers with few sets)
+    this->region = n_sets / DUEL_LEADERS < 2 ? 2 : n_sets / DUEL_LEADERS; }
+  inline void touch(unsigned set_id, unsigned way) { this->rrip.set(set_id, way, 0); }
+  inline void insert(unsigned set_id, unsigned way) {
+    unsigned leader = set_id % this->region;
+    bool bimodal;
+    if (leader == 0) {
+      // SRRIP leader missed
+      this->psel += this->psel < PSEL_MAX;
+      bimodal = false;
+    } else if (leader == 1) {
+      // BRRIP leader missed
+      this->psel -= this->psel > 0;
+      bimodal = true;
+    } else
+      bimodal = this->psel > PSEL_MAX / 2;
+    this->rrip.set(set_id, way, bimodal && ++this->fills % BRRIP_EPSILON ? 3 : 2); }
+  inline unsigned victim(unsigned set_id) { return this->rrip.victim(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) {}
+  inline void bypass() {}
+  inline void reset() { this->rrip.reset(); this->fills = 0; this->psel = PSEL_MAX / 2; }
+  inline void save(CheckpointWriter &w) const { this->rrip.save(w); w.put(this->psel); w.put(this->fills); }
+  inline void restore(CheckpointReader &r) { this->rrip.restore(r); r.get(this->psel); r.get(this->fills); }
+private:
+  BlockRRIP rrip;
+  unsigned region = 2;
+  unsigned psel = PSEL_MAX / 2;
+  unsigned fills = 0;
+};
+
+/* LFUPolicy: evict the least frequently used block (BlockHeap keyed by the access count), the lowest way on a tie */
+struct LFUPolicy {
+  static const char *name() { return "LFU"; }
+  static const bool setLocal = true;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->counts.initialize(n_sets, n_ways); }
+  inline void touch(unsigned set_id, unsigned way) { this->counts.setKey(set_id, way, this->counts.getKey(set_id, way) + 1); }
+  inline void insert(unsigned set_id, unsigned way) { this->counts.setKey(set_id, way, 1); }
+  inline unsigned victim(unsigned set_id) { return this->counts.top(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) {}
+  inline void bypass() {}
+  inline void reset() { this->counts.reset(); }
+  inline void save(CheckpointWriter &w) const { this->counts.save(w); }
+  inline void restore(CheckpointReader &r) { this->counts.restore(r); }
+private:
+  BlockHeap counts;
+};
+
+/* OPTPolicy: Belady's optimal replacement, evict the block used furthest in the future (or never again),
+ *  needs the time of the next use of every access (NextUse, attached before the first access, every access consumes its own:
+ *  a hit or a fill, or bypass() for an access that goes around the cache),
+ *  BlockHeap is keyed by the complement of the next use, so its top is the furthest one
+ */
+struct OPTPolicy {
+  static const char *name() { return "OPT"; }
+  static const bool setLocal = false;
+  inline void initialize(unsigned n_sets, unsigned n_ways) { this->nextUses.initialize(n_sets, n_ways); }
+  inline void touch(unsigned set_id, unsigned way) { this->nextUses.setKey(set_id, way, ~this->stream->next()); }
+  inline void insert(unsigned set_id, unsigned way) { this->nextUses.setKey(set_id, way, ~this->stream->next()); }
+  inline unsigned victim(unsigned set_id) { return this->nextUses.top(set_id); }
+  inline void invalidate(unsigned set_id, unsigned way) {}
+  inline void bypass() { this->stream->next(); }
+  inline void reset() { this->nextUses.reset(); }
+  // The heap is keyed by the positions in the stream of the run, which a checkpoint cannot carry over
+  inline void save(CheckpointWriter &w) const { throw string("The next uses of OPT are not checkpointed (Code: 010).\n"); }
+  inline void restore(CheckpointReader &r) { throw string("The next uses of OPT are not checkpointed (Code: 010).\n"); }
+  inline void attach(NextUse *s) { this->stream = s; }
+private:
+  BlockHeap nextUses;
+  NextUse *stream = nullptr;
+};
+
+/* The registry of the policies, X(Policy) is expanded once per policy */
+#define FOR_EACH_POLICY(X) \
+  X(LRUPolicy) \
+  X(FIFOPolicy) \
+  X(RandomPolicy) \
+  X(PLRUPolicy) \
+  X(NRUPolicy) \
+  X(SRRIPPolicy) \
+  X(BRRIPPolicy) \
+  X(DRRIPPolicy) \
+  X(LFUPolicy) \
+  X(OPTPolicy)
+
+/* Resolve a policy by its name, and call f.template run<Policy>() with it */
+template <class F>
+void withPolicy(const string &name, F &f) {
+#define RUN_IF_NAMED(P) if (name == P::name()) { f.template run<P>(); return; }
+  FOR_EACH_POLICY(RUN_IF_NAMED)
+#undef RUN_IF_NAMED
+  throw string("Unknown replacement policy (Code: 003).\n");
+}
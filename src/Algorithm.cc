@@ -5,6 +5,10 @@
 
 #include "classes.hh"
 #include <iomanip>
+#include <stdexcept>
+
+/* The accesses of a replay, and the stores of an initialization, are handed to the CPU ALGORITHM_BATCH at a time */
+#define ALGORITHM_BATCH 4096
 
 /* Start Function */
 void Algorithms::enter(Parameters &params) {
@@ -15,60 +19,407 @@ void Algorithms::enter(Parameters &params) {
   Rule rule(params);
   Ram ram(params, &rule);
   Result result;
-  Cache cache(params, &rule, &ram, &result);
   // Bind the components with the class
   this->testsize = params.getTestSize();
+  this->params = &params;
   this->rule = &rule;
   this->ram = &ram;
   this->result = &result;
-  this->cache = &cache;
+  this->out = &cout;
+
+  /* Capture the trace of the algorithm (-w), simulate every configuration of the lists at once,
+   * measure every cache at once (-m), or resolve the replacement policy once, and simulate with it */
+  if (!params.getTraceOutput().empty())
+    this->capture();
+  else if (params.isSweep())
+    this->sweep();
+  else if (params.missCurves())
+    this->profile();
+  else
+    withPolicy(params.getReplacePolicy(), *this);
+}
+
+/* Build the cache with the replacement policy, and go to the algorithm */
+template <class Policy>
+void Algorithms::run() {
+  Parameters &params = *this->params;
+  if (params.getCores() > 1) {
+    this->multicore<Policy>();
+    return;
+  }
+  if (params.isHierarchy()) {
+    this->hierarchy<Policy>();
+    return;
+  }
+  if (params.getShards() > 1) {
+    this->partition<Policy>();
+    return;
+  }
+
+  /* Assemble my CPU */
+  Cache<Policy> cache(params, this->rule, this->ram, this->result);
+  CPU<Cache<Policy>> myCpu(&cache, this->result);
 
   /* Go to the algorithm */
-  if (params.getAlgorithm() == "mxm_block" || params.getAlgorithm() == "mxm_blocked")
-    this->mxmMultBlock(params);
+  this->execute(params, myCpu);
+}
+
+/* Build the levels of the hierarchy with the replacement policy, go to the algorithm, and print the levels below L1 */
+template <class Policy>
+void Algorithms::hierarchy() {
+  Parameters &params = *this->params;
+
+  /* Assemble my CPU on the levels */
+  Hierarchy<Policy> levels(params, this->rule, this->ram, this->result);
+  CPU<Hierarchy<Policy>> myCpu(&levels, this->result);
+
+  /* Go to the algorithm (it prints the results of L1) */
+  this->execute(params, myCpu);
+  print(*this->out, levels);
+}
+
+/* Simulate the cache with its sets partitioned across threads, and print the results of the shards, merged */
+template <class Policy>
+void Algorithms::partition() {
+  Parameters &params = *this->params;
+
+  /* Assemble my CPU on the shards */
+  Partition<Policy> shards(params, this->rule, this->ram, this->result);
+  CPU<Partition<Policy>> myCpu(&shards, this->result);
+
+  /* Go to the algorithm (it prints the results before the shards are done, discard them) */
+  ostream discard(nullptr);
+  this->out = &discard;
+  this->execute(params, myCpu);
+  this->out = &cout;
+  shards.finish();
+
+  print(cout, *(this->result));
+}
+
+/* Run the share of the parallel algorithm of every core on it, and print the results of the cores (added up, then one by one) */
+template <class Policy>
+void Algorithms::multicore() {
+  Parameters &params = *this->params;
+  typedef typename Multicore<Policy>::Core Core;
+
+  /* Assemble the cores, each of them runs its share on a CPU of its own */
+  Multicore<Policy> cores(params, this->rule, this->result);
+  cores.run([this, &params](unsigned core, CPU<Core> &coreCpu) { this->slice(params, coreCpu, core, params.getCores()); });
+
+  print(cout, *(this->result));
+  print(cout, cores);
+}
+
+/* OPT needs the future: record the blocks accessed by the algorithm, then simulate with their next uses */
+template <>
+void Algorithms::run<OPTPolicy>() {
+  Parameters &params = *this->params;
+  NextUse stream;
+
+  /* First pass: run the algorithm on the recorder (the results are scratch, and nothing is printed) */
+  {
+    BlockRecorder recorder(this->rule, &stream);
+    Result scratch;
+    CPU<BlockRecorder> recordingCpu(&recorder, &scratch);
+    ostream discard(nullptr);
+    ostream *out = this->out;
+    this->out = &discard;
+    this->execute(params, recordingCpu);
+    this->out = out;
+  }
+  stream.finish();
+
+  /* Second pass: the same accesses, each of them tells the policy when its block is used next */
+  Cache<OPTPolicy> cache(params, this->rule, this->ram, this->result);
+  cache.getPolicy().attach(&stream);
+  CPU<Cache<OPTPolicy>> myCpu(&cache, this->result);
+  this->execute(params, myCpu);
+}
+
+/* Measure the stack distances of the algorithm, and print the misses of every LRU cache up to the cache size */
+void Algorithms::profile() {
+  Parameters &params = *this->params;
+  if (params.getReplacePolicy() != LRUPolicy::name())
+    throw string("Miss curves are measured for LRU only (Code: 003).\n");
+
+  /* Assemble the CPU on the profiler */
+  StackProfiler profiler(params, this->rule);
+  CPU<StackProfiler> myCpu(&profiler, this->result);
+
+  /* Go to the algorithm (it prints the results of no cache, discard them) */
+  ostream discard(nullptr);
+  this->out = &discard;
+  this->execute(params, myCpu);
+  this->out = &cout;
+
+  print(cout, profiler, *(this->result));
+}
+
+/* Run the algorithm once, on the caches of every configuration of the lists */
+void Algorithms::sweep() {
+  Parameters &params = *this->params;
+  vector<Parameters> configs = params.configurations();
+
+  /* Assemble the CPU on the sweep */
+  Sweep fanout(configs, params.getThreads());
+  CPU<Sweep> myCpu(&fanout, this->result);
+
+  /* Go to the algorithm (it prints the results of no cache, discard them) */
+  ostream discard(nullptr);
+  this->out = &discard;
+  this->execute(params, myCpu);
+  this->out = &cout;
+  fanout.finish();
+
+  print(cout, fanout, *(this->result));
+}
+
+/* Run the algorithm once, and write its accesses to a trace */
+void Algorithms::capture() {
+  Parameters &params = *this->params;
+
+  /* Assemble the CPU on the capture */
+  TraceWriter trace(params.getTraceOutput());
+  TraceCapture capture(&trace, this->result);
+  CPU<TraceCapture> myCpu(&capture, this->result);
+
+  /* Go to the algorithm (it prints the results of no cache, discard them) */
+  ostream discard(nullptr);
+  this->out = &discard;
+  this->execute(params, myCpu);
+  this->out = &cout;
+  capture.finish();
+  trace.close();
+
+  print(cout, capture, *(this->result));
+}
+
+/* Go to the algorithm (or the trace) */
+template <class Memory>
+void Algorithms::execute(Parameters &params, CPU<Memory> &myCpu) {
+  if (!params.getTraceInput().empty())
+    this->replay(params, myCpu);
+  else if (params.getAlgorithm() == "mxm_block" || params.getAlgorithm() == "mxm_blocked")
+    this->mxmMultBlock(params, myCpu);
   else if (params.getAlgorithm() == "mxm")
-    this->mxmMult(params);
+    this->mxmMult(params, myCpu);
   else if (params.getAlgorithm() == "daxpy")
-    this->daxpy(params);
+    this->daxpy(params, myCpu);
   else
     throw string("Unknow Algorithm (Code: 001). Abort.\n");
 }
 
-/* Algorithm daxpy */
-void Algorithms::daxpy(Parameters &params) {
-  /* Assemble my CPU */
-  CPU myCpu(this->cache, this->result);
-  /* Determine the test size */
-  const unsigned test_size = this->testsize;
+/* Replay a trace: the resets, the instructions that are not accesses, and every access of the trace, chunk by chunk */
+template <class Memory>
+void Algorithms::replay(Parameters &params, CPU<Memory> &myCpu) {
+  if (params.getTraceFormat() != TRACE_NATIVE)
+    this->replayExternal(params, myCpu);
+  else {
+    TraceReader trace(params.getTraceInput());
+
+    for (size_t chunk_id=0; chunk_id!=trace.size(); ++chunk_id) {
+      const TraceChunk &chunk = trace.getChunk(chunk_id);
+      // The reset after the loading (as captured), unless the loading is counted (-l)
+      if ((chunk.flags & TRACE_RESET) && params.resetResult())
+        myCpu.reset();
+      myCpu.compute(chunk.instructions);
+      trace.decode(chunk_id, [&](uint64_t address, bool write) { this->replayAccess(myCpu, address, write); });
+      this->flush(myCpu);
+    }
+  }
+
+  print(*this->out, *(this->result));
+}
+
+/* Replay a trace of another tool, batch by batch as the reader thread parses it */
+template <class Memory>
+void Algorithms::replayExternal(Parameters &params, CPU<Memory> &myCpu) {
+  ExternalTrace trace(params.getTraceInput(), params.getTraceFormat());
+
+  while (const vector<TraceRecord> *batch = trace.acquire()) {
+    for (const TraceRecord &record : *batch)
+      if (record.op == TRACE_COMPUTE)
+        myCpu.compute(record.value);
+      else
+        this->replayAccess(myCpu, record.value, record.op == TRACE_WRITE);
+    trace.release();
+  }
+  this->flush(myCpu);
+}
+
+/* Replay an access: append it to the batch, and run the batch when it is full (a trace stores no values, they are 0) */
+template <class Memory>
+inline void Algorithms::replayAccess(CPU<Memory> &myCpu, Address address, bool write) {
+  Access access = {address, write ? ACCESS_WRITE : ACCESS_READ};
+  this->accesses.push_back(access);
+  if (this->accesses.size() == ALGORITHM_BATCH)
+    this->flush(myCpu);
+}
+
+/* Run the batch of accesses on the CPU, and empty it */
+template <class Memory>
+void Algorithms::flush(CPU<Memory> &myCpu) {
+  this->values.assign(this->accesses.size(), 0);
+  myCpu.batch(this->accesses.data(), this->accesses.data() + this->accesses.size(), this->values.data());
+  this->accesses.clear();
+}
+
+/* Store value(i) to the i-th element of an array (in the order of its rows), ALGORITHM_BATCH stores at a time */
+template <class Memory, class Value>
+void Algorithms::storeEach(CPU<Memory> &myCpu, const Layout &array, Value value) {
+  size_t i = 0;
+  for (unsigned row=0; row!=array.rows; ++row)
+    for (unsigned col=0; col!=array.cols; ++col, ++i) {
+      Access access = {array(row, col), ACCESS_WRITE};
+      this->accesses.push_back(access);
+      this->values.push_back(value(i));
+      if (this->accesses.size() == ALGORITHM_BATCH || i+1 == array.size()) {
+        myCpu.batch(this->accesses.data(), this->accesses.data() + this->accesses.size(), this->values.data());
+        this->accesses.clear();
+        this->values.clear();
+      }
+    }
+}
+
+/* Initialize the arrays with some dummy values, and reset the CPU to restart counting (unless -l),
+ * then save the state to a checkpoint (-C), or restore that state from a checkpoint instead (-R) */
+template <class Memory>
+void Algorithms::initialize(Parameters &params, CPU<Memory> &myCpu,
+    const Layout &a, const Layout &b, const Layout &c) {
+  // The arrays are laid out one after the other, their sizes tell the initialization apart
+  vector<uint64_t> arrays = {a.size(), b.size(), c.size()};
+  if (!params.getCheckpointInput().empty()) {
+    this->restore(params, myCpu, arrays);
+    return;
+  }
 
-  /* Initialize the addresses */
-  unsigned ct = 0;
-  vector<Address> a(test_size);
-  vector<Address> b(test_size);
-  vector<Address> c(test_size);
-  for (auto &add : a)
-    add = ct++ * WORD_SIZE;
-  for (auto &add : b)
-    add = ct++ * WORD_SIZE;
-  for (auto &add : c)
-    add = ct++ * WORD_SIZE;
-
-  /* Initialize some dummy values */
-  unsigned i = 0;
-  for (auto it=a.begin(); it!=a.end(); ++it)
-    myCpu.storeDouble(*it, i++);
-
-  i = 0;
-  for (auto it=b.begin(); it!=b.end(); ++it)
-    myCpu.storeDouble(*it, 2*i++);
-
-  for (auto it=c.begin(); it!=c.end(); ++it)
-    myCpu.storeDouble(*it, 0);
+  this->storeEach(myCpu, a, [](size_t i) { return (double)(unsigned)i; });
+  this->storeEach(myCpu, b, [](size_t i) { return (double)(2*(unsigned)i); });
+  this->storeEach(myCpu, c, [](size_t i) { return 0.0; });
 
   /* Reset the CPU to restart counting (with -s flag) */
   if (params.resetResult())
     myCpu.reset();
 
+  if (!params.getCheckpointOutput().empty())
+    this->save(params, myCpu, arrays);
+}
+
+/* Save the state after the initialization: the sizes of the arrays, whether the cache is warm (-l) and whether it has a payload,
+ * the pages of the ram (with a payload), then the result and the memory of the CPU (warm only: after the reset, the memory
+ * is empty, so a cold checkpoint can be restored on a cache of any geometry) */
+template <class Memory>
+void Algorithms::save(Parameters &params, CPU<Memory> &myCpu, const vector<uint64_t> &arrays) {
+  CheckpointWriter w(params.getCheckpointOutput());
+  bool warm = !params.resetResult(), payload = !params.timingOnly();
+  w.put(arrays);
+  w.put((uint8_t)warm);
+  w.put((uint8_t)payload);
+  if (payload)
+    this->ram->save(w);
+  if (warm) {
+    this->result->save(w);
+    myCpu.save(w);
+  }
+  w.close();
+}
+
+/* Restore the state after the initialization (see save), from a checkpoint of the same arrays, warmth and mode */
+template <class Memory>
+void Algorithms::restore(Parameters &params, CPU<Memory> &myCpu, const vector<uint64_t> &arrays) {
+  CheckpointReader r(params.getCheckpointInput());
+  vector<uint64_t> saved(arrays.size());
+  uint8_t warm, payload;
+  r.get(saved);
+  r.get(warm);
+  r.get(payload);
+  if (saved != arrays || (bool)warm == params.resetResult() || (bool)payload == params.timingOnly())
+    CheckpointReader::mismatch();
+  if (payload)
+    this->ram->restore(r);
+  if (warm) {
+    this->result->restore(r);
+    myCpu.restore(r);
+  } else
+    myCpu.reset();
+}
+
+/* The share of a core of the parallel algorithm: a contiguous range of the iterations of daxpy, of the rows of C of mxm,
+ * or of the columns of blocks of C of mxm_block (called on the thread of the core, so only locals are used) */
+template <class Memory>
+void Algorithms::slice(Parameters &params, CPU<Memory> &myCpu, unsigned core, unsigned cores) {
+  const unsigned test_size = this->testsize;
+  const bool vectors = params.getAlgorithm() == "daxpy";
+  Layout a(0, vectors ? 1 : test_size, test_size);
+  Layout b(a.end(), a.rows, test_size);
+  Layout c(b.end(), a.rows, test_size);
+
+  /* The first core initializes the arrays (counted with -l only, the caches start empty otherwise) */
+  if (core == 0 && !params.resetResult())
+    for (const Layout *array : {&a, &b, &c})
+      for (unsigned row=0; row!=array->rows; ++row)
+        for (unsigned col=0; col!=array->cols; ++col)
+          myCpu.storeDouble((*array)(row, col), 0);
+
+  Register r0 = 3, r1, r2, r3;
+  const bool blocked = params.getAlgorithm() == "mxm_block" || params.getAlgorithm() == "mxm_blocked";
+  const unsigned blocking_factor = blocked ? params.getBlockingFactor() : 1;
+  const unsigned units = (test_size + blocking_factor - 1) / blocking_factor;
+  const unsigned first = (uint64_t)units * core / cores, last = (uint64_t)units * (core + 1) / cores;
+  if (vectors)
+    for (unsigned ind=first; ind!=last; ++ind) {
+      r1 = myCpu.loadDouble(a[ind]);
+      r2 = myCpu.multDouble(r0, r1);
+      r3 = myCpu.loadDouble(b[ind]);
+      myCpu.storeDouble(c[ind], myCpu.addDouble(r2, r3));
+    }
+  else if (!blocked)
+    for (unsigned row=first; row!=last; ++row)
+      for (unsigned col=0; col!=test_size; ++col) {
+        r0 = 0;
+        for (unsigned k=0; k!=test_size; ++k) {
+          r1 = myCpu.loadDouble(a(row, k));
+          r2 = myCpu.loadDouble(b(k, col));
+          r3 = myCpu.multDouble(r1, r2);
+          r0 = myCpu.addDouble(r0, r3);
+        }
+        myCpu.storeDouble(c(row, col), r0);
+      }
+  else {
+    // The blocks of mxmMultBlock (the matrices indexed in columns), the columns of C of a block go to one core
+    Layout at = a.transposed(), bt = b.transposed(), ct = c.transposed();
+    for (unsigned sj=first*blocking_factor; sj<last*blocking_factor && sj<test_size; sj += blocking_factor)
+      for (unsigned si=0; si<test_size; si += blocking_factor)
+        for (unsigned sk=0; sk<test_size; sk += blocking_factor)
+          for (unsigned i=si; i<si+blocking_factor && i<test_size; ++i)
+            for (unsigned j=sj; j<sj+blocking_factor && j<test_size; ++j) {
+              r0 = myCpu.loadDouble(ct(i, j));
+              for (unsigned k=sk; k<sk+blocking_factor && k<test_size; ++k) {
+                r1 = myCpu.loadDouble(at(i, k));
+                r2 = myCpu.loadDouble(bt(k, j));
+                r3 = myCpu.multDouble(r1, r2);
+                r0 = myCpu.addDouble(r0, r3);
+              }
+              myCpu.storeDouble(ct(i, j), r0);
+            }
+  }
+}
+
+/* Algorithm daxpy */
+template <class Memory>
+void Algorithms::daxpy(Parameters &params, CPU<Memory> &myCpu) {
+  /* Determine the test size */
+  const unsigned test_size = this->testsize;
+
+  /* Lay the vectors out one after the other */
+  Layout a(0, 1, test_size);
+  Layout b(a.end(), 1, test_size);
+  Layout c(b.end(), 1, test_size);
+
+  /* Initialize some dummy values (or restore them from a checkpoint) */
+  this->initialize(params, myCpu, a, b, c);
+
   // Put a random 'D' into a register
   Register r0 = 3, r1, r2, r3, r4;
 
@@ -82,107 +433,94 @@ void Algorithms::daxpy(Parameters &params) {
   }
 
   // Print out the result
-  print(cout, *(this->result));
+  print(*this->out, *(this->result));
 
   /* Correctness check (with -p flag) */
   if (params.printOutput()) {
-    cout << "##############################################\n";
-    cout << "-Daxpy- Correctness Check, Multiplier D=" << r0 << "\n";
-    cout << "Vector A: ";
-    for (auto address : a)
-      cout << myCpu.loadDouble(address) << " ";
-    cout << "\nVector B: ";
-    for (auto address : b)
-      cout << myCpu.loadDouble(address) << " ";
-    cout << "\nVector C: ";
-    for (auto address : c)
-      cout << myCpu.loadDouble(address) << " ";
-    cout << endl;
+    *this->out << "##############################################\n";
+    *this->out << "-Daxpy- Correctness Check, Multiplier D=" << r0 << "\n";
+    *this->out << "Vector A: ";
+    for (unsigned i=0; i!=test_size; ++i)
+      *this->out << myCpu.loadDouble(a[i]) << " ";
+    *this->out << "\nVector B: ";
+    for (unsigned i=0; i!=test_size; ++i)
+      *this->out << myCpu.loadDouble(b[i]) << " ";
+    *this->out << "\nVector C: ";
+    for (unsigned i=0; i!=test_size; ++i)
+      *this->out << myCpu.loadDouble(c[i]) << " ";
+    *this->out << endl;
   }
 
   return;
 }
 
 /* Algorithm mxmMult */
-void Algorithms::mxmMult(Parameters &params) {
-  /* Assemble my CPU */
-  CPU myCpu(this->cache, this->result);
+template <class Memory>
+void Algorithms::mxmMult(Parameters &params, CPU<Memory> &myCpu) {
   /* Determine the test size */
   const unsigned test_size = this->testsize;
 
-  /* Initialize the addresses (as continuous) */
-  unsigned ct = 0;
-  vector<Address> a(test_size*test_size);
-  vector<Address> b(test_size*test_size);
-  vector<Address> c(test_size*test_size);
-
-  // Assigning addresses
-  for (auto &add : a)
-    add = ct++ * WORD_SIZE;
-  for (auto &add : b)
-    add = ct++ * WORD_SIZE;
-  for (auto &add : c)
-    add = ct++ * WORD_SIZE;
-
-
-  // Initialize some dummy values
-  unsigned i = 0;
-  for (auto it=a.begin(); it!=a.end(); ++it)
-    myCpu.storeDouble(*it, i++);
+  /* Lay the matrices out one after the other (as continuous, in rows) */
+  Layout a(0, test_size, test_size);
+  Layout b(a.end(), test_size, test_size);
+  Layout c(b.end(), test_size, test_size);
 
-  i = 0;
-  for (auto it=b.begin(); it!=b.end(); ++it)
-    myCpu.storeDouble(*it, 2*i++);
 
-  for (auto it=c.begin(); it!=c.end(); ++it)
-    myCpu.storeDouble(*it, 0);
+  /* Initialize some dummy values (or restore them from a checkpoint) */
+  this->initialize(params, myCpu, a, b, c);
 
-  /* Reset the CPU to restart counting (with -s flag) */
-  if (params.resetResult())
-    myCpu.reset();
-
-  Register r0, r1, r2, r3;
+  Register r0, r3;
+  // The loads of a dot product are a batch (a[row][k], b[k][col] for every k, in the order of the loop)
+  this->accesses.resize(2*test_size);
+  this->values.resize(2*test_size);
+  for (auto &access : this->accesses)
+    access.op = ACCESS_READ;
 
   // Start iterating
   for (auto row=0; row!=test_size; ++row) {
     for (auto col=0; col!=test_size; ++col) {
+      for (unsigned k=0; k!=test_size; ++k) {
+        this->accesses[2*k].address = a(row, k);
+        this->accesses[2*k+1].address = b(k, col);
+      }
+      myCpu.batch(this->accesses.data(), this->accesses.data() + 2*test_size, this->values.data());
       r0 = 0; // r0 is the accumulator;
-      for (auto k=0; k!=test_size; ++k) {
-        r1 = myCpu.loadDouble(a[row*test_size + k]);
-        r2 = myCpu.loadDouble(b[k*test_size + col]);
-        r3 = myCpu.multDouble(r1, r2);
+      for (unsigned k=0; k!=test_size; ++k) {
+        r3 = myCpu.multDouble(this->values[2*k], this->values[2*k+1]);
         r0 = myCpu.addDouble(r0, r3);
       }
-      myCpu.storeDouble(c[row*test_size+col], r0);
+      myCpu.storeDouble(c(row, col), r0);
     }
   }
+  this->accesses.clear();
+  this->values.clear();
 
-  print(cout, *(this->result));
+  print(*this->out, *(this->result));
 
   /* Correctness check (with -p flag) */
   if (params.printOutput()) {
-    cout << "##############################################\n";
-    cout << "-mxm- Correctness Check\n";
+    *this->out << "##############################################\n";
+    *this->out << "-mxm- Correctness Check\n";
 
-    cout << "Matrix A:\n";
+    *this->out << "Matrix A:\n";
     for (auto ri=0; ri!=test_size; ++ri) {
       for (auto ci=0; ci!=test_size; ++ci)
-        cout << fixed << setprecision(0) << myCpu.loadDouble(a[ri*test_size+ci]) << " ";
-      cout << "\n";
+        *this->out << fixed << setprecision(0) << myCpu.loadDouble(a(ri, ci)) << " ";
+      *this->out << "\n";
     }
 
-    cout << "Matrix B:\n";
+    *this->out << "Matrix B:\n";
     for (auto ri=0; ri!=test_size; ++ri) {
       for (auto ci=0; ci!=test_size; ++ci)
-        cout << fixed << setprecision(0) << myCpu.loadDouble(b[ri*test_size+ci]) << " ";
-      cout << "\n";
+        *this->out << fixed << setprecision(0) << myCpu.loadDouble(b(ri, ci)) << " ";
+      *this->out << "\n";
     }
 
-    cout << "Matrix C:\n";
+    *this->out << "Matrix C:\n";
     for (auto ri=0; ri!=test_size; ++ri) {
       for (auto ci=0; ci!=test_size; ++ci)
-        cout << fixed << setprecision(0) << myCpu.loadDouble(c[ri*test_size+ci]) << " ";
-      cout << "\n";
+        *this->out << fixed << setprecision(0) << myCpu.loadDouble(c(ri, ci)) << " ";
+      *this->out << "\n";
     }
   }
 
@@ -190,96 +528,88 @@ void Algorithms::mxmMult(Parameters &params) {
 }
 
 /* Algorithm mxmMultBlock */
-void Algorithms::mxmMultBlock(Parameters &params) {
-  /* Assemble my CPU */
-  CPU myCpu(this->cache, this->result);
+template <class Memory>
+void Algorithms::mxmMultBlock(Parameters &params, CPU<Memory> &myCpu) {
   /* Determine the test size and blocking factor */
   const unsigned test_size = this->testsize;
   const unsigned blocking_factor = params.getBlockingFactor();
 
-  /* Initialize the addresses (as continuous) */
-  unsigned ct = 0;
-  vector<Address> a(test_size*test_size);
-  vector<Address> b(test_size*test_size);
-  vector<Address> c(test_size*test_size);
+  /* Lay the matrices out one after the other (as continuous, in rows) */
+  Layout a(0, test_size, test_size);
+  Layout b(a.end(), test_size, test_size);
+  Layout c(b.end(), test_size, test_size);
 
-  // Assigning addresses
-  for (auto &add : a)
-    add = ct++ * WORD_SIZE;
-  for (auto &add : b)
-    add = ct++ * WORD_SIZE;
-  for (auto &add : c)
-    add = ct++ * WORD_SIZE;
+  /* Initialize some dummy values (or restore them from a checkpoint) */
+  this->initialize(params, myCpu, a, b, c);
 
-  // Initialize some dummy values
-  unsigned i = 0;
-  for (auto it=a.begin(); it!=a.end(); ++it)
-    myCpu.storeDouble(*it, i++);
-
-  i = 0;
-  for (auto it=b.begin(); it!=b.end(); ++it)
-    myCpu.storeDouble(*it, 2*i++);
-
-  for (auto it=c.begin(); it!=c.end(); ++it)
-    myCpu.storeDouble(*it, 0);
-
-  /* Reset the CPU to restart counting (with -s flag) */
-  if (params.resetResult())
-    myCpu.reset();
+  // The loads of an element of a block are a batch (c[i][j], then a[i][k], b[k][j] for every k of the block)
+  this->accesses.resize(1 + 2*blocking_factor);
+  this->values.resize(1 + 2*blocking_factor);
+  for (auto &access : this->accesses)
+    access.op = ACCESS_READ;
 
   for (unsigned sj=0; sj<test_size; sj += blocking_factor)
     for (unsigned si=0; si<test_size; si += blocking_factor)
       for (unsigned sk=0; sk<test_size; sk += blocking_factor) {
-        this->doBlock(myCpu, test_size, blocking_factor, si, sj, sk, a, b, c);
-        // cout << "si: " << si << " sj: " << sj << " sk: " << sk << endl;
+        this->doBlock(myCpu, test_size, blocking_factor, si, sj, sk, a.transposed(), b.transposed(), c.transposed());
+        // *this->out << "si: " << si << " sj: " << sj << " sk: " << sk << endl;
       }
+  this->accesses.clear();
+  this->values.clear();
 
-  print(cout, *(this->result));
+  print(*this->out, *(this->result));
 
   /* Correctness check (with -p flag) */
   if (params.printOutput()) {
-    cout << "##############################################\n";
-    cout << "-Blocked mxm- Correctness Check\n";
+    *this->out << "##############################################\n";
+    *this->out << "-Blocked mxm- Correctness Check\n";
 
-    cout << "Matrix A:\n";
+    *this->out << "Matrix A:\n";
     for (auto ri=0; ri!=test_size; ++ri) {
       for (auto ci=0; ci!=test_size; ++ci)
-        cout << fixed << setprecision(0) << myCpu.loadDouble(a[ri*test_size+ci]) << " ";
-      cout << "\n";
+        *this->out << fixed << setprecision(0) << myCpu.loadDouble(a(ri, ci)) << " ";
+      *this->out << "\n";
     }
 
-    cout << "Matrix B:\n";
+    *this->out << "Matrix B:\n";
     for (auto ri=0; ri!=test_size; ++ri) {
       for (auto ci=0; ci!=test_size; ++ci)
-        cout << fixed << setprecision(0) << myCpu.loadDouble(b[ri*test_size+ci]) << " ";
-      cout << "\n";
+        *this->out << fixed << setprecision(0) << myCpu.loadDouble(b(ri, ci)) << " ";
+      *this->out << "\n";
     }
 
-    cout << "Matrix C:\n";
+    *this->out << "Matrix C:\n";
     for (auto ri=0; ri!=test_size; ++ri) {
       for (auto ci=0; ci!=test_size; ++ci)
-        cout << fixed << setprecision(0) << myCpu.loadDouble(c[ri*test_size+ci]) << " ";
-      cout << "\n";
+        *this->out << fixed << setprecision(0) << myCpu.loadDouble(c(ri, ci)) << " ";
+      *this->out << "\n";
     }
   }
 
   return;
 }
 
-/* Subroutine of mxmMultBlock */
-void Algorithms::doBlock(CPU &myCpu, const unsigned test_size, const unsigned blocking_factor,
-  unsigned si, unsigned sj, unsigned sk, vector<Address> &a, vector<Address> &b,
-  vector<Address> &c) {
-    Register r0, r1, r2, r3;
+/* Subroutine of mxmMultBlock (the matrices are indexed in columns: a(i, k) is the element i+k*test_size) */
+template <class Memory>
+void Algorithms::doBlock(CPU<Memory> &myCpu, const unsigned test_size, const unsigned blocking_factor,
+  unsigned si, unsigned sj, unsigned sk, const Layout &a, const Layout &b, const Layout &c) {
+    Register r0, r3;
+    Access *batch = this->accesses.data();
+    const double *loaded = this->values.data();
     for (unsigned i=si; i<si+blocking_factor && i<this->testsize; ++i)
       for (unsigned j=sj; j<sj+blocking_factor && j<this->testsize; ++j) {
-        r0 = myCpu.loadDouble(c[i+j*test_size]);
+        unsigned n = 1;
+        batch[0].address = c(i, j);
         for (unsigned k=sk; k<sk+blocking_factor && k<this->testsize; ++k) {
-          r1 = myCpu.loadDouble(a[i+k*test_size]);
-          r2 = myCpu.loadDouble(b[k+j*test_size]);
-          r3 = myCpu.multDouble(r1, r2);
+          batch[n++].address = a(i, k);
+          batch[n++].address = b(k, j);
+        }
+        myCpu.batch(batch, batch + n, this->values.data());
+        r0 = loaded[0];
+        for (unsigned l=1; l!=n; l+=2) {
+          r3 = myCpu.multDouble(loaded[l], loaded[l+1]);
           r0 = myCpu.addDouble(r0, r3);
         }
-        myCpu.storeDouble(c[i+j*test_size], r0);
+        myCpu.storeDouble(c(i, j), r0);
       }
 }
@@ -1,202 +1,499 @@
 /* ./src/Cache.cc
  *
  *  class Cache controls memory access of the ISA.
+ *  Cache is templated on the replacement policy, the caches of all the policies are instantiated at the end.
  */
 
 #include "classes.hh"
 
 /* Constructor function */
-Cache::Cache(Parameters &p, Rule *r, Ram *rm, Result *resu) {
+template <class Policy>
+Cache<Policy>::Cache(Parameters &p, Rule *r, Ram *rm, Result *resu) {
   // Determine Parameters
   numSets = p.getSetCount();
   numBlocks = p.getSetSize();
+  blockSize = p.getBlockSize();
+  wordsPerBlock = blockSize / WORD_SIZE;
+  timingOnly = p.timingOnly();
+  writeBack = p.writeBack();
+  writeAllocate = p.writeAllocate();
 
-  // Insert datablocks
-  DataBlock DataOneBlock(p);
-  vector<DataBlock> oneSet(numBlocks, DataOneBlock);
-  for (unsigned i=0; i != numSets; ++i)
-    blocks.push_back(oneSet);
-
-  // Initialize validBits and tags
-  vector<bool> ValidBitOneSet(numBlocks, false);
-  for (unsigned i=0; i != numSets; ++i)
-    validBits.push_back(ValidBitOneSet);
-
-  vector<unsigned> TagOneSet(numBlocks, 0);
-  for (unsigned i=0; i != numSets; ++i)
-    tags.push_back(TagOneSet);
-
-  // Assign replacement rule
-  if (p.getReplacePolicy() == "LRU") {
-    replacement_rule = 0;
-    lru_queue.initialize(numSets);
-  } else if (p.getReplacePolicy() == "FIFO") {
-    replacement_rule = 1;
-    queue.initialize(numSets);
-  } else if (p.getReplacePolicy() == "random")
-    replacement_rule = 2;
-  else
-    throw string("Unknown replacement policy (Code: 003).\n");
+  // Allocate the payload of every block at once (none in timing mode)
+  if (!timingOnly)
+    payload.assign((size_t)numSets*numBlocks*wordsPerBlock, 0);
+
+  // Initialize the tags (all ways invalid, and clean)
+  tags.initialize(numSets, numBlocks);
+  dirty.assign(numSets*numBlocks, 0);
+
+  // Initialize the replacement state
+  policy.initialize(numSets, numBlocks);
 
   // Pass pointer to the constructor
   rule = r;
   ram = rm;
-  result = resu;
+  result = measured = resu;
+
+  // Sample one set in a power of two, or windows of the stream (warming the cache in between)
+  if (p.getSampledSets() > 1 && !Policy::setLocal)
+    throw string("The sets of ") + Policy::name() + " share a state, they cannot be sampled (Code: 003).\n";
+  sampleMask = p.getSampledSets() - 1;
+  window = p.getSampleWindow();
+  period = p.getSamplePeriod();
+  sampling = p.isSampled();
+  if (sampling) {
+    clusterAccesses.assign(window ? 1 : numSets, 0);
+    clusterMisses.assign(clusterAccesses.size(), 0);
+    resu->sampling(window ? (double)window / period : 1.0 / p.getSampledSets());
+  }
+  if (window) {
+    result = &warming;
+    untilSwitch = period - window;
+  }
+
+  // The prefetcher (if any), no block is prefetched yet
+  prefetcher = Prefetcher::create(p.getPrefetcher(), p.getPrefetchDegree(), blockSize);
+  if (prefetcher) {
+    latency = p.getPrefetchLatency();
+    issuedAt.assign(numSets*numBlocks, 0);
+    evicted.assign(numSets*numBlocks, UINT64_MAX);
+    resu->prefetching();
+  }
+
+  // The classifier of the misses (if any), its shadow has as many blocks as the cache
+  if (p.classifyMisses()) {
+    classifier.reset(new MissClassifier(numSets*numBlocks));
+    resu->classifying();
+  }
+
+  // The victim cache (or miss cache) beside the cache (if any), empty
+  if (p.getVictimEntries()) {
+    victims.reset(new VictimCache(p.getVictimEntries()));
+    missCache = p.isMissCache();
+    resu->victim_caching(missCache);
+  }
 }
 
 /* Display the runtime memory contents in the cache */
-void Cache::show() {
-  unsigned set_ct = 0;
-  for (auto &s : this->blocks) {
-    cout << "Set " << set_ct++ << " :\n";
-    unsigned block_ct = 0;
-    for (auto &b : s) {
-      cout << "Block " << block_ct++ << " : ";
-      b.show();
+template <class Policy>
+void Cache<Policy>::show() {
+  if (this->timingOnly) {
+    cout << "Timing mode, no data in the cache" << endl;
+    return;
+  }
+  for (unsigned set_id=0; set_id != this->numSets; ++set_id) {
+    cout << "Set " << set_id << " :\n";
+    for (unsigned block_id=0; block_id != this->numBlocks; ++block_id) {
+      cout << "Block " << block_id << " : ";
+      this->getBlock(set_id, block_id).show();
     }
   }
   cout << endl;
 }
 
 /* Get the value from the address supplied (public member function) */
-double Cache::getDouble(Address address) {
-  // Find the data in the blocks
-  DataBlock &target = this->findBlock(address, false);
-  // Get the in-block index
-  unsigned offset = this->rule->getBlockOffset(address);
-
-  // Obtain the value from DataBlock
-  return target.get(offset);
+template <class Policy>
+double Cache<Policy>::getDouble(Address address) {
+  // Find the data in the blocks, and obtain the value from DataBlock
+  unsigned index = this->findBlock(address, false);
+  double value = this->timingOnly ? 0 : this->load(index, address);
+  if (this->prefetcher)
+    this->prefetchPending();
+  return value;
 }
 
 /* Write the value to the given address */
-void Cache::setDouble(Address address, double value) {
-  // Find the block
-  DataBlock &target = this->findBlock(address, true);
+template <class Policy>
+void Cache<Policy>::setDouble(Address address, double value) {
+  // Find the block, and update the value
+  unsigned index = this->findBlock(address, true);
+  if (!this->timingOnly)
+    this->store(index, address, value);
+  if (this->prefetcher)
+    this->prefetchPending();
+}
+
+/* Run a batch of reads and writes in order: the sets and tags of ACCESS_DECODE accesses are decoded at once,
+ * then every access is looked up (and its payload read or written) as getDouble() or setDouble() would */
+template <class Policy>
+void Cache<Policy>::batch(const Access *first, const Access *last, double *values) {
+  unsigned sets[ACCESS_DECODE];
+  Tag tags[ACCESS_DECODE];
+  while (first != last) {
+    unsigned n = last - first < ACCESS_DECODE ? last - first : ACCESS_DECODE;
+    this->rule->decode(first, n, sets, tags);
+    for (unsigned i=0; i!=n; ++i) {
+      bool write = first[i].op == ACCESS_WRITE;
+      unsigned index = this->lookup(sets[i], tags[i], first[i].address, write);
+      if (!this->timingOnly && write)
+        this->store(index, first[i].address, values[i]);
+      else if (!this->timingOnly)
+        values[i] = this->load(index, first[i].address);
+      if (this->prefetcher)
+        this->prefetchPending();
+    }
+    first += n;
+    if (!this->timingOnly)
+      values += n;
+  }
+}
+
+/* Read the word of an address from the block found at an index (payload mode) */
+template <class Policy>
+inline double Cache<Policy>::load(unsigned index, Address address) {
+  return this->getBlock(index).get(this->rule->getBlockOffset(address));
+}
+
+/* Write the word of an address to the block found at an index (payload mode) */
+template <class Policy>
+inline void Cache<Policy>::store(unsigned index, Address address, double value) {
   // Get the in-block index
   unsigned offset = this->rule->getBlockOffset(address);
 
-  // Update the value in the cache
-  target.set(offset, value);
-  // Also update the value in the ram
-  this->ram->setBlock(address, target);
+  // Update the value in the cache (a write around it updates the ram only)
+  if (index != NO_BLOCK)
+    this->getBlock(index).set(offset, value);
+  // Write the word through to the ram (a write-back cache writes the whole block when it is evicted)
+  if (index == NO_BLOCK || !this->writeBack)
+    this->ram->getBlock(address)[offset/WORD_SIZE] = value;
 }
 
 /* Search the block by the given Address in the cache,
- * write indicates whether it is a read (false) or write (true)
+ * write indicates whether it is a read (false) or write (true),
+ * returns the index of the block (set_id*numBlocks+block_id)
  */
-DataBlock &Cache::findBlock(Address address, bool write) {
-  // get set_id
-  unsigned set_id = this->rule->getSetIndex(address);
-  // get tag
-  unsigned tag = this->rule->getTag(address);
-
-  /* Iterate to find the -matching- record */
-  unsigned block_id = 0;
-
-  for (auto blkTag : this->tags[set_id]) {
-    // Linear search
-    if (this->validBits[set_id][block_id] && blkTag == tag) {
-      // New Block Found, record the state of block_id
-      // Also Need to update the replacement queue when LRU is applied
-      if (this->replacement_rule == 0) this->lru_queue.update(set_id, block_id);
-      // If found, simply break the for loop
-      break;
-    }
-    ++block_id;
-  }
+template <class Policy>
+unsigned Cache<Policy>::findBlock(Address address, bool write) {
+  return this->lookup(this->rule->getSetIndex(address), this->rule->getTag(address), address, write);
+}
+
+/* Search the block of a decoded address (its set and tag) in the cache, see findBlock */
+template <class Policy>
+inline unsigned Cache<Policy>::lookup(unsigned set_id, Tag tag, Address address, bool write) {
+  /* Skip the sets not sampled, and start or end the window of a time sample */
+  if (set_id & this->sampleMask)
+    return NO_BLOCK;
+  if (this->untilSwitch-- == 0)
+    this->switchPhase();
+
+  /* Search the row of the set for the -matching- record (a stream buffer may hold it) */
+  unsigned block_id = this->tags.find(set_id, tag);
+  if (block_id == this->numBlocks && this->prefetcher && this->prefetcher->buffered())
+    block_id = this->takeBuffered(set_id, tag, address);
 
   /* Record the hit/miss */
   if (block_id != this->numBlocks) {
-    // Hit
-    if (write)
+    // Hit, update the replacement state
+    this->policy.touch(set_id, block_id);
+    unsigned index = set_id*this->numBlocks + block_id;
+    this->sampled(set_id, false);
+    if (write) {
       this->result->write_hit();
-    else
+      this->written(index);
+    } else
       this->result->read_hit();
+    if (this->prefetcher)
+      this->prefetchAfter(address, index, false);
+    if (this->classifier)
+      this->classifier->classify(this->rule->getBlockIndexRAM(address), true);
 
-    return this->blocks[set_id][block_id];
+    return index;
   } else {
-    // Miss, call updateBlock
-    if (write)
-      this->result->write_miss();
-    else
+    // Miss, call updateBlock (a write miss without write-allocate goes around the cache)
+    this->sampled(set_id, true);
+    if (this->classifier)
+      this->result->miss_class(this->classifier->classify(this->rule->getBlockIndexRAM(address), !write || this->writeAllocate));
+    unsigned index = NO_BLOCK;
+    // A block the victim cache holds comes from it (nothing is fetched), a dirty one stays dirty
+    bool supplied = false, wasDirty = false;
+    if (this->victims && (!write || this->writeAllocate))
+      supplied = this->takeVictim(address, wasDirty);
+    if (!write) {
       this->result->read_miss();
-
-    return this->updateBlock(address);
+      if (!supplied)
+        this->result->fetch(this->blockSize);
+      index = this->updateBlock(set_id, tag, address);
+    } else if (!this->writeAllocate) {
+      this->result->write_miss();
+      this->result->write_through(WORD_SIZE);
+      this->policy.bypass();
+    } else {
+      this->result->write_miss();
+      if (!supplied)
+        this->result->fetch(this->blockSize);
+      index = this->updateBlock(set_id, tag, address);
+      this->written(index);
+    }
+    if (wasDirty)
+      this->dirty[index] = 1;
+    if (this->prefetcher)
+      this->prefetchAfter(address, index, true);
+    return index;
   }
 
   // End of function
 }
 
-/* Fetch the block from RAM if read/write miss occurs */
-DataBlock &Cache::updateBlock(Address address) {
-  // get set_id
-  unsigned set_id = this->rule->getSetIndex(address);
-  // get the target block (that is moved from RAM)
-  DataBlock &newblock = this->fetchBlock(address);
-
-  /* Iterate to find the -empty- block */
-  unsigned block_id = 0;
-
-  for (auto blkValidBit : this->validBits[set_id]) {
-    // Find an empty block
-    if (!blkValidBit) {
-      // Block Found
-      this->validBits[set_id][block_id] = true; // turn to valid
-      this->tags[set_id][block_id] = this->rule->getTag(address);
-      this->blocks[set_id][block_id].replace(newblock);
-
-      // Update the queue (if FIFO or LRU)
-      // Push the entry into queue (if FIFO)
-      if (this->replacement_rule == 1)
-        this->queue.push(set_id, block_id);
-      // Push the entry into LRU (if LRU)
-      else if (this->replacement_rule == 0)
-        this->lru_queue.push(set_id, block_id);
-
-      // Update complete, return the reference
-      return this->blocks[set_id][block_id];
-    }
-    ++block_id;
+/* Time sampling: start a window (the accesses are measured from now on), or end it (they only warm the cache) */
+template <class Policy>
+void Cache<Policy>::switchPhase() {
+  if (this->result == this->measured) {
+    this->result = &this->warming;
+    this->untilSwitch = this->period - this->window - 1;
+  } else {
+    this->result = this->measured;
+    this->untilSwitch = this->window - 1;
+    this->clusterAccesses[0] = this->clusterMisses[0] = 0;
+  }
+}
+
+/* Fetch the block from RAM if read/write miss occurs, returns its index (the caller counts the fetch) */
+template <class Policy>
+unsigned Cache<Policy>::updateBlock(unsigned set_id, Tag tag, Address address) {
+  /* Search the row of the set for an -empty- block */
+  unsigned block_id = this->tags.findInvalid(set_id);
+
+  if (block_id != this->numBlocks) {
+    // Block Found, turn to valid (and clean)
+    this->tags.set(set_id, block_id, tag);
+    this->dirty[set_id*this->numBlocks + block_id] = 0;
+    // Move the target block from RAM (unless in timing mode)
+    if (!this->timingOnly)
+      this->getBlock(set_id, block_id).load(this->fetchBlock(address));
+
+    // Update the replacement state
+    this->policy.insert(set_id, block_id);
+
+    // Update complete, return the index
+    return set_id*this->numBlocks + block_id;
   }
 
   // No empty block found, must replace one of the blocks
-  return this->replaceBlock(address);
+  return this->replaceBlock(set_id, tag, address);
 }
 
 /* Replace a block in Cache by the new block (supplied by the address),
- * return the reference of the new block
+ * return the index of the new block
  */
-DataBlock &Cache::replaceBlock(Address address) {
-  // get set_id
+template <class Policy>
+unsigned Cache<Policy>::replaceBlock(unsigned set_id, Tag tag, Address address) {
+  // Determine the block to replace (write it back if it is dirty), and insert the new block in its place
+  unsigned block_id = this->policy.victim(set_id);
+  this->policy.insert(set_id, block_id);
+  if (this->victims && !this->missCache)
+    this->evictToVictims(set_id, block_id);
+  else if (this->dirty[set_id*this->numBlocks + block_id])
+    this->writeBackBlock(set_id, block_id);
+
+  // Update the block (the payload is moved from RAM unless in timing mode)
+  if (!this->timingOnly)
+    this->getBlock(set_id, block_id).load(this->fetchBlock(address));
+  this->tags.set(set_id, block_id, tag);
+
+  // return the index
+  return set_id*this->numBlocks + block_id;
+}
+
+/* After a demand access: a block prefetched and not used yet is useful (late if it was used before the latency of its prefetch),
+ * a miss on a block a prefetch evicted counts it as polluting, then the prefetcher sees the access and names the blocks to prefetch
+ * (they are prefetched by prefetchPending() once the payload of the access is read or written, a prefetch may evict its block) */
+template <class Policy>
+void Cache<Policy>::prefetchAfter(Address address, unsigned index, bool miss) {
+  uint64_t block = this->rule->getBlockIndexRAM(address);
+  bool useful = index != NO_BLOCK && this->issuedAt[index] != 0;
+  if (useful) {
+    this->result->prefetch_used(this->prefetcher->time() - this->issuedAt[index] < this->latency);
+    this->issuedAt[index] = 0;
+  }
+  uint64_t &victim = this->evicted[block % this->evicted.size()];
+  if (miss && victim == block) {
+    this->result->prefetch_polluted();
+    victim = UINT64_MAX;
+  }
+
+  this->prefetcher->access(address, miss, useful);
+}
+
+/* Prefetch the blocks the prefetcher named after the last access */
+template <class Policy>
+void Cache<Policy>::prefetchPending() {
+  for (auto candidate : this->prefetcher->candidates)
+    this->prefetchBlock(candidate);
+  this->prefetcher->candidates.clear();
+}
+
+/* Prefetch a block: a stream buffer holds it apart (the cache holding it too does not matter), any other prefetcher fills it
+ * into the cache, unless the cache holds it already; its victim is written back if it is dirty, and remembered (unless it was
+ * a prefetched block, never used) to tell whether the prefetch polluted the cache */
+template <class Policy>
+void Cache<Policy>::prefetchBlock(uint64_t block) {
+  Address address = (Address)block * this->blockSize;
   unsigned set_id = this->rule->getSetIndex(address);
-  // get the target block
-  DataBlock &newblock = this->fetchBlock(address);
-
-  unsigned block_id;
-  // Determine the block to replace
-  if (this->replacement_rule == 2)
-    block_id = this->replaceRandom();
-  else if (this->replacement_rule == 1) {
-    block_id = this->queue.pop(set_id);
-    this->queue.push(set_id, block_id);
-  } else if (this->replacement_rule == 0) {
-    block_id = this->lru_queue.pop(set_id);
-    this->lru_queue.push(set_id, block_id);
-  } else
-    throw string("Unknow Replacement Method (Code: 003).\n");
-
-  // Update the block
-  this->blocks[set_id][block_id].replace(newblock);
-  this->tags[set_id][block_id] = this->rule->getTag(address);
-
-  // return the reference
-  return this->blocks[set_id][block_id];
-}
-
-/* Reset the cache (turn all validBits to false) */
-void Cache::reset() {
-  for (auto &BitBlock : this->validBits)
-    for (auto it=BitBlock.begin(); it!=BitBlock.end(); ++it)
-      (*it) = false;
+  Tag tag = this->rule->getTag(address);
+  if (this->prefetcher->buffered()) {
+    this->result->prefetch(this->blockSize);
+    return;
+  }
+  if (this->tags.find(set_id, tag) != this->numBlocks)
+    return;
+  this->result->prefetch(this->blockSize);
+
+  unsigned block_id = this->tags.findInvalid(set_id);
+  if (block_id == this->numBlocks) {
+    block_id = this->policy.victim(set_id);
+    unsigned index = set_id*this->numBlocks + block_id;
+    if (this->issuedAt[index] == 0) {
+      uint64_t victim = this->rule->getBlockIndexRAM(this->rule->getAddress(this->tags.get(set_id, block_id), set_id));
+      this->evicted[victim % this->evicted.size()] = victim;
+    }
+    if (this->dirty[index])
+      this->writeBackBlock(set_id, block_id);
+  }
+  unsigned index = set_id*this->numBlocks + block_id;
+  this->tags.set(set_id, block_id, tag);
+  this->dirty[index] = 0;
+  if (!this->timingOnly)
+    this->getBlock(index).load(this->fetchBlock(address));
+  this->policy.insert(set_id, block_id);
+  this->issuedAt[index] = this->prefetcher->time();
 }
+
+/* A miss on a block a stream buffer holds: the block moves into the cache (it was fetched when it was prefetched),
+ * marked as prefetched at the time the buffer fetched it, so the access uses it as it hits */
+template <class Policy>
+unsigned Cache<Policy>::takeBuffered(unsigned set_id, Tag tag, Address address) {
+  uint64_t issued;
+  if (!this->prefetcher->supply(this->rule->getBlockIndexRAM(address), issued))
+    return this->numBlocks;
+  unsigned index = this->updateBlock(set_id, tag, address);
+  this->issuedAt[index] = issued;
+  return index - set_id*this->numBlocks;
+}
+
+/* A miss that fills the cache: a victim cache that holds the block gives it up (the victim of the cache takes its entry),
+ * a miss cache that holds it keeps it, and one that does not receives it; true if the block was held */
+template <class Policy>
+bool Cache<Policy>::takeVictim(Address address, bool &wasDirty) {
+  uint64_t block = this->rule->getBlockIndexRAM(address);
+  unsigned entry = this->victims->find(block);
+  if (entry != this->victims->size()) {
+    this->result->victim_hit();
+    if (this->missCache)
+      this->victims->touch(entry);
+    else
+      wasDirty = this->victims->take(entry);
+    return true;
+  }
+  // The blocks of a miss cache are clean copies, dropping one writes nothing back
+  uint64_t evicted;
+  bool evictedDirty;
+  if (this->missCache)
+    this->victims->insert(block, false, evicted, evictedDirty);
+  return false;
+}
+
+/* Move the victim of a replacement into the victim cache: its payload is written to the ram at once (the victim cache holds
+ * the tags only), the writeback of a dirty block is counted when it leaves the victim cache */
+template <class Policy>
+void Cache<Policy>::evictToVictims(unsigned set_id, unsigned block_id) {
+  unsigned index = set_id*this->numBlocks + block_id;
+  Address address = this->rule->getAddress(this->tags.get(set_id, block_id), set_id);
+  if (this->dirty[index] && !this->timingOnly)
+    this->ram->setBlock(address, this->getBlock(index));
+  uint64_t evicted;
+  bool evictedDirty;
+  if (this->victims->insert(this->rule->getBlockIndexRAM(address), this->dirty[index], evicted, evictedDirty) && evictedDirty)
+    this->result->writeback(this->blockSize);
+  this->dirty[index] = 0;
+}
+
+/* Write a dirty block back to the ram (its payload, unless in timing mode), it is clean afterwards */
+template <class Policy>
+void Cache<Policy>::writeBackBlock(unsigned set_id, unsigned block_id) {
+  this->result->writeback(this->blockSize);
+  if (!this->timingOnly)
+    this->ram->setBlock(this->rule->getAddress(this->tags.get(set_id, block_id), set_id), this->getBlock(set_id, block_id));
+  this->dirty[set_id*this->numBlocks + block_id] = 0;
+}
+
+/* Reset the cache (invalidate all the tags, and forget the replacement state of the invalidated blocks),
+ * the payload of the dirty blocks is written to the ram first, so no data is lost (the results are reset right after) */
+template <class Policy>
+void Cache<Policy>::reset() {
+  if (!this->timingOnly)
+    for (unsigned set_id=0; set_id != this->numSets; ++set_id)
+      for (unsigned block_id=0; block_id != this->numBlocks; ++block_id)
+        if (this->dirty[set_id*this->numBlocks + block_id])
+          this->writeBackBlock(set_id, block_id);
+  this->tags.reset();
+  this->policy.reset();
+  this->dirty.assign(this->dirty.size(), 0);
+  if (this->prefetcher) {
+    this->prefetcher->reset();
+    this->issuedAt.assign(this->issuedAt.size(), 0);
+    this->evicted.assign(this->evicted.size(), UINT64_MAX);
+  }
+  if (this->classifier)
+    this->classifier->reset();
+  if (this->victims)
+    this->victims->reset();
+
+  // Sampling starts over (with the warming before the first window)
+  this->clusterAccesses.assign(this->clusterAccesses.size(), 0);
+  this->clusterMisses.assign(this->clusterMisses.size(), 0);
+  if (this->window) {
+    this->result = &this->warming;
+    this->untilSwitch = this->period - this->window;
+  }
+}
+
+/* Write the state of the cache to a checkpoint, after its geometry and policy (checked by restore()) */
+template <class Policy>
+void Cache<Policy>::save(CheckpointWriter &w) const {
+  w.put(this->numSets);
+  w.put(this->numBlocks);
+  w.put(this->blockSize);
+  w.put(string(Policy::name()));
+  w.put((uint8_t)this->timingOnly);
+  this->tags.save(w);
+  w.put(this->dirty);
+  if (!this->timingOnly)
+    w.put(this->payload);
+  this->policy.save(w);
+  // The sampling state (the cluster of every sampled set, or the window being measured or warmed)
+  w.put(this->clusterAccesses);
+  w.put(this->clusterMisses);
+  w.put(this->untilSwitch);
+  w.put((uint8_t)(this->result == this->measured));
+}
+
+/* Read the state of the cache back from a checkpoint of a cache of the same geometry and policy */
+template <class Policy>
+void Cache<Policy>::restore(CheckpointReader &r) {
+  unsigned sets, blocks, size;
+  string name;
+  uint8_t timing, measuring;
+  r.get(sets);
+  r.get(blocks);
+  r.get(size);
+  r.get(name);
+  r.get(timing);
+  if (sets != this->numSets || blocks != this->numBlocks || size != this->blockSize || name != Policy::name()
+      || (bool)timing != this->timingOnly)
+    CheckpointReader::mismatch();
+  this->tags.restore(r);
+  r.get(this->dirty);
+  if (!this->timingOnly)
+    r.get(this->payload);
+  this->policy.restore(r);
+  r.get(this->clusterAccesses);
+  r.get(this->clusterMisses);
+  r.get(this->untilSwitch);
+  r.get(measuring);
+  this->result = measuring ? this->measured : &this->warming;
+}
+
+/* Instantiate the cache of every replacement policy */
+#define INSTANTIATE_CACHE(P) template class Cache<P>;
+FOR_EACH_POLICY(INSTANTIATE_CACHE)
+#undef INSTANTIATE_CACHE
@@ -0,0 +1,162 @@
+/* ./src/Hierarchy.cc
+ *
+ *  class Hierarchy simulates the levels of a hierarchy of caches (-L), the miss of a level goes to the next one.
+ *  Hierarchy is templated on the replacement policy, the hierarchies of all the policies are instantiated at the end.
+ */
+
+#include "classes.hh"
+#include <iomanip>
+
+/* Constructor: L1 is the cache of the parameters (it counts in the Result of the CPU), every other level has a Rule and a Result of its own */
+template <class Policy>
+Hierarchy<Policy>::Hierarchy(Parameters &p, Rule *r, Ram *rm, Result *resu) {
+  this->inclusion = p.getInclusion();
+  this->levels.emplace_back(new Level(p, r, rm, resu));
+  for (auto &level : p.levels()) {
+    this->rules.emplace_back(new Rule(level));
+    this->results.emplace_back(new Result());
+    this->levels.emplace_back(new Level(level, this->rules.back().get(), rm, this->results.back().get()));
+  }
+  this->backInvalidations.assign(this->levels.size(), 0);
+  this->blockSize = p.getBlockSize();
+}
+
+/* Simulate an access: look it up level by level, then move the block by the inclusion policy,
+ * the levels are write-back: a write dirties the block in L1, and a dirty victim is written back to the next level that holds it */
+template <class Policy>
+void Hierarchy<Policy>::access(Address address, bool write) {
+  const size_t n = this->levels.size();
+  Cache<Policy> &l1 = this->levels[0]->cache;
+  if (l1.probe(address, write)) {
+    if (write)
+      l1.markDirty(address);
+    return;
+  }
+
+  // The first level below L1 that holds the block (n if none, it is read from the ram)
+  size_t found = 1;
+  while (found != n && !this->levels[found]->cache.probe(address, write))
+    ++found;
+  if (found == n)
+    this->memoryRead += this->blockSize;
+
+  Address victim = 0;
+  bool victimDirty = false;
+  if (this->inclusion == INCLUSION_EXCLUSIVE) {
+    // The block moves up to L1 (with its dirty bit), and every victim moves down one level (the victim of the last level is dropped)
+    bool dirty = write;
+    if (found != n) {
+      bool wasDirty = false;
+      this->levels[found]->cache.invalidate(address, wasDirty);
+      dirty |= wasDirty;
+    }
+    this->levels[0]->result->fetch(this->blockSize);
+    Address moving = address;
+    for (size_t l=0; l!=n && this->levels[l]->cache.fill(moving, dirty, victim, victimDirty); ++l) {
+      if (victimDirty)
+        this->levels[l]->result->writeback(this->blockSize);
+      if (l == n-1 && victimDirty)
+        this->memoryWritten += this->blockSize;
+      moving = victim;
+      dirty = victimDirty;
+    }
+    return;
+  }
+
+  // Fill every level above the one that holds the block, from the lowest one up (the block is dirty in L1 only)
+  for (size_t l=found; l--!=0; ) {
+    this->levels[l]->result->fetch(this->blockSize);
+    if (!this->levels[l]->cache.fill(address, l == 0 && write, victim, victimDirty))
+      continue;
+    // Inclusive: the victim of a level cannot stay above it (a dirty copy above it is written back with it)
+    if (this->inclusion == INCLUSION_INCLUSIVE)
+      for (size_t u=0; u!=l; ++u) {
+        bool wasDirty = false;
+        if (this->levels[u]->cache.invalidate(victim, wasDirty)) {
+          ++this->backInvalidations[l];
+          victimDirty |= wasDirty;
+        }
+      }
+    if (victimDirty)
+      this->writeBack(l, victim);
+  }
+}
+
+/* Write a dirty victim of a level back to the next level that holds it (or to the ram) */
+template <class Policy>
+void Hierarchy<Policy>::writeBack(size_t level, Address victim) {
+  this->levels[level]->result->writeback(this->blockSize);
+  for (size_t l=level+1; l!=this->levels.size(); ++l)
+    if (this->levels[l]->cache.markDirty(victim))
+      return;
+  this->memoryWritten += this->blockSize;
+}
+
+/* Invalidate every level, and clear the results of the levels below L1 (CPU::reset() clears the result of L1) */
+template <class Policy>
+void Hierarchy<Policy>::reset() {
+  for (auto &level : this->levels)
+    level->cache.reset();
+  for (auto &result : this->results)
+    result->reset();
+  this->backInvalidations.assign(this->levels.size(), 0);
+  this->memoryRead = this->memoryWritten = 0;
+}
+
+/* Write every level, the results of the levels below L1, and the traffic to a checkpoint (CPU::save() writes the result of L1) */
+template <class Policy>
+void Hierarchy<Policy>::save(CheckpointWriter &w) const {
+  w.put((uint64_t)this->levels.size());
+  for (auto &level : this->levels)
+    level->cache.save(w);
+  for (auto &result : this->results)
+    result->save(w);
+  w.put(this->backInvalidations);
+  w.put(this->memoryRead);
+  w.put(this->memoryWritten);
+}
+
+/* Read the levels back from a checkpoint of a hierarchy of as many levels */
+template <class Policy>
+void Hierarchy<Policy>::restore(CheckpointReader &r) {
+  uint64_t n;
+  r.get(n);
+  if (n != this->levels.size())
+    CheckpointReader::mismatch();
+  for (auto &level : this->levels)
+    level->cache.restore(r);
+  for (auto &result : this->results)
+    result->restore(r);
+  r.get(this->backInvalidations);
+  r.get(this->memoryRead);
+  r.get(this->memoryWritten);
+}
+
+/* Print the results of the levels below L1 */
+template <class Policy>
+ostream &print(ostream &os, const Hierarchy<Policy> &hierarchy) {
+  for (size_t l=1; l!=hierarchy.levels.size(); ++l) {
+    const Result &result = *hierarchy.levels[l]->result;
+    os << "L" << l+1 << " RESULTS====================================\n";
+    os << "Read hits:\t\t" << result.count_read_hits() << "\n";
+    os << "Read misses:\t\t" << result.count_read_misses() << "\n";
+    os << "Read miss rate:\t\t" << setprecision(3) << result.count_read_miss_rate()*100 << "%\n";
+    os << "Write hits:\t\t" << result.count_write_hits() << "\n";
+    os << "Write misses:\t\t" << result.count_write_misses() << "\n";
+    os << "Write miss rate:\t" << setprecision(3) << result.count_write_miss_rate()*100 << "%\n";
+    os << "Writebacks:\t\t" << result.count_writebacks() << "\n";
+    os << "Traffic below:\t\t" << result.count_read_bytes() << " bytes read, " << result.count_written_bytes() << " bytes written\n";
+    if (hierarchy.inclusion == INCLUSION_INCLUSIVE)
+      os << "Back-invalidations:\t" << hierarchy.backInvalidations[l] << "\n";
+  }
+  os << "MEMORY======================================\n";
+  os << "Memory traffic:\t\t" << hierarchy.memoryRead << " bytes read, " << hierarchy.memoryWritten << " bytes written\n";
+  os << flush;
+
+  return os;
+}
+
+/* Instantiate the hierarchy of every replacement policy */
+#define INSTANTIATE_HIERARCHY(P) template class Hierarchy<P>; template ostream &print(ostream &os, const Hierarchy<P> &hierarchy);
+FOR_EACH_POLICY(INSTANTIATE_HIERARCHY)
+#undef INSTANTIATE_HIERARCHY
@@ -0,0 +1,267 @@
+/* ./src/Multicore.cc
+ *
+ *  class Multicore simulates the cores of a multicore (-N), their private caches are kept coherent by a snooping bus
+ *  (MSI, MESI, or MOESI), in front of a shared level (-L) or of the memory.
+ *  Every core runs on a host thread of its own, and the cores are synchronized every quantum (see classes.hh).
+ *  Multicore is templated on the replacement policy, the multicores of all the policies are instantiated at the end.
+ */
+
+#include "classes.hh"
+#include <iomanip>
+
+#define PRECISION_DOUBLE 1
+
+/* Constructor: the private cache of every core has the geometry of the parameters, the shared level is the level of -L */
+template <class Policy>
+Multicore<Policy>::Multicore(Parameters &p, Rule *r, Result *resu) {
+  this->rule = r;
+  this->result = resu;
+  this->protocol = p.getProtocol();
+  this->blockSize = p.getBlockSize();
+  this->numSets = p.getSetCount();
+  this->numBlocks = p.getSetSize();
+  for (unsigned i=0; i!=p.getCores(); ++i) {
+    this->cores.emplace_back(new Core(this, i));
+    this->cores.back()->quantum.reserve(p.getQuantum());
+  }
+  if (p.isHierarchy()) {
+    Parameters level = p.levels()[0];
+    this->shared.reset(new Shared(level));
+  }
+}
+
+/* The private cache of a core, every line invalid */
+template <class Policy>
+Multicore<Policy>::Core::Core(Multicore *m, unsigned i) {
+  this->owner = m;
+  this->id = i;
+  this->tags.initialize(m->numSets, m->numBlocks);
+  this->policy.initialize(m->numSets, m->numBlocks);
+  this->states.assign((size_t)m->numSets * m->numBlocks, LINE_INVALID);
+}
+
+/* Run the kernel of every core on a thread of its own, and add the results of the cores to the one of the CPU */
+template <class Policy>
+void Multicore<Policy>::run(const function<void(unsigned, CPU<Core>&)> &kernel) {
+  this->active = this->cores.size();
+  vector<thread> threads;
+  for (auto &c : this->cores) {
+    Core *core = c.get();
+    threads.emplace_back([this, core, &kernel] {
+      CPU<Core> cpu(core, &core->result);
+      kernel(core->id, cpu);
+      // The last quantum (it may be shorter), the core leaves once the bus is resolved
+      this->step(*core, true);
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+  for (auto &core : this->cores)
+    this->result->merge(core->result);
+}
+
+/* Simulate the quantum of a core on its cache: the accesses that need the bus fill or update the line at once,
+ * and leave a request (resolve() sets the state of the line the bus gives) */
+template <class Policy>
+void Multicore<Policy>::Core::simulate() {
+  const Rule *rule = this->owner->rule;
+  const unsigned numBlocks = this->owner->numBlocks, blockSize = this->owner->blockSize;
+  for (auto &access : this->quantum) {
+    unsigned set_id = rule->getSetIndex(access.address);
+    Tag tag = rule->getTag(access.address);
+    bool write = access.op == ACCESS_WRITE;
+    unsigned block_id = this->tags.find(set_id, tag);
+    if (block_id != numBlocks) {
+      this->policy.touch(set_id, block_id);
+      write ? this->result.write_hit() : this->result.read_hit();
+      uint8_t &state = this->states[set_id*numBlocks + block_id];
+      // A write to a line that is not the only copy invalidates the others (an exclusive line is written silently)
+      if (write && state != LINE_MODIFIED) {
+        if (state != LINE_EXCLUSIVE) {
+          Request request = {access.address, BUS_UPGRADE};
+          this->requests.push_back(request);
+        }
+        state = LINE_MODIFIED;
+      }
+      continue;
+    }
+
+    // A miss on a line another core invalidated is a coherence miss
+    write ? this->result.write_miss() : this->result.read_miss();
+    if (this->lost.erase(rule->getBlockIndexRAM(access.address)))
+      ++this->coherenceMisses;
+    this->result.fetch(blockSize);
+    block_id = this->tags.findInvalid(set_id);
+    if (block_id == numBlocks) {
+      block_id = this->policy.victim(set_id);
+      uint8_t state = this->states[set_id*numBlocks + block_id];
+      if (state == LINE_MODIFIED || state == LINE_OWNED) {
+        Request request = {rule->getAddress(this->tags.get(set_id, block_id), set_id), BUS_WRITEBACK};
+        this->requests.push_back(request);
+        this->result.writeback(blockSize);
+      }
+    }
+    this->tags.set(set_id, block_id, tag);
+    this->policy.insert(set_id, block_id);
+    this->states[set_id*numBlocks + block_id] = write ? LINE_MODIFIED : LINE_SHARED;
+    Request request = {access.address, write ? BUS_READ_EXCLUSIVE : BUS_READ};
+    this->requests.push_back(request);
+  }
+  this->quantum.clear();
+}
+
+/* Simulate the quantum of a core, and wait for the other cores to be done with theirs,
+ * the last one resolves the bus (a core leaves with its last quantum, the others go on without it) */
+template <class Policy>
+void Multicore<Policy>::step(Core &core, bool last) {
+  core.simulate();
+  unique_lock<mutex> guard(this->lock);
+  ++this->arrived;
+  this->leaving += last;
+  if (this->arrived == this->active) {
+    this->resolve();
+    this->active -= this->leaving;
+    this->arrived = this->leaving = 0;
+    ++this->round;
+    guard.unlock();
+    this->next.notify_all();
+    return;
+  }
+  uint64_t current = this->round;
+  this->next.wait(guard, [&] { return this->round != current; });
+}
+
+/* Apply the requests of every core on the bus, in the order of the cores */
+template <class Policy>
+void Multicore<Policy>::resolve() {
+  for (auto &requester : this->cores) {
+    for (auto &request : requester->requests) {
+      if (request.op == BUS_WRITEBACK) {
+        this->writeBack(request.address);
+        continue;
+      }
+      unsigned set_id = this->rule->getSetIndex(request.address);
+      Tag tag = this->rule->getTag(request.address);
+      unsigned line = requester->tags.find(set_id, tag);
+      uint8_t *state = line == this->numBlocks ? nullptr : &requester->states[set_id*this->numBlocks + line];
+      // A write to a line the read before it (in the same quantum) got exclusive is silent after all
+      if (request.op == BUS_UPGRADE && state && *state == LINE_EXCLUSIVE) {
+        *state = LINE_MODIFIED;
+        continue;
+      }
+      bool sharers = false, supplied = false;
+      for (auto &other : this->cores) {
+        if (other == requester)
+          continue;
+        unsigned block_id = other->tags.find(set_id, tag);
+        if (block_id == this->numBlocks)
+          continue;
+        uint8_t &copy = other->states[set_id*this->numBlocks + block_id];
+        if (request.op == BUS_READ) {
+          // A read: the dirty copy supplies the line, and is kept as owned (MOESI), or written back and shared
+          sharers = true;
+          supplied |= copy == LINE_MODIFIED || copy == LINE_OWNED;
+          if (copy == LINE_MODIFIED && this->protocol == PROTOCOL_MOESI)
+            copy = LINE_OWNED;
+          else if (copy == LINE_MODIFIED) {
+            other->result.writeback(this->blockSize);
+            this->writeBack(request.address);
+            copy = LINE_SHARED;
+          } else if (copy == LINE_EXCLUSIVE)
+            copy = LINE_SHARED;
+        } else {
+          // A write: every other copy is invalidated (a dirty one supplies the line, its ownership moves with it)
+          supplied |= copy == LINE_MODIFIED || copy == LINE_OWNED;
+          other->tags.invalidate(set_id, block_id);
+          other->policy.invalidate(set_id, block_id);
+          copy = LINE_INVALID;
+          other->lost.insert(this->rule->getBlockIndexRAM(request.address));
+          ++other->invalidations;
+        }
+      }
+
+      if (request.op == BUS_READ)
+        ++requester->busReads;
+      else if (request.op == BUS_READ_EXCLUSIVE)
+        ++requester->busExclusives;
+      else
+        ++requester->upgrades;
+      // The line of a miss comes from another cache, or from below (an upgrade has it already)
+      if (request.op != BUS_UPGRADE) {
+        if (supplied)
+          ++requester->transfers;
+        else
+          this->fetch(request.address);
+      }
+      // The state the bus gives to the line (if the core still holds it)
+      if (state)
+        *state = request.op != BUS_READ ? LINE_MODIFIED
+          : sharers || this->protocol == PROTOCOL_MSI ? LINE_SHARED : LINE_EXCLUSIVE;
+    }
+    requester->requests.clear();
+  }
+}
+
+/* A block read from the shared level (filled on a miss, its dirty victim goes to the memory), or from the memory */
+template <class Policy>
+void Multicore<Policy>::fetch(Address address) {
+  if (this->shared && this->shared->cache.probe(address, false))
+    return;
+  this->memoryRead += this->blockSize;
+  if (!this->shared)
+    return;
+  Address victim = 0;
+  bool victimDirty = false;
+  this->shared->result.fetch(this->blockSize);
+  if (this->shared->cache.fill(address, false, victim, victimDirty) && victimDirty) {
+    this->shared->result.writeback(this->blockSize);
+    this->memoryWritten += this->blockSize;
+  }
+}
+
+/* A dirty block written back to the shared level (if it holds the block), or to the memory */
+template <class Policy>
+void Multicore<Policy>::writeBack(Address address) {
+  if (!this->shared || !this->shared->cache.markDirty(address))
+    this->memoryWritten += this->blockSize;
+}
+
+/* Print the results of every core, of the shared level, and the memory traffic */
+template <class Policy>
+ostream &print(ostream &os, const Multicore<Policy> &multicore) {
+  for (auto &core : multicore.cores) {
+    const Result &result = core->result;
+    os << "CORE " << core->id << " RESULTS==================================\n";
+    os << "Instruction count:\t" << result.count_instructions() << "\n";
+    os << "Read hits:\t\t" << result.count_read_hits() << "\n";
+    os << "Read misses:\t\t" << result.count_read_misses() << "\n";
+    os << "Read miss rate:\t\t" << setprecision(PRECISION_DOUBLE+2) << result.count_read_miss_rate()*100 << "%\n";
+    os << "Write hits:\t\t" << result.count_write_hits() << "\n";
+    os << "Write misses:\t\t" << result.count_write_misses() << "\n";
+    os << "Write miss rate:\t" << setprecision(PRECISION_DOUBLE+2) << result.count_write_miss_rate()*100 << "%\n";
+    os << "Writebacks:\t\t" << result.count_writebacks() << "\n";
+    os << "Coherence misses:\t" << core->coherenceMisses << "\n";
+    os << "Invalidations:\t\t" << core->invalidations << " lines invalidated by the other cores\n";
+    os << "Cache-to-cache:\t\t" << core->transfers << " lines supplied by the other cores\n";
+    os << "Bus requests:\t\t" << core->busReads << " reads, " << core->busExclusives << " read-exclusives, "
+       << core->upgrades << " upgrades\n";
+  }
+  if (multicore.shared) {
+    const Result &result = multicore.shared->result;
+    os << "SHARED L2 RESULTS============================\n";
+    os << "Read hits:\t\t" << result.count_read_hits() << "\n";
+    os << "Read misses:\t\t" << result.count_read_misses() << "\n";
+    os << "Read miss rate:\t\t" << setprecision(PRECISION_DOUBLE+2) << result.count_read_miss_rate()*100 << "%\n";
+    os << "Writebacks:\t\t" << result.count_writebacks() << "\n";
+  }
+  os << "MEMORY======================================\n";
+  os << "Memory traffic:\t\t" << multicore.memoryRead << " bytes read, " << multicore.memoryWritten << " bytes written\n";
+  os << flush;
+
+  return os;
+}
+
+/* Instantiate the multicore of every replacement policy */
+#define INSTANTIATE_MULTICORE(P) template class Multicore<P>; template ostream &print(ostream &os, const Multicore<P> &multicore);
+FOR_EACH_POLICY(INSTANTIATE_MULTICORE)
+#undef INSTANTIATE_MULTICORE
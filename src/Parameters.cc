@@ -3,7 +3,7 @@
  *  class Parameters records all the information needed from commandline arguments,
  *    it has to be initialized before the function calls algorithm class methods.
  *
- *  This file also includes two methods of the class Result.
+ *  This file also includes the methods of the class Result.
  */
 
 #define PRECISION_DOUBLE 1
@@ -11,20 +11,107 @@
 #include <iostream>
 #include <unistd.h>
 #include <cctype>
+#include <cstdlib>
+#include <cmath>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
 #include "classes.hh"
 
+/* Split a comma separated list of the commandline */
+static vector<string> readList(const char *arg) {
+  vector<string> items;
+  stringstream list(arg);
+  string item;
+  while (getline(list, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  if (items.empty())
+    throw string("Empty list of values (Code: 008).\n");
+  return items;
+}
+
+/* Split a comma separated list of numbers of the commandline */
+static vector<unsigned> readNumbers(const char *arg) {
+  vector<unsigned> numbers;
+  for (auto &item : readList(arg))
+    numbers.push_back(atoi(item.c_str()));
+  return numbers;
+}
+
+/* Print a list, comma separated */
+template <class T>
+static ostream &printList(ostream &os, const vector<T> &items) {
+  for (size_t i=0; i!=items.size(); ++i)
+    os << (i ? "," : "") << items[i];
+  return os;
+}
+
+/* Print the sampling of the caches (if any) */
+static ostream &printSampling(ostream &os, const Parameters &p) {
+  if (p.getSampledSets() > 1)
+    os << "Sampling = \t\t\t" << "1 set in " << p.getSampledSets() << '\n';
+  else if (p.getSampleWindow() != 0)
+    os << "Sampling = \t\t\t" << "a window of " << p.getSampleWindow() << " accesses in every "
+       << p.getSamplePeriod() << " (the others warm the cache)" << '\n';
+  return os;
+}
+
 /* print out the parameters to stdout */
 ostream &print(ostream &os, const Parameters &p) {
   os << "INPUTS=======================================\n";
   os << "Ram Size = \t\t\t" << p.ram_size << " bytes\n";
-  os << "Cache Size = \t\t\t" << p.cache_size << " bytes\n";
-  os << "Block Size = \t\t\t" << p.block_size << " bytes\n";
-  os << "Total Blocks in Cache = \t" << p.cache_size / p.block_size << '\n';
-  os << "Associativity = \t\t" << p.n_map << '\n';
-  os << "Number of Sets = \t\t" << p.n_sets << '\n';
-  os << "Replacement Policy = \t\t" << p.replacement_policy << '\n';
-  if (p.algorithm == "mxm_block") {
+  if (p.isSweep()) {
+    printList(os << "Cache Sizes = \t\t\t", p.cache_sizes) << " bytes\n";
+    printList(os << "Block Sizes = \t\t\t", p.block_sizes) << " bytes\n";
+    printList(os << "Associativities = \t\t", p.n_maps) << '\n';
+    printList(os << "Replacement Policies = \t\t", p.replacement_policies) << '\n';
+    os << "Write Policy = \t\t\t" << (p.write_back ? "write-back" : "write-through") << ", "
+       << (p.write_allocate ? "write-allocate" : "no-write-allocate") << '\n';
+    os << "Simulation Mode = \t\t" << "sweep of " << p.configurations().size() << " configurations (tags only), "
+       << p.threads << " threads" << '\n';
+    printSampling(os, p);
+  } else {
+    os << "Cache Size = \t\t\t" << p.cache_size << " bytes\n";
+    os << "Block Size = \t\t\t" << p.block_size << " bytes\n";
+    os << "Total Blocks in Cache = \t" << p.cache_size / p.block_size << '\n';
+    os << "Associativity = \t\t" << p.n_map << '\n';
+    os << "Number of Sets = \t\t" << p.n_sets << '\n';
+    os << "Replacement Policy = \t\t" << p.replacement_policy << '\n';
+    for (size_t l=0; l!=p.level_sizes.size(); ++l)
+      os << "L" << l+2 << " Cache = \t\t\t" << p.level_sizes[l] << " bytes, " << p.level_maps[l] << " ways, "
+         << p.level_sizes[l] / p.block_size / p.level_maps[l] << " sets" << '\n';
+    if (p.isHierarchy() && p.cores == 1)
+      os << "Inclusion = \t\t\t" << p.inclusion << '\n';
+    os << "Write Policy = \t\t\t" << (p.write_back ? "write-back" : "write-through") << ", "
+       << (p.write_allocate ? "write-allocate" : "no-write-allocate") << '\n';
+    if (!p.trace_out.empty())
+      os << "Simulation Mode = \t\t" << "capture to " << p.trace_out << '\n';
+    else if (p.curves)
+      os << "Simulation Mode = \t\t" << "miss curves (LRU, every cache up to the cache size)" << '\n';
+    else if (p.cores > 1)
+      os << "Simulation Mode = \t\t" << "timing (tags only), " << p.cores << " cores, " << p.protocol
+         << " on a snooping bus" << (p.isHierarchy() ? " to a shared L2" : "") << ", quanta of " << p.quantum << " accesses" << '\n';
+    else if (p.shards > 1)
+      os << "Simulation Mode = \t\t" << "timing (tags only), sets partitioned across " << p.shards << " threads" << '\n';
+    else
+      os << "Simulation Mode = \t\t" << (p.timingOnly() ? "timing (tags only)" : "payload") << '\n';
+    printSampling(os, p);
+  }
+  if (!p.prefetcher.empty())
+    os << "Prefetcher = \t\t\t" << p.prefetcher << ", " << p.prefetch_degree << " blocks ahead, prefetches take "
+       << p.prefetch_latency << " accesses" << '\n';
+  if (p.classify)
+    os << "Miss Classes = \t\t\t" << "compulsory, capacity (fully associative LRU of the same size), conflict" << '\n';
+  if (p.victim_entries)
+    os << (p.miss_cache ? "Miss Cache = \t\t\t" : "Victim Cache = \t\t\t") << p.victim_entries << " blocks, fully associative, LRU"
+       << (p.miss_cache ? " (the blocks missed)" : " (the blocks evicted, swapped back on a miss)") << '\n';
+  if (!p.trace_in.empty()) {
+    os << "Algorithm = \t\t\t" << "trace " << p.trace_in;
+    if (!p.trace_format.empty())
+      os << " (" << p.trace_format << ")";
+    os << '\n';
+  } else if (p.algorithm == "mxm_block") {
     os << "Algorithm = \t\t\t" << "blocked mxm" << '\n';
     os << "MXM Blocking Factor =\t\t" << p.blocking_factor << '\n';
     os << "Matrix Dimension = \t\t" << p.dimension << '\n';
@@ -35,6 +122,10 @@ ostream &print(ostream &os, const Parameters &p) {
     os << "Algorithm = \t\t\t" << p.algorithm << '\n';
     os << "Vector Dimension = \t\t" << p.dimension << '\n';
   }
+  if (!p.checkpoint_out.empty())
+    os << "Checkpoint = \t\t\t" << "saved to " << p.checkpoint_out << " after the initialization" << '\n';
+  else if (!p.checkpoint_in.empty())
+    os << "Checkpoint = \t\t\t" << "the initialization is restored from " << p.checkpoint_in << '\n';
   os << flush;
 
   return os;
@@ -47,23 +138,26 @@ Parameters::Parameters(int argc, char *argv[]) {
 
   int c;
 
-  while ((c = getopt(argc, argv, "c:b:n:r:a:d:pf:l")) != -1) {
+  // A sweep runs on every host thread by default
+  threads = thread::hardware_concurrency();
+
+  while ((c = getopt(argc, argv, "c:b:n:r:a:d:pf:ltmj:P:S:T:i:w:e:L:I:W:A:C:R:N:M:Q:F:KV:")) != -1) {
     switch (c) {
       case 'c':
-        // read size of cache
-        cache_size = atoi(optarg);
+        // read size of cache (or a list of them)
+        cache_sizes = readNumbers(optarg);
         break;
       case 'b':
-        // read size of data block
-        block_size = atoi(optarg);
+        // read size of data block (or a list of them)
+        block_sizes = readNumbers(optarg);
         break;
       case 'n':
-        // read associativity
-        n_map = atoi(optarg);
+        // read associativity (or a list of them)
+        n_maps = readNumbers(optarg);
         break;
       case 'r':
-        // read replacement policy
-        replacement_policy = string(optarg);
+        // read replacement policy (or a list of them)
+        replacement_policies = readList(optarg);
         break;
       case 'a':
         // read the algorithm to simulate
@@ -84,17 +178,302 @@ Parameters::Parameters(int argc, char *argv[]) {
       case 'l':
         load = true;
         break;
+      case 't':
+        // simulate the tags only (ignored with -p)
+        timing = true;
+        break;
+      case 'm':
+        // measure the miss curves of every cache size and associativity (LRU)
+        curves = true;
+        break;
+      case 'j':
+        // read the number of threads of a sweep
+        threads = atoi(optarg);
+        break;
+      case 'P':
+        // read the number of threads the sets of the cache are partitioned across
+        shards = atoi(optarg);
+        break;
+      case 'S':
+        // read the set sampling (one set in val is simulated)
+        sample_sets = atoi(optarg);
+        break;
+      case 'T': {
+        // read the time sampling (window:period, in accesses)
+        string sampling(optarg);
+        size_t colon = sampling.find(':');
+        if (colon == string::npos)
+          throw string("Time sampling is given as window:period (Code: 008).\n");
+        sample_window = strtoull(sampling.substr(0, colon).c_str(), nullptr, 10);
+        sample_period = strtoull(sampling.substr(colon + 1).c_str(), nullptr, 10);
+        break;
+      }
+      case 'i':
+        // read the trace to replay (instead of the algorithm)
+        trace_in = string(optarg);
+        break;
+      case 'e':
+        // read the format of the trace to replay
+        trace_format = string(optarg);
+        break;
+      case 'w':
+        // read the trace to capture the accesses to
+        trace_out = string(optarg);
+        break;
+      case 'L':
+        // read the levels below the cache (size:ways,size:ways,...)
+        for (auto &level : readList(optarg)) {
+          size_t colon = level.find(':');
+          if (colon == string::npos)
+            throw string("A level is given as size:ways (Code: 008).\n");
+          level_sizes.push_back(atoi(level.substr(0, colon).c_str()));
+          level_maps.push_back(atoi(level.substr(colon + 1).c_str()));
+        }
+        break;
+      case 'I':
+        // read the inclusion policy of the hierarchy
+        inclusion = string(optarg);
+        break;
+      case 'W':
+        // read the write policy on a hit (back, or through)
+        if (string(optarg) != "back" && string(optarg) != "through")
+          throw string("Unknown write policy, use back or through (Code: 008).\n");
+        write_back = string(optarg) == "back";
+        break;
+      case 'A':
+        // read the write policy on a miss (alloc, or noalloc)
+        if (string(optarg) != "alloc" && string(optarg) != "noalloc")
+          throw string("Unknown write miss policy, use alloc or noalloc (Code: 008).\n");
+        write_allocate = string(optarg) == "alloc";
+        break;
+      case 'C':
+        // read the checkpoint to save the state after the initialization to
+        checkpoint_out = string(optarg);
+        break;
+      case 'R':
+        // read the checkpoint to restore the state after the initialization from
+        checkpoint_in = string(optarg);
+        break;
+      case 'N':
+        // read the number of cores
+        cores = atoi(optarg);
+        break;
+      case 'M':
+        // read the coherence protocol of the cores
+        protocol = string(optarg);
+        break;
+      case 'Q':
+        // read the quantum of the cores (accesses)
+        quantum = atoi(optarg);
+        break;
+      case 'F': {
+        // read the prefetcher (kind[:degree[:latency]])
+        vector<string> fields;
+        stringstream prefetch(optarg);
+        string field;
+        while (getline(prefetch, field, ':'))
+          fields.push_back(field);
+        if (fields.empty() || fields.size() > 3)
+          throw string("A prefetcher is given as kind[:degree[:latency]] (Code: 011).\n");
+        prefetcher = fields[0];
+        if (fields.size() > 1)
+          prefetch_degree = atoi(fields[1].c_str());
+        if (fields.size() > 2)
+          prefetch_latency = atoi(fields[2].c_str());
+        break;
+      }
+      case 'K':
+        // classify the misses (compulsory, capacity, conflict)
+        classify = true;
+        break;
+      case 'V': {
+        // read the victim cache (entries[:victim|miss])
+        string entries(optarg), kind = "victim";
+        size_t colon = entries.find(':');
+        if (colon != string::npos) {
+          kind = entries.substr(colon + 1);
+          entries.resize(colon);
+        }
+        if (kind != "victim" && kind != "miss")
+          throw string("A victim cache is given as entries[:victim|miss], not ") + optarg + " (Code: 008).\n";
+        victim_entries = atoi(entries.c_str());
+        miss_cache = kind == "miss";
+        if (victim_entries == 0)
+          throw string("A victim cache holds one block at least (Code: 008).\n");
+        break;
+      }
     // end of switch
     }
   // end of while (commandline arguments)
   }
+  // The single configuration is the first of the lists
+  cache_size = cache_sizes[0];
+  block_size = block_sizes[0];
+  n_map = n_maps[0];
+  replacement_policy = replacement_policies[0];
+  if (threads == 0)
+    threads = 1;
+  if (shards == 0)
+    shards = 1;
+  if (sample_sets == 0)
+    sample_sets = 1;
+  if (cores == 0)
+    cores = 1;
+  if (quantum == 0)
+    quantum = 1;
+  for (auto b : block_sizes)
+    if (b < WORD_SIZE || (b & (b - 1)) != 0)
+      throw string("A block size is a power of two of at least one word (Code: 008).\n");
+  if (curves && isSweep())
+    throw string("Miss curves cover every cache size and associativity already, give them no lists (Code: 008).\n");
+  if (isHierarchy() && (isSweep() || curves))
+    throw string("A hierarchy is simulated alone, give it no lists and no -m (Code: 008).\n");
+  if (isHierarchy() && replacement_policy == OPTPolicy::name())
+    throw string("OPT needs the future of every level, it cannot be used in a hierarchy (Code: 003).\n");
+  getInclusion();
+  getProtocol();
+  if (cores > 1 && (isSweep() || curves || shards > 1 || isSampled() || !trace_in.empty() || !trace_out.empty()
+      || !checkpoint_out.empty() || !checkpoint_in.empty()))
+    throw string("The cores run the parallel algorithm on a single cache each, give -N no lists, -m, -P, -S, -T, -i, -w, -C or -R (Code: 008).\n");
+  if (cores > 1 && level_sizes.size() > 1)
+    throw string("The cores share a single level below their caches, give -L one level (Code: 008).\n");
+  if (cores > 1 && replacement_policy == OPTPolicy::name())
+    throw string("OPT needs the future of every core, it cannot be used on several cores (Code: 003).\n");
+  if (cores > 1 && !(write_back && write_allocate))
+    throw string("The caches of the cores are write-back and write-allocate (Code: 008).\n");
+  if (isHierarchy() && !(write_back && write_allocate))
+    throw string("The levels of a hierarchy are write-back and write-allocate (Code: 008).\n");
+  for (size_t l=0; l!=level_sizes.size(); ++l)
+    if (level_maps[l] == 0 || level_sizes[l] / block_size / level_maps[l] == 0)
+      throw string("A level holds no set (Code: 008).\n");
+
   // Infer the number of sets from given
   n_sets = cache_size / block_size / n_map;
 
+  if (shards > 1 && (isSweep() || curves || isHierarchy()))
+    throw string("The sets of a single cache are partitioned, give -P no lists, no -L and no -m (Code: 008).\n");
+  if (shards > 1 && n_sets % shards != 0)
+    throw string("The sets of the cache are not divisible by the shards of -P (Code: 008).\n");
+  if (shards > 1 && replacement_policy == OPTPolicy::name())
+    throw string("OPT needs the future of every set, its sets cannot be partitioned (Code: 003).\n");
+
+  if (isSampled() && (curves || isHierarchy() || shards > 1))
+    throw string("Sampling applies to a single cache or a sweep, give it no -m, no -L and no -P (Code: 008).\n");
+  if (sample_sets > 1 && sample_window != 0)
+    throw string("Sample the sets (-S) or the time (-T), not both (Code: 008).\n");
+  if ((sample_sets & (sample_sets - 1)) != 0)
+    throw string("Set sampling is one set in a power of two (Code: 008).\n");
+  for (auto &config : configurations())
+    if (sample_sets > config.n_sets)
+      throw string("Set sampling is one set in more sets than a cache has (Code: 008).\n");
+  if (sample_period != 0 && (sample_window == 0 || sample_window >= sample_period))
+    throw string("Time sampling measures a window shorter than its period (Code: 008).\n");
+
+  getPrefetcher();
+  if (!prefetcher.empty() && prefetch_degree == 0)
+    throw string("A prefetcher fetches one block ahead at least (Code: 011).\n");
+  if (!prefetcher.empty() && (curves || isHierarchy() || shards > 1 || cores > 1 || sample_sets > 1
+      || !checkpoint_out.empty() || !checkpoint_in.empty()))
+    throw string("A prefetcher applies to a single cache or a sweep, give -F no -m, -L, -P, -N, -S, -C or -R (Code: 011).\n");
+  if (!prefetcher.empty() && find(replacement_policies.begin(), replacement_policies.end(), OPTPolicy::name()) != replacement_policies.end())
+    throw string("OPT needs the future of every fill, it cannot be used with a prefetcher (Code: 003).\n");
+
+  if (classify && (curves || isHierarchy() || shards > 1 || cores > 1 || sample_sets > 1
+      || !checkpoint_out.empty() || !checkpoint_in.empty()))
+    throw string("Miss classification applies to a single cache or a sweep, give -K no -m, -L, -P, -N, -S, -C or -R (Code: 008).\n");
+
+  if (victim_entries && (curves || isHierarchy() || shards > 1 || cores > 1 || sample_sets > 1
+      || !checkpoint_out.empty() || !checkpoint_in.empty() || !prefetcher.empty()))
+    throw string("A victim cache applies to a single cache or a sweep, give -V no -m, -L, -P, -N, -S, -C, -R or -F (Code: 008).\n");
+
+  if (!checkpoint_out.empty() && !checkpoint_in.empty())
+    throw string("Save a checkpoint (-C) or restore one (-R), not both (Code: 010).\n");
+  if ((!checkpoint_out.empty() || !checkpoint_in.empty()) && (!trace_in.empty() || !trace_out.empty()))
+    throw string("A checkpoint is the state after the initialization of an algorithm, give it no -i and no -w (Code: 010).\n");
+  if ((!checkpoint_out.empty() || !checkpoint_in.empty()) && replacement_policy == OPTPolicy::name())
+    throw string("OPT needs the future of the initialization, it cannot be checkpointed (Code: 003).\n");
+
   if (algorithm == "daxpy")
-    ram_size = dimension * WORD_SIZE * 3;
+    ram_size = (uint64_t)dimension * WORD_SIZE * 3;
   else
-    ram_size = dimension * dimension * WORD_SIZE * 3;
+    ram_size = (uint64_t)dimension * dimension * WORD_SIZE * 3;
+}
+
+/* Every configuration of the lists of a sweep, each of them is simulated in timing mode */
+vector<Parameters> Parameters::configurations() const {
+  vector<Parameters> configs;
+  for (auto c : this->cache_sizes)
+    for (auto b : this->block_sizes)
+      for (auto n : this->n_maps)
+        for (auto &r : this->replacement_policies) {
+          Parameters config(*this);
+          config.cache_sizes = {c};
+          config.block_sizes = {b};
+          config.n_maps = {n};
+          config.replacement_policies = {r};
+          config.cache_size = c;
+          config.block_size = b;
+          config.n_map = n;
+          config.replacement_policy = r;
+          config.n_sets = c / b / n;
+          config.timing = true;
+          config.output = false;
+          configs.push_back(config);
+        }
+  return configs;
+}
+
+/* The levels below the cache, each of them is simulated in timing mode */
+vector<Parameters> Parameters::levels() const {
+  vector<Parameters> levels;
+  for (size_t l=0; l!=this->level_sizes.size(); ++l) {
+    Parameters level(*this);
+    level.level_sizes.clear();
+    level.level_maps.clear();
+    level.cache_sizes = {this->level_sizes[l]};
+    level.n_maps = {this->level_maps[l]};
+    level.cache_size = this->level_sizes[l];
+    level.n_map = this->level_maps[l];
+    level.n_sets = level.cache_size / level.block_size / level.n_map;
+    level.timing = true;
+    level.output = false;
+    levels.push_back(level);
+  }
+  return levels;
+}
+
+/* The cache of a shard of a partitioned cache: a contiguous range of the sets (see Partition), in timing mode */
+Parameters Parameters::shard() const {
+  Parameters shard(*this);
+  shard.shards = 1;
+  shard.cache_size = this->cache_size / this->shards;
+  shard.cache_sizes = {shard.cache_size};
+  shard.n_sets = this->n_sets / this->shards;
+  shard.timing = true;
+  shard.output = false;
+  return shard;
+}
+
+/* The inclusion policy given to -I */
+Inclusion Parameters::getInclusion() const {
+  if (this->inclusion == "inclusive")
+    return INCLUSION_INCLUSIVE;
+  if (this->inclusion == "exclusive")
+    return INCLUSION_EXCLUSIVE;
+  if (this->inclusion == "nine")
+    return INCLUSION_NINE;
+  throw string("Unknown inclusion policy, use inclusive, exclusive, or nine (Code: 008).\n");
+}
+
+/* The coherence protocol given to -M */
+Protocol Parameters::getProtocol() const {
+  if (this->protocol == "MSI")
+    return PROTOCOL_MSI;
+  if (this->protocol == "MESI")
+    return PROTOCOL_MESI;
+  if (this->protocol == "MOESI")
+    return PROTOCOL_MOESI;
+  throw string("Unknown coherence protocol, use MSI, MESI, or MOESI (Code: 008).\n");
 }
 
 /* Print out the results to stdout */
@@ -107,16 +486,129 @@ ostream &print(ostream &os, const Result &result) {
   os << "Write hits:\t\t" << result.count_write_hits() << "\n";
   os << "Write misses:\t\t" << result.count_write_misses() << "\n";
   os << "Write miss rate:\t" << setprecision(PRECISION_DOUBLE+2) << result.count_write_miss_rate()*100 << "%\n";
+  os << "Writebacks:\t\t" << result.count_writebacks() << "\n";
+  os << "Memory traffic:\t\t" << result.count_read_bytes() << " bytes read, " << result.count_written_bytes() << " bytes written\n";
+  if (result.isPrefetching()) {
+    os << "Prefetches:\t\t" << result.count_prefetches() << " issued, " << result.count_prefetches_useful() << " useful ("
+       << result.count_prefetches_late() << " late), " << result.count_prefetches_polluting() << " polluting\n";
+    os << "Prefetch accuracy:\t" << setprecision(PRECISION_DOUBLE+2) << result.count_prefetch_accuracy()*100 << "%\n";
+    os << "Prefetch coverage:\t" << setprecision(PRECISION_DOUBLE+2) << result.count_prefetch_coverage()*100 << "%\n";
+  }
+  if (result.isClassified())
+    os << "Miss classes:\t\t" << result.count_misses(MISS_COMPULSORY) << " compulsory, " << result.count_misses(MISS_CAPACITY)
+       << " capacity, " << result.count_misses(MISS_CONFLICT) << " conflict\n";
+  if (result.hasVictimCache())
+    os << (result.isMissCache() ? "Miss cache hits:\t" : "Victim cache hits:\t") << result.count_victim_hits() << " ("
+       << setprecision(PRECISION_DOUBLE+2) << result.count_victim_hit_rate()*100 << "% of the misses)\n";
+  if (result.isSampled()) {
+    os << "Sampled clusters:\t" << result.count_clusters() << "\n";
+    os << "Miss rate:\t\t" << setprecision(PRECISION_DOUBLE+2) << result.count_miss_rate()*100 << "% +/- "
+       << result.count_miss_rate_margin()*100 << "% (95% confidence)\n";
+  }
   os << flush;
 
   return os;
 }
 
-/* Restting the result: Set all field values to 0 */
+/* Add the counters of another result (the result of a shard of a partitioned cache) */
+void Result::merge(const Result &other) {
+  this->instruction_count += other.instruction_count;
+  this->read_hits += other.read_hits;
+  this->read_misses += other.read_misses;
+  this->write_hits += other.write_hits;
+  this->write_misses += other.write_misses;
+  this->fetches += other.fetches;
+  this->writebacks += other.writebacks;
+  this->read_bytes += other.read_bytes;
+  this->written_bytes += other.written_bytes;
+  this->prefetches += other.prefetches;
+  this->prefetches_useful += other.prefetches_useful;
+  this->prefetches_late += other.prefetches_late;
+  this->prefetches_polluting += other.prefetches_polluting;
+  for (unsigned k=0; k!=3; ++k)
+    this->classes[k] += other.classes[k];
+  this->victim_hits += other.victim_hits;
+  this->clusters += other.clusters;
+  this->accesses_squared += other.accesses_squared;
+  this->misses_squared += other.misses_squared;
+  this->products += other.products;
+}
+
+/* The half-width of the 95% confidence interval of the miss rate of a sampled cache,
+ * the ratio estimate over clusters (of n in the population, with the finite population correction):
+ *   var = (1-f) / (n*mean(a)^2) * sum((m - r*a)^2) / (n-1) */
+double Result::count_miss_rate_margin() const {
+  if (this->clusters < 2)
+    return NAN;
+  double n = this->clusters;
+  double accesses = this->read_hits + this->read_misses + this->write_hits + this->write_misses;
+  double rate = this->count_miss_rate();
+  double residuals = this->misses_squared - 2*rate*this->products + rate*rate*this->accesses_squared;
+  double mean = accesses / n;
+  double variance = (1 - this->fraction) * (residuals > 0 ? residuals : 0) / (n - 1) / (n * mean * mean);
+  return 1.96 * sqrt(variance);
+}
+
+/* Write the counters to a checkpoint (the fraction sampled is the one of the parameters) */
+void Result::save(CheckpointWriter &w) const {
+  w.put(this->instruction_count);
+  w.put(this->read_hits);
+  w.put(this->read_misses);
+  w.put(this->write_hits);
+  w.put(this->write_misses);
+  w.put(this->fetches);
+  w.put(this->writebacks);
+  w.put(this->read_bytes);
+  w.put(this->written_bytes);
+  w.put(this->prefetches);
+  w.put(this->prefetches_useful);
+  w.put(this->prefetches_late);
+  w.put(this->prefetches_polluting);
+  w.put(this->classes);
+  w.put(this->victim_hits);
+  w.put(this->clusters);
+  w.put(this->accesses_squared);
+  w.put(this->misses_squared);
+  w.put(this->products);
+}
+
+/* Read the counters back from a checkpoint */
+void Result::restore(CheckpointReader &r) {
+  r.get(this->instruction_count);
+  r.get(this->read_hits);
+  r.get(this->read_misses);
+  r.get(this->write_hits);
+  r.get(this->write_misses);
+  r.get(this->fetches);
+  r.get(this->writebacks);
+  r.get(this->read_bytes);
+  r.get(this->written_bytes);
+  r.get(this->prefetches);
+  r.get(this->prefetches_useful);
+  r.get(this->prefetches_late);
+  r.get(this->prefetches_polluting);
+  r.get(this->classes);
+  r.get(this->victim_hits);
+  r.get(this->clusters);
+  r.get(this->accesses_squared);
+  r.get(this->misses_squared);
+  r.get(this->products);
+}
+
+/* Restting the result: Set all field values to 0 (whether the cache is sampled, prefetches, classifies, or has a victim cache is kept) */
 void Result::reset() {
   this->instruction_count = 0;
   this->read_hits = 0;
   this->read_misses = 0;
   this->write_hits = 0;
   this->write_misses = 0;
+  this->fetches = 0;
+  this->writebacks = 0;
+  this->read_bytes = 0;
+  this->written_bytes = 0;
+  this->prefetches = this->prefetches_useful = this->prefetches_late = this->prefetches_polluting = 0;
+  this->classes[0] = this->classes[1] = this->classes[2] = 0;
+  this->victim_hits = 0;
+  this->clusters = 0;
+  this->accesses_squared = this->misses_squared = this->products = 0;
 }
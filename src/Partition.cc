@@ -0,0 +1,119 @@
+/* ./src/Partition.cc
+ *
+ *  class Partition simulates a single cache on several threads (-P): its sets are cut into ranges (the shards),
+ *  the thread of the CPU routes every access to the shard of its set through a lock-free ring,
+ *  and the thread of each shard simulates the accesses of its sets in order on a cache of its own.
+ *  Partition is templated on the replacement policy, the partitions of all the policies are instantiated at the end.
+ */
+
+#include "classes.hh"
+
+/* Constructor: a cache per shard (with the sets of its range), and a thread per shard */
+template <class Policy>
+Partition<Policy>::Partition(Parameters &p, Rule *r, Ram *rm, Result *resu) {
+  if (!Policy::setLocal)
+    throw string("The sets of ") + Policy::name() + " share a state, they cannot be partitioned (Code: 003).\n";
+  this->rule = r;
+  this->result = resu;
+  this->setsPerShard = p.getSetCount() / p.getShards();
+
+  Parameters shard = p.shard();
+  for (unsigned i=0; i!=p.getShards(); ++i)
+    this->shards.emplace_back(new Shard(shard, rm));
+  for (auto &s : this->shards)
+    s->worker = thread(&Partition::work, this, ref(*s));
+}
+
+/* Destructor: stop the threads (if finish() was not reached, the accesses still pending are dropped) */
+template <class Policy>
+Partition<Policy>::~Partition() {
+  for (auto &s : this->shards) {
+    s->ring.close();
+    if (s->worker.joinable())
+      s->worker.join();
+  }
+}
+
+/* Route a batch: the sets of ACCESS_DECODE accesses are decoded at once (the loads return 0, the values are not used) */
+template <class Policy>
+void Partition<Policy>::batch(const Access *first, const Access *last, double *values) {
+  unsigned sets[ACCESS_DECODE];
+  Tag tags[ACCESS_DECODE];
+  while (first != last) {
+    unsigned n = last - first < ACCESS_DECODE ? last - first : ACCESS_DECODE;
+    this->rule->decode(first, n, sets, tags);
+    for (unsigned i=0; i!=n; ++i)
+      this->route(first[i].address, sets[i], first[i].op);
+    first += n;
+  }
+}
+
+/* Route a reset to every shard, after the accesses routed to it before */
+template <class Policy>
+void Partition<Policy>::reset() {
+  Access a = {0, ACCESS_RESET};
+  for (auto &s : this->shards) {
+    s->pending.push_back(a);
+    if (s->pending.size() == PARTITION_CHUNK)
+      this->push(*s);
+  }
+}
+
+/* Hand the pending accesses of a shard to its ring, waiting for its thread to make room */
+template <class Policy>
+void Partition<Policy>::push(Shard &shard) {
+  const Access *first = shard.pending.data();
+  size_t n = shard.pending.size();
+  while (n != 0) {
+    size_t pushed = shard.ring.push(first, n);
+    first += pushed;
+    n -= pushed;
+    if (n != 0)
+      this_thread::yield();
+  }
+  shard.pending.clear();
+}
+
+/* The loop of the thread of a shard: simulate the accesses of the ring until it is closed and empty,
+ * the runs between two resets are simulated as batches of the cache */
+template <class Policy>
+void Partition<Policy>::work(Shard &shard) {
+  vector<Access> run(PARTITION_CHUNK);
+  for (;;) {
+    // Closed before the pop: every access pushed before the close is popped before the thread stops
+    bool closed = shard.ring.closed();
+    size_t n = shard.ring.pop(run.data(), run.size());
+    if (n == 0) {
+      if (closed)
+        return;
+      this_thread::yield();
+      continue;
+    }
+    const Access *first = run.data(), *last = first + n;
+    for (const Access *a = first; a != last; ++a)
+      if (a->op == ACCESS_RESET) {
+        shard.cache.batch(first, a, nullptr);
+        shard.cpu.reset();
+        first = a + 1;
+      }
+    shard.cache.batch(first, last, nullptr);
+  }
+}
+
+/* Push the last accesses, stop the threads once they are done with them, and add the results of the shards to the CPU's */
+template <class Policy>
+void Partition<Policy>::finish() {
+  for (auto &s : this->shards) {
+    this->push(*s);
+    s->ring.close();
+  }
+  for (auto &s : this->shards) {
+    s->worker.join();
+    this->result->merge(s->result);
+  }
+}
+
+/* Instantiate the partition of every replacement policy */
+#define INSTANTIATE_PARTITION(P) template class Partition<P>;
+FOR_EACH_POLICY(INSTANTIATE_PARTITION)
+#undef INSTANTIATE_PARTITION
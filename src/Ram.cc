@@ -1,56 +1,102 @@
 /* ./src/Ram.cc
  *
- *  class Ram is represented as a vector of DataBlocks.
+ *  class Ram is represented as a sparse table of pages, the words of the pages are carved from anonymous mappings (arenas).
  *  class Cache has direct control on class Ram.
  */
 #include "classes.hh"
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
 
-/* Initialize the Ram with the parameters */
+/* Initialize the Ram with the parameters (nothing is allocated before the first access) */
 Ram::Ram(Parameters &p, Rule *r) {
-  // calculate the number of blocks, use upper ceiling to padding
-  if (p.getRamSize() % p.getBlockSize() == 0)
-    numBlocks = p.getRamSize() / p.getBlockSize();
-  else
-    numBlocks = p.getRamSize() / p.getBlockSize() + 1;
-  // build the DataBlock and insert it into data
-  DataBlock d(p);
-  vector<DataBlock> tmp(numBlocks, d);
-  data.insert(data.end(), tmp.begin(), tmp.end());
+  // A page holds whole blocks (one block, if a block is larger than a page)
+  wordsPerBlock = p.getBlockSize() / WORD_SIZE;
+  blocksPerPage = max(1u, RAM_PAGE_SIZE / p.getBlockSize());
+  pageSize = (size_t)blocksPerPage * p.getBlockSize();
+  for (pageShift = 0; (1u << pageShift) != blocksPerPage; ++pageShift);
+  // No page is recent (a page number has at most 61 bits, none is UINT64_MAX)
+  RecentPage none = {UINT64_MAX, nullptr};
+  recent.assign(RAM_RECENT_PAGES, none);
   // Pass pointer of rule to the constructor
   rule = r;
 }
 
-/* Print the ram state to stdout, debugging only */
+/* Unmap the arenas */
+Ram::~Ram() {
+  for (auto &arena : this->arenas)
+    munmap(arena.first, arena.second);
+}
+
+/* Print the ram state to stdout (the pages in address order), debugging only */
 void Ram::show() {
-  unsigned ct = 0;
-  for (auto &block : this->data) {
-    cout << "block " << ct++ << " (size:" << block.getBlockSize() << "):";
-    block.show();
-  }
+  vector<uint64_t> numbers;
+  for (auto &page : this->pages)
+    numbers.push_back(page.first);
+  sort(numbers.begin(), numbers.end());
+  for (auto number : numbers)
+    for (unsigned block=0; block != this->blocksPerPage; ++block) {
+      const double *words = this->pages[number] + block * this->wordsPerBlock;
+      cout << "block " << number * this->blocksPerPage + block << " (size:" << this->wordsPerBlock << "):";
+      for (unsigned word=0; word != this->wordsPerBlock; ++word)
+        cout << words[word] << ' ';
+      cout << endl;
+    }
   cout << endl;
 }
 
 /* Print the summary statistics to stdout, debugging only */
 void Ram::summary() {
   cout << "###### RAM Statistics ######\n";
-  cout << "numBlocks: " << this->numBlocks << endl;
+  cout << "numPages: " << this->pages.size() << " (" << this->blocksPerPage << " blocks per page)\n";
+  cout << "numArenas: " << this->arenas.size() << endl;
 }
 
-/* Obtain a block by giving an address */
-DataBlock &Ram::getBlock(Address address) {
-  unsigned BlockIndex = this->rule->getBlockIndexRAM(address);
+/* The words of a page, the page is taken from the last arena when it is first touched (a new arena is mapped when it is full),
+ * the mapping is anonymous, so the page reads as zeros and is backed by the host only once it is written */
+double *Ram::page(uint64_t number) {
+  double *&page = this->pages[number];
+  if (page)
+    return page;
 
-  if (BlockIndex >= numBlocks+1) {
-    cerr << "Error: Block Index: " << BlockIndex << " numBlocks: " << numBlocks << endl;
-    throw runtime_error("Block Index out of Range (Code: 004).");
+  if (this->arenas.empty() || this->arenaUsed + this->pageSize > this->arenas.back().second) {
+    size_t size = max((size_t)RAM_ARENA_SIZE, this->pageSize);
+    void *arena = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (arena == MAP_FAILED) {
+      this->pages.erase(number);
+      throw runtime_error("Cannot map an arena of the ram (Code: 004).");
+    }
+    this->arenas.emplace_back(arena, size);
+    this->arenaUsed = 0;
   }
-
-  return this->data[BlockIndex];
+  page = reinterpret_cast<double *>(static_cast<char *>(this->arenas.back().first) + this->arenaUsed);
+  this->arenaUsed += this->pageSize;
+  return page;
 }
 
-/* Replace the block at the given address, with the given block reference */
-void Ram::setBlock(Address address, DataBlock &block) {
-  unsigned BlockIndex = this->rule->getBlockIndexRAM(address);
+/* Write the pages to a checkpoint (in address order, the pages never touched are not written) */
+void Ram::save(CheckpointWriter &w) const {
+  vector<uint64_t> numbers;
+  for (auto &page : this->pages)
+    numbers.push_back(page.first);
+  sort(numbers.begin(), numbers.end());
+  w.put((uint64_t)this->pageSize);
+  w.put((uint64_t)numbers.size());
+  for (auto number : numbers) {
+    w.put(number);
+    w.write(this->pages.at(number), this->pageSize);
+  }
+}
 
-  this->data[BlockIndex].replace(block);
+/* Read the pages back from a checkpoint (of a ram of the same page size) */
+void Ram::restore(CheckpointReader &r) {
+  uint64_t size, count, number;
+  r.get(size);
+  if (size != this->pageSize)
+    CheckpointReader::mismatch();
+  r.get(count);
+  for (uint64_t i=0; i!=count; ++i) {
+    r.get(number);
+    r.read(this->page(number), this->pageSize);
+  }
 }
@@ -17,6 +17,8 @@ Rule::Rule(Parameters &p) {
   offset_len = getBit(block_size);
   index_len = getBit(set_count);
   tag_len = ADDRESS_LEN - offset_len - index_len;
+  set_mask = set_count - 1;
+  set_pow2 = (set_count & set_mask) == 0;
 }
 
 /* Private member function: Get bit-length of a value */
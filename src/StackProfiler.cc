@@ -0,0 +1,41 @@
+/* ./src/StackProfiler.cc
+ *
+ *  class StackProfiler measures the miss curves of LRU (-m):
+ *    the misses of every power-of-two cache size and associativity, from a single run of the algorithm.
+ */
+
+#include "classes.hh"
+#include <iomanip>
+
+#define PRECISION_DOUBLE 1
+
+/* Constructor: measure the caches of one block to the cache size */
+StackProfiler::StackProfiler(Parameters &p, Rule *r) {
+  this->blockSize = p.getBlockSize();
+  this->maxBlocks = p.getCacheSize() / p.getBlockSize();
+  this->rule = r;
+  this->distances.initialize(this->maxBlocks, this->maxBlocks);
+}
+
+/* Print the misses of every cache (size, associativity) to stdout */
+ostream &print(ostream &os, const StackProfiler &profiler, const Result &result) {
+  const StackDistance &d = profiler.distances;
+  uint64_t reads = d.count(false), writes = d.count(true);
+
+  os << "MISS CURVES (LRU)=============================\n";
+  os << "Instruction count:\t" << result.count_instructions() << "\n";
+  os << "Reads:\t\t\t" << reads << "\n";
+  os << "Writes:\t\t\t" << writes << "\n";
+  os << "Cache Size\tAssociativity\tSets\tRead misses\tRead miss rate\tWrite misses\tWrite miss rate\n";
+  for (unsigned blocks=1; blocks<=profiler.maxBlocks; blocks*=2)
+    for (unsigned ways=1; ways<=blocks; ways*=2) {
+      unsigned sets = blocks / ways;
+      uint64_t read_misses = d.misses(sets, ways, false), write_misses = d.misses(sets, ways, true);
+      os << blocks * profiler.blockSize << "\t\t" << ways << "\t\t" << sets << "\t"
+         << read_misses << "\t\t" << setprecision(PRECISION_DOUBLE+2) << static_cast<double>(read_misses) / reads * 100 << "%\t\t"
+         << write_misses << "\t\t" << setprecision(PRECISION_DOUBLE+2) << static_cast<double>(write_misses) / writes * 100 << "%\n";
+    }
+  os << flush;
+
+  return os;
+}
@@ -0,0 +1,188 @@
+/* ./src/Sweep.cc
+ *
+ *  class Sweep simulates every configuration of a sweep from a single run of the algorithm:
+ *    the stream of accesses is cut into batches, and every batch is run on the cache of each configuration
+ *    by a pool of threads (the caches are independent, so a cache is run by one thread at a time, in stream order).
+ */
+
+#include "classes.hh"
+#include <iomanip>
+
+#define PRECISION_DOUBLE 1
+/* The number of accesses in a batch */
+#define SWEEP_BATCH (1u<<16)
+
+/* CacheRunner, the cache of a configuration with its own rule, ram (empty in timing mode) and results */
+template <class Policy>
+class CacheRunner : public SweepRunner {
+public:
+  CacheRunner(Parameters &p) : params(p), rule(this->params), ram(this->params, &this->rule),
+    cache(this->params, &this->rule, &this->ram, &this->result), cpu(&this->cache, &this->result) {}
+  void run(const Access *first, const Access *last) {
+    // The runs between the resets are batches of the cache (in timing mode, no values)
+    for (const Access *a = first; a != last; ++a)
+      if (a->op == ACCESS_RESET) {
+        this->cache.batch(first, a, nullptr);
+        this->cpu.reset();
+        first = a + 1;
+      }
+    this->cache.batch(first, last, nullptr);
+  }
+  Parameters &getParameters() { return this->params; }
+  Result &getResult() { return this->result; }
+  void save(CheckpointWriter &w) { this->cache.save(w); this->result.save(w); }
+  void restore(CheckpointReader &r) { this->cache.restore(r); this->result.restore(r); }
+private:
+  Parameters params;
+  Rule rule;
+  Ram ram;
+  Result result;
+  Cache<Policy> cache;
+  CPU<Cache<Policy>> cpu;
+};
+
+/* Build the runner of a configuration with its policy (called by withPolicy) */
+struct RunnerFactory {
+  Parameters *params;
+  SweepRunner *made;
+  template <class Policy> void run() { this->made = new CacheRunner<Policy>(*this->params); }
+};
+/* OPT needs the next uses of its own block size, it is not swept */
+template <>
+void RunnerFactory::run<OPTPolicy>() {
+  throw string("OPT cannot be swept, simulate it on its own (Code: 008).\n");
+}
+
+/* Constructor: build the caches, and start the threads (no more than the caches) */
+Sweep::Sweep(vector<Parameters> &configs, unsigned n_threads) : nextRunner(0) {
+  for (auto &config : configs) {
+    RunnerFactory factory = {&config, nullptr};
+    withPolicy(config.getReplacePolicy(), factory);
+    this->runners.emplace_back(factory.made);
+  }
+
+  for (auto &batch : this->batches)
+    batch.reserve(SWEEP_BATCH);
+
+  if (n_threads > this->runners.size())
+    n_threads = this->runners.size();
+  for (unsigned i=0; i!=n_threads; ++i)
+    this->workers.emplace_back(&Sweep::work, this);
+}
+
+/* Destructor: stop the threads (if finish() was not reached) */
+Sweep::~Sweep() {
+  {
+    lock_guard<mutex> guard(this->lock);
+    this->stopping = true;
+  }
+  this->ready.notify_all();
+  for (auto &worker : this->workers)
+    if (worker.joinable())
+      worker.join();
+}
+
+/* Hand the batch being filled to the threads, once they are done with the previous one, and fill the other one */
+void Sweep::publish() {
+  unique_lock<mutex> guard(this->lock);
+  this->idle.wait(guard, [this] { return this->busy == 0; });
+  this->filling ^= 1;
+  this->batches[this->filling].clear();
+  this->nextRunner = 0;
+  this->busy = this->workers.size();
+  ++this->published;
+  guard.unlock();
+  this->ready.notify_all();
+}
+
+/* The loop of a thread: run every published batch on the caches it takes */
+void Sweep::work() {
+  uint64_t seen = 0;
+  unique_lock<mutex> guard(this->lock);
+  for (;;) {
+    this->ready.wait(guard, [&] { return this->published != seen || this->stopping; });
+    if (this->published == seen)
+      return;
+    seen = this->published;
+    // The published batch is the one not being filled
+    const vector<Access> &batch = this->batches[this->filling ^ 1];
+    guard.unlock();
+
+    for (unsigned i; (i = this->nextRunner++) < this->runners.size(); )
+      this->runners[i]->run(batch.data(), batch.data() + batch.size());
+
+    guard.lock();
+    if (--this->busy == 0)
+      this->idle.notify_all();
+  }
+}
+
+/* Run the last batch, and wait for the threads to be done with it */
+void Sweep::finish() {
+  if (!this->batches[this->filling].empty())
+    this->publish();
+  unique_lock<mutex> guard(this->lock);
+  this->idle.wait(guard, [this] { return this->busy == 0; });
+}
+
+/* Write the cache of every configuration to a checkpoint, once the threads are done with the accesses appended */
+void Sweep::save(CheckpointWriter &w) {
+  this->finish();
+  w.put((uint64_t)this->runners.size());
+  for (auto &runner : this->runners)
+    runner->save(w);
+}
+
+/* Read the caches back from a checkpoint of a sweep of the same configurations (before any access is appended) */
+void Sweep::restore(CheckpointReader &r) {
+  uint64_t n;
+  r.get(n);
+  if (n != this->runners.size())
+    CheckpointReader::mismatch();
+  for (auto &runner : this->runners)
+    runner->restore(r);
+}
+
+/* Print one row per configuration to stdout */
+ostream &print(ostream &os, const Sweep &sweep, const Result &result) {
+  // A sampled sweep has the miss rate estimate of each configuration, with the margin of its 95% confidence interval
+  bool sampled = !sweep.runners.empty() && sweep.runners[0]->getResult().isSampled();
+  // With a prefetcher, the prefetches of each configuration, and their accuracy and coverage
+  bool prefetching = !sweep.runners.empty() && sweep.runners[0]->getResult().isPrefetching();
+  // With -K, the misses of each configuration by class
+  bool classified = !sweep.runners.empty() && sweep.runners[0]->getResult().isClassified();
+  // With -V, the misses the victim cache (or miss cache) of each configuration supplied
+  bool victims = !sweep.runners.empty() && sweep.runners[0]->getResult().hasVictimCache();
+  os << "SWEEP RESULTS=================================\n";
+  os << "Instruction count:\t" << result.count_instructions() << "\n";
+  os << "Cache Size\tBlock Size\tAssociativity\tSets\tPolicy\tRead hits\tRead misses\tRead miss rate\t"
+     << "Write hits\tWrite misses\tWrite miss rate\tWritebacks\tBytes read\tBytes written"
+     << (sampled ? "\tMiss rate\t95% margin" : "") << (prefetching ? "\tPrefetches\tUseful\tAccuracy\tCoverage" : "")
+     << (classified ? "\tCompulsory\tCapacity\tConflict" : "") << (victims ? "\tVictim hits" : "") << "\n";
+  for (auto &runner : sweep.runners) {
+    Parameters &p = runner->getParameters();
+    Result &r = runner->getResult();
+    os << p.getCacheSize() << "\t\t" << p.getBlockSize() << "\t\t" << p.getSetSize() << "\t\t" << p.getSetCount() << "\t"
+       << p.getReplacePolicy() << "\t" << r.count_read_hits() << "\t\t" << r.count_read_misses() << "\t\t"
+       << setprecision(PRECISION_DOUBLE+2) << r.count_read_miss_rate()*100 << "%\t\t"
+       << r.count_write_hits() << "\t\t" << r.count_write_misses() << "\t\t"
+       << setprecision(PRECISION_DOUBLE+2) << r.count_write_miss_rate()*100 << "%\t\t"
+       << r.count_writebacks() << "\t\t" << r.count_read_bytes() << "\t\t" << r.count_written_bytes();
+    if (sampled)
+      os << "\t\t" << setprecision(PRECISION_DOUBLE+2) << r.count_miss_rate()*100 << "%\t\t"
+         << r.count_miss_rate_margin()*100 << "%";
+    if (prefetching)
+      os << "\t\t" << r.count_prefetches() << "\t\t" << r.count_prefetches_useful() << "\t"
+         << setprecision(PRECISION_DOUBLE+2) << r.count_prefetch_accuracy()*100 << "%\t\t"
+         << r.count_prefetch_coverage()*100 << "%";
+    if (classified)
+      os << "\t\t" << r.count_misses(MISS_COMPULSORY) << "\t\t" << r.count_misses(MISS_CAPACITY) << "\t\t"
+         << r.count_misses(MISS_CONFLICT);
+    if (victims)
+      os << "\t\t" << r.count_victim_hits();
+    os << "\n";
+  }
+  os << flush;
+
+  return os;
+}
@@ -0,0 +1,24 @@
+/* ./src/TraceCapture.cc
+ *
+ *  class TraceCapture writes the accesses of the algorithm to a binary trace (-w),
+ *    which is replayed instead of the algorithm with -i (see Algorithms::replay).
+ */
+
+#include "classes.hh"
+#include <iomanip>
+
+/* Print the size of the trace to stdout */
+ostream &print(ostream &os, const TraceCapture &capture, const Result &result) {
+  const TraceWriter &trace = *capture.trace;
+
+  os << "TRACE=========================================\n";
+  os << "Instruction count:\t" << result.count_instructions() << "\n";
+  os << "Accesses:\t\t" << trace.getRecords() << "\n";
+  os << "Chunks:\t\t\t" << trace.getChunks() << "\n";
+  os << "Bytes:\t\t\t" << trace.getBytes() << "\n";
+  os << "Bytes per access:\t" << fixed << setprecision(2)
+     << (trace.getRecords() ? static_cast<double>(trace.getBytes()) / trace.getRecords() : 0) << "\n";
+  os << flush;
+
+  return os;
+}
@@ -1,13 +1,30 @@
 /* Assumes each word is 8 bytes,
- *  and address is 32 bits */
-#define ADDRESS_LEN 32
+ *  and address is 64 bits */
+#define ADDRESS_LEN 64
 #define WORD_SIZE 8
+/* The ram is allocated in pages of RAM_PAGE_SIZE bytes (or of one block, if a block is larger),
+ *  carved from arenas of RAM_ARENA_SIZE bytes of address space (the host commits them as they are touched) */
+#define RAM_PAGE_SIZE 4096
+#define RAM_ARENA_SIZE (1ul << 30)
+/* The Ram remembers the last page of RAM_RECENT_PAGES page numbers (direct-mapped), in front of its page table */
+#define RAM_RECENT_PAGES 1024
+/* Cache::batch decodes the sets and tags of ACCESS_DECODE accesses at a time */
+#define ACCESS_DECODE 64
 
 #include <cstdint>
 #include <iostream>
 #include <climits>
+#include <cstring>
 #include <vector>
-#include "../lib/containers.hh"
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "../lib/policies.hh"
 
 using namespace::std;
 
@@ -15,44 +32,163 @@ using namespace::std;
 struct Algorithms; // Contains the three algorithms used in this assignment
 class Parameters; // Input parameters, and is able to be printed to stdout (has default values)
 class Result; // Results (IC, Hit, Miss), and is able to be printed to stdout
-typedef uint32_t Address; // Address has 32 bits
+typedef uint64_t Address; // Address has 64 bits
 typedef double Register; // Register stores a double
 
 /* Type declarations: The CPU components */
 class Rule; // Addressing rule
-class DataBlock; // DataBlock (with a vector of bytes)
-class Ram; // Ram (a vector of DataBlocks)
-class Cache; // Cache (a vector of sets)
-struct CPU; // CPU (instruction handler)
+class DataBlock; // DataBlock (a view of the words of a block)
+class Ram; // Ram (a sparse table of pages, in arenas of words)
+template <class Policy> class Cache; // Cache (a vector of sets), templated on the replacement policy
+template <class Memory> struct CPU; // CPU (instruction handler), templated on the memory it accesses
+class BlockRecorder; // The memory of the first pass of OPT, records the blocks accessed
+class StackProfiler; // The memory of the miss curves, measures the stack distance of every access
+struct Access; // An access of a batch (CPU::batch), or of the stream of a sweep
+class SweepRunner; // A cache of a sweep, behind a virtual interface
+class Sweep; // The memory of a sweep, fans the stream out to the caches of every configuration
+class TraceCapture; // The memory of a capture, writes the stream to a trace
+template <class Policy> class Hierarchy; // The memory of a hierarchy, the caches of every level (L1 first)
+template <class Policy> class Partition; // The memory of a partitioned cache, its sets are simulated by several threads
+template <class Policy> class Multicore; // The cores of a multicore, their private caches kept coherent by a snooping bus
+
+
+/* struct Access, an access of a batch (CPU::batch), or of the stream of a sweep
+ *  op is ACCESS_READ, ACCESS_WRITE, or ACCESS_RESET (CPU::reset() in a sweep, the address is unused)
+ */
+enum AccessOp : unsigned char { ACCESS_READ, ACCESS_WRITE, ACCESS_RESET };
+struct Access {
+  Address address;
+  AccessOp op;
+};
+
+/* Run a batch one access at a time, values[i] is the value loaded by a read, or stored by a write
+ *  (the batch of the memories that have no faster path than getDouble() and setDouble()) */
+template <class Memory>
+inline void accessEach(Memory &memory, const Access *first, const Access *last, double *values) {
+  for (; first != last; ++first, ++values)
+    if (first->op == ACCESS_WRITE)
+      memory.setDouble(first->address, *values);
+    else
+      *values = memory.getDouble(first->address);
+}
+
+/* struct Layout, the closed-form addresses of an array of doubles of an algorithm (a vector, or a matrix)
+ *  The address of the element (row, col) is base + (row*rowStride + col*colStride) * WORD_SIZE, computed when it is accessed,
+ *  so the algorithms stream the addresses of their arrays without a table of them (the host memory is not in the problem size).
+ *  public members:
+ *    Layout(Address, unsigned, unsigned): a matrix of rows x cols stored in rows from the base address (a vector is a single row)
+ *    Address operator()(unsigned, unsigned): the address of an element
+ *    Address operator[](unsigned): the address of an element of a vector
+ *    Layout transposed(): the same elements, with the rows and the columns swapped (a matrix indexed in columns)
+ *    uint64_t size(): the number of elements
+ *    Address end(): the address after the last element (the base of the next array)
+ *  public fields: base, rows, cols, rowStride and colStride (in words)
+ */
+struct Layout {
+  Layout(Address b, unsigned r, unsigned c) : base(b), rows(r), cols(c), rowStride(c), colStride(1) {}
+  inline Address operator()(unsigned row, unsigned col) const {
+    return this->base + ((uint64_t)row*this->rowStride + (uint64_t)col*this->colStride) * WORD_SIZE; }
+  inline Address operator[](unsigned i) const { return this->base + (uint64_t)i*this->colStride * WORD_SIZE; }
+  inline Layout transposed() const {
+    Layout t(*this);
+    swap(t.rows, t.cols);
+    swap(t.rowStride, t.colStride);
+    return t; }
+  inline uint64_t size() const { return (uint64_t)this->rows * this->cols; }
+  inline Address end() const { return this->base + this->size() * WORD_SIZE; }
+  Address base;
+  unsigned rows, cols;
+  uint64_t rowStride, colStride;
+};
 
 
 /* Struct Algorithms (algorithm brancher)
  *
  *  member functions (public):
- *    enter: Initialize the algorithm parameters, and enter the algorithm function (daxpy, mxmMult, or mxmMultBlock)
+ *    enter: Initialize the algorithm parameters, resolve the replacement policy, and call run
+ *    run<Policy>: Build the cache and the CPU, and execute the algorithm
+ *      (run<OPTPolicy> executes it twice: first on a BlockRecorder, then on the cache with the next uses)
+ *    hierarchy<Policy>: Build the levels of a hierarchy and the CPU, execute the algorithm, and print every level (-L)
+ *    partition<Policy>: Build the shards of a partitioned cache and the CPU, execute the algorithm, and print the merged results (-P)
+ *    multicore<Policy>: Build the cores, run the share of the algorithm of each of them on it, and print every core (-N)
+ *    slice: The share of a core of the parallel algorithm (the iterations of daxpy, the rows of mxm, the columns of blocks
+ *      of mxm_block are cut into contiguous ranges, one per core), the first core initializes the arrays with -l
+ *    execute: Enter the algorithm function (daxpy, mxmMult, or mxmMultBlock)
+ *    profile: Execute the algorithm on a StackProfiler, and print the miss curves (instead of run, with -m)
+ *    sweep: Execute the algorithm on a Sweep, and print the results of every configuration (instead of run, with lists)
+ *    capture: Execute the algorithm on a TraceCapture, and print the size of the trace (instead of run, with -w)
+ *    replay: The algorithm of a trace (-i), every access of the trace goes through the CPU
+ *    replayExternal: The algorithm of a trace of another tool (Dinero, lackey, ChampSim), read ahead by ExternalTrace
+ *    replayAccess: Append an access of a trace to the batch (run when it is full)
+ *    flush: Run the batch on the CPU (CPU::batch), and empty it
+ *    storeEach: Store a value to every element of an array (in the order of its rows), in batches (the initialization of the arrays)
+ *    initialize: Store the initial values of the arrays, and reset the CPU (unless -l), then save a checkpoint (-C),
+ *      or restore the checkpoint of the initialization instead of running it (-R)
+ *    save, restore: Write the state after the initialization to a checkpoint, read it back (see Algorithms::save)
  *    daxpy: The daxpy algorithm
  *    mxmMult: The naive matrix by matrix multiplication algorithm
  *    mxmMultBlock: The blocking algorithm of matrix by matrix multiplication
  *    doBlock: Subroutine of mxmMultBlock
+ *  The algorithms are templated on the memory of the CPU, so every access is resolved at compile time,
+ *  and they hand the accesses to the CPU in batches wherever the values stored do not depend on the values loaded in the batch.
  *  private members:
- *    testsize (dim), pointers to rule, ram, result, and cache
+ *    testsize (dim), pointers to params, rule, ram, and result
+ *    out: where the algorithms print (stdout, or nowhere in the recording pass of OPT and in profile)
+ *    accesses, values: the batch of accesses, and their values (loaded, or to store)
  */
 struct Algorithms {
   Algorithms() {}
   void enter(Parameters &params); // Initializer and branch handler
-  void daxpy(Parameters &params); // Daxpy algorithm
-  void mxmMult(Parameters &params); // mxmMult algorithm
-  void mxmMultBlock(Parameters &params); // mxmMultBlock algorithm
-  void doBlock(CPU &myCpu, const unsigned test_size, const unsigned blocking_factor,
-    unsigned si, unsigned sj, unsigned sk, vector<Address> &a, vector<Address> &b, vector<Address> &c);
+  template <class Policy> void run(); // Simulate with the replacement policy (called by withPolicy)
+  template <class Policy> void hierarchy(); // Simulate the levels of a hierarchy with the replacement policy
+  template <class Policy> void partition(); // Simulate the cache on several threads, its sets partitioned across them
+  template <class Policy> void multicore(); // Simulate the parallel algorithm on several cores
+  template <class Memory> void slice(Parameters &params, CPU<Memory> &myCpu, unsigned core, unsigned cores); // A core's share
+  template <class Memory> void execute(Parameters &params, CPU<Memory> &myCpu); // Algorithm brancher
+  void profile(); // Measure the miss curves of LRU (-m)
+  void sweep(); // Simulate every configuration of the lists at once
+  void capture(); // Write the trace of the algorithm (-w)
+  template <class Memory> void replay(Parameters &params, CPU<Memory> &myCpu); // Replay a trace (-i)
+  template <class Memory> void replayExternal(Parameters &params, CPU<Memory> &myCpu); // Replay a trace of another tool
+  template <class Memory> void replayAccess(CPU<Memory> &myCpu, Address address, bool write); // Replay an access
+  template <class Memory> void flush(CPU<Memory> &myCpu); // Run the batch of accesses
+  template <class Memory, class Value> void storeEach(CPU<Memory> &myCpu, const Layout &array, Value value);
+  template <class Memory> void initialize(Parameters &params, CPU<Memory> &myCpu,
+    const Layout &a, const Layout &b, const Layout &c); // The initialization of the arrays
+  template <class Memory> void save(Parameters &params, CPU<Memory> &myCpu, const vector<uint64_t> &arrays); // Checkpoint (-C)
+  template <class Memory> void restore(Parameters &params, CPU<Memory> &myCpu, const vector<uint64_t> &arrays); // Restore (-R)
+  template <class Memory> void daxpy(Parameters &params, CPU<Memory> &myCpu); // Daxpy algorithm
+  template <class Memory> void mxmMult(Parameters &params, CPU<Memory> &myCpu); // mxmMult algorithm
+  template <class Memory> void mxmMultBlock(Parameters &params, CPU<Memory> &myCpu); // mxmMultBlock algorithm
+  template <class Memory> void doBlock(CPU<Memory> &myCpu, const unsigned test_size, const unsigned blocking_factor,
+    unsigned si, unsigned sj, unsigned sk, const Layout &a, const Layout &b, const Layout &c);
 private:
   unsigned testsize;
+  Parameters *params;
   Rule *rule;
   Ram *ram;
   Result *result;
-  Cache *cache;
+  ostream *out;
+  vector<Access> accesses;
+  vector<double> values;
 };
+/* OPT simulates in two passes (defined in Algorithm.cc) */
+template <> void Algorithms::run<OPTPolicy>();
+
+
+/* The inclusion policy of a hierarchy:
+ *  INCLUSION_INCLUSIVE: every level holds the blocks of the levels above it, a victim of a lower level is invalidated above it
+ *  INCLUSION_EXCLUSIVE: a block is in one level at most, it moves up on a hit, and the victims of a level move down to the next one
+ *  INCLUSION_NINE: non-inclusive non-exclusive, a miss fills every level on its way, and the victims are dropped
+ */
+enum Inclusion { INCLUSION_INCLUSIVE, INCLUSION_EXCLUSIVE, INCLUSION_NINE };
 
+/* The coherence protocol of the private caches of a multicore (the states a line can take, see Multicore):
+ *  PROTOCOL_MSI: modified, shared, invalid
+ *  PROTOCOL_MESI: and exclusive (the only clean copy, written without a bus request)
+ *  PROTOCOL_MOESI: and owned (a dirty copy shared with the others, it supplies them, and is written back when it is evicted)
+ */
+enum Protocol { PROTOCOL_MSI, PROTOCOL_MESI, PROTOCOL_MOESI };
 
 /* class Parameters (stores the input parameters)
  *
@@ -60,7 +196,7 @@ private:
  *  public members:
  *    Parameters() {}: default constructor
  *    Parameters(int, char) {}: Constructor, produced by commandline arguments
- *    unsigned getRamSize(): Obtain the ram size
+ *    uint64_t getRamSize(): Obtain the ram size (the footprint of the algorithm)
  *    unsigned getCacheSize(): Obtain the cache size
  *    unsigned get BlockSize(): Obtain the block size
  *    unsigned getSetCount(): Get the number of sets in the cache
@@ -68,10 +204,41 @@ private:
  *    unsigned getTestSize(): Get the dimension of the test array/matrix
  *    unsigned getBlockingFactor(): Get the blocking factor of the function
  *    unsigned printOutput(): Print the output (results) to stdout
+ *    bool timingOnly(): Simulate the tags only (no payload), never when the output is printed
+ *      (always with missCurves, a trace, a hierarchy, a partitioned cache, sampling, or several cores)
+ *    bool missCurves(): Measure the LRU misses of every power-of-two cache up to the cache size, in one run
+ *    bool isSweep(): Whether the lists of the cache sizes, block sizes, associativities and policies hold several configurations
+ *    vector<Parameters> configurations(): Every configuration of the lists (each with a single value, in timing mode)
+ *    bool isHierarchy(): Whether levels are given below the cache (-L)
+ *    vector<Parameters> levels(): The parameters of the levels below the cache (L2 first, each in timing mode)
+ *    Inclusion getInclusion(): The inclusion policy of the hierarchy
+ *    bool writeBack(): Whether writes stay in the cache until the block is evicted (-W back), or go through to the ram (-W through)
+ *    bool writeAllocate(): Whether a write miss fills the block (-A alloc), or only writes the ram (-A noalloc)
+ *    unsigned getThreads(): The number of threads of a sweep
+ *    unsigned getShards(): The number of threads the sets of the cache are partitioned across (1 if they are not, -P)
+ *    Parameters shard(): The parameters of the cache of a shard (the sets of the cache divided by the shards, in timing mode)
+ *    unsigned getSampledSets(): Set sampling (-S), one set in this many is simulated (a power of two, 1 if every set is)
+ *    uint64_t getSampleWindow(), getSamplePeriod(): Time sampling (-T), a window of accesses is measured in every period of
+ *      accesses, the others only warm the cache (0 if the whole stream is measured)
+ *    bool isSampled(): Whether the cache is sampled (in sets or in time)
+ *    unsigned getCores(): The number of cores, each with a private cache (-N, 1 for a single CPU)
+ *    Protocol getProtocol(): The coherence protocol of the private caches (-M)
+ *    unsigned getQuantum(): The accesses every core simulates on its own before the bus is resolved (-Q)
+ *    PrefetchKind getPrefetcher(): The prefetcher of the cache (-F, PREFETCH_NONE if none)
+ *    unsigned getPrefetchDegree(), getPrefetchLatency(): The blocks it prefetches ahead, and the accesses a prefetch takes
+ *      (a prefetched block used sooner is late)
+ *    bool classifyMisses(): Whether every miss is classified as compulsory, capacity or conflict (-K)
+ *    unsigned getVictimEntries(): The blocks of the victim cache (or miss cache) beside the cache (-V, 0 if none)
+ *    bool isMissCache(): Whether it is a miss cache (it holds the blocks missed) rather than a victim cache (the blocks evicted)
+ *    string &getCheckpointOutput(), getCheckpointInput(): The checkpoint to save the state after the initialization to (-C),
+ *      and the one to restore it from instead of running the initialization (-R), empty if none
+ *    string &getTraceInput(): The trace to replay instead of the algorithm (empty if none)
+ *    string &getTraceOutput(): The trace to capture the accesses of the algorithm to (empty if none)
+ *    TraceFormat getTraceFormat(): The format of the trace to replay (-e, or by its extension)
  *    unsigned getReplacePolicy(): Get the replacement policy as std::string
  *    unsigned getAlgorithm(): Get the algorithm as std::string
  *  private (the default values are specified by the problem set):
- *    ram_size (unsigned long), the ram sie in bytes, defaults to 3840000ul;
+ *    ram_size (uint64_t), the ram sie in bytes (the footprint of the algorithm, the ram is allocated as it is touched), defaults to 3840000ul;
  *    cache_size (unsigned), the cache_size in bytes, defaults to 65536u;
  *    block_size (unsigned), the block_size in bytes, defaults to 64u;
  *    n_map (unsigned), the associativity, defaults to 2u;
@@ -81,6 +248,25 @@ private:
  *    dimension (unsigned), the dimension of the vector/matrix, defaults to 480u;
  *    blocking_factor (unsigned), the blocking_factor of the mxm_block algorithm;
  *    output (bool), whether to print out the vector/matrix;
+ *    timing (bool), whether to run in timing mode (tags only, no data is stored in the cache or the ram);
+ *    curves (bool), whether to measure the miss curves (stack distances) instead of simulating one cache;
+ *    cache_sizes, block_sizes, n_maps, replacement_policies (vectors), the lists given to -c, -b, -n and -r
+ *      (comma separated, the single values above are their first elements);
+ *    threads (unsigned), the number of threads of a sweep, defaults to the number of host threads;
+ *    shards (unsigned), the number of threads the sets of a single cache are partitioned across (-P), defaults to 1;
+ *    sample_sets (unsigned), sample_window and sample_period (uint64_t), the sampling given to -S and -T (none by default);
+ *    checkpoint_out, checkpoint_in (std::string), the checkpoints given to -C and -R;
+ *    cores (unsigned), protocol (std::string) and quantum (unsigned), the multicore given to -N, -M and -Q,
+ *      default to 1 core, MESI, and 1024 accesses;
+ *    prefetcher (std::string), prefetch_degree and prefetch_latency (unsigned), the prefetcher given to -F (kind:degree:latency),
+ *      none by default, with a degree of 1 and a latency of 32 accesses;
+ *    classify (bool), whether to classify the misses (-K);
+ *    victim_entries (unsigned) and miss_cache (bool), the victim cache given to -V (entries[:victim|miss]), none by default;
+ *    trace_in, trace_out (std::string), the traces given to -i and -w;
+ *    trace_format (std::string), the format given to -e (empty to tell it by the extension);
+ *    level_sizes, level_maps (vectors), the cache size and associativity of the levels below the cache (-L size:ways,...);
+ *    inclusion (std::string), the inclusion policy given to -I (inclusive, exclusive, or nine), defaults to inclusive;
+ *    write_back, write_allocate (bool), the write policy given to -W and -A, default to write-back and write-allocate;
  */
 class Parameters {
   friend ostream &print(ostream &os, const Parameters &p);
@@ -89,7 +275,7 @@ public:
   Parameters() {};
   Parameters(int argc, char *argv[]);
   // Fetch specific parameters
-  inline unsigned getRamSize() const { return this->ram_size; }
+  inline uint64_t getRamSize() const { return this->ram_size; }
   inline unsigned getCacheSize() const { return this->cache_size; }
   inline unsigned getBlockSize() const { return this->block_size; }
   inline unsigned getSetCount() const { return this->n_sets; }
@@ -98,16 +284,69 @@ public:
   inline unsigned getBlockingFactor() const { return this->blocking_factor; }
   inline bool printOutput() const { return this->output; }
   inline bool resetResult() const { return !this->load; }
+  inline bool timingOnly() const {
+    return (this->timing && !this->output) || this->curves || !this->trace_in.empty() || this->isHierarchy() || this->shards > 1 || this->isSampled()
+      || this->cores > 1; }
+  inline bool missCurves() const { return this->curves; }
+  inline bool isSweep() const {
+    return this->cache_sizes.size() * this->block_sizes.size() * this->n_maps.size() * this->replacement_policies.size() > 1; }
+  vector<Parameters> configurations() const;
+  inline bool isHierarchy() const { return !this->level_sizes.empty(); }
+  vector<Parameters> levels() const;
+  Inclusion getInclusion() const;
+  inline bool writeBack() const { return this->write_back; }
+  inline bool writeAllocate() const { return this->write_allocate; }
+  inline unsigned getThreads() const { return this->threads; }
+  inline unsigned getShards() const { return this->shards; }
+  Parameters shard() const;
+  inline unsigned getSampledSets() const { return this->sample_sets; }
+  inline uint64_t getSampleWindow() const { return this->sample_window; }
+  inline uint64_t getSamplePeriod() const { return this->sample_period; }
+  inline bool isSampled() const { return this->sample_sets > 1 || this->sample_window != 0; }
+  inline unsigned getCores() const { return this->cores; }
+  Protocol getProtocol() const;
+  inline unsigned getQuantum() const { return this->quantum; }
+  inline PrefetchKind getPrefetcher() const {
+    return this->prefetcher.empty() ? PREFETCH_NONE : Prefetcher::kindNamed(this->prefetcher); }
+  inline unsigned getPrefetchDegree() const { return this->prefetch_degree; }
+  inline unsigned getPrefetchLatency() const { return this->prefetch_latency; }
+  inline bool classifyMisses() const { return this->classify; }
+  inline unsigned getVictimEntries() const { return this->victim_entries; }
+  inline bool isMissCache() const { return this->miss_cache; }
+  inline string &getCheckpointOutput() { return this->checkpoint_out; }
+  inline string &getCheckpointInput() { return this->checkpoint_in; }
+  inline string &getTraceInput() { return this->trace_in; }
+  inline string &getTraceOutput() { return this->trace_out; }
+  inline TraceFormat getTraceFormat() const {
+    return this->trace_format.empty() ? ExternalTrace::formatOf(this->trace_in) : ExternalTrace::formatNamed(this->trace_format); }
   inline string &getReplacePolicy() { return this->replacement_policy; }
   inline string &getAlgorithm() { return this->algorithm; }
 private:
   // The field values are filled with default parameters
-  unsigned long ram_size = 3840000ul;
+  uint64_t ram_size = 3840000ul;
   unsigned cache_size = 65536u, block_size = 64u, n_map = 2u, n_sets = 512u;
   string replacement_policy = "LRU";
   string algorithm = "mxm_block";
   unsigned dimension = 480u, blocking_factor = 32u;
-  bool output = false, load=false;
+  bool output = false, load=false, timing=false, curves=false;
+  vector<unsigned> cache_sizes = {65536u}, block_sizes = {64u}, n_maps = {2u};
+  vector<string> replacement_policies = {"LRU"};
+  unsigned threads = 1;
+  unsigned shards = 1;
+  unsigned sample_sets = 1;
+  uint64_t sample_window = 0, sample_period = 0;
+  string checkpoint_out, checkpoint_in;
+  unsigned cores = 1, quantum = 1024;
+  string protocol = "MESI";
+  string prefetcher;
+  unsigned prefetch_degree = 1, prefetch_latency = 32;
+  bool classify = false;
+  unsigned victim_entries = 0;
+  bool miss_cache = false;
+  string trace_in, trace_out, trace_format;
+  vector<unsigned> level_sizes, level_maps;
+  string inclusion = "inclusive";
+  bool write_back = true, write_allocate = true;
 };
 /* Print the parameters to stdout */
 ostream &print(ostream &os, const Parameters &p);
@@ -115,42 +354,133 @@ ostream &print(ostream &os, const Parameters &p);
 /* class Results
  *
  *  friend function: print()
- *  friend struct CPU, which has access to the reset() function;
+ *  friend struct CPU, which has access to the reset() function (and Hierarchy, which resets the results of its lower levels);
  *
  *  public members:
  *   incremental functions: void instruction(), void read_hit(), void read_miss(), void write_hit(), void write_miss();
+ *   void instructions(uint64_t), count several instructions at once (a replay);
+ *   void merge(const Result&), add the counters of another result (a shard of a partitioned cache);
+ *   sampling (-S, -T): void sampling(double), the fraction of the population of clusters that is sampled (kept by reset()),
+ *     void sample(uint64_t, uint64_t, bool), one more access of a cluster (a sampled set, or a window of the stream)
+ *     that had so many accesses and misses before it, and whether it missed;
+ *     the miss rate is a ratio estimate over the clusters, count_miss_rate_margin() is the half-width of its 95% confidence
+ *     interval (NaN with less than two clusters);
+ *   traffic below the cache: void fetch(unsigned), void writeback(unsigned), void write_through(unsigned), count the bytes
+ *     of a block filled, of a dirty block written back, and of a word written through (or around, without write-allocate);
+ *   prefetching (-F): void prefetching(), the cache has a prefetcher (its counters are printed), void prefetch(unsigned),
+ *     a block prefetched (issued, its bytes count in the traffic below), void prefetch_used(bool), a prefetched block used
+ *     by a demand access (and whether it was late: used before the latency of the prefetch was over),
+ *     void prefetch_polluted(), a demand miss on a block a prefetch evicted;
+ *     the accuracy is the share of the prefetches used, the coverage the share of the misses they removed;
+ *   miss classification (-K): void classifying(), the misses of the cache are classified (the classes are printed),
+ *     void miss_class(MissKind), count a miss in its class (compulsory, capacity, conflict);
+ *   victim cache (-V): void victim_caching(bool), the cache has a victim cache (or a miss cache, if true),
+ *     void victim_hit(), a miss of the cache the victim cache supplied (it is still counted as a miss, but nothing is fetched);
  *   The functions start with count_ returns the correponding statistics to the callee;
+ *   void save(CheckpointWriter&), void restore(CheckpointReader&), write the counters to a checkpoint, read them back;
  *  private:
- *   The field values (instruction_count, read_hits, read_misses, write_hits, write_misses) that records runtime statistics.
+ *   The field values (instruction_count, read_hits, read_misses, write_hits, write_misses) that records runtime statistics,
+ *   and the traffic below the cache (fetches, writebacks, read_bytes, written_bytes);
+ *   The prefetches (prefetches issued, useful, late, polluting), and whether the cache has a prefetcher (prefetcher);
+ *   The misses of each class (classes, indexed by MissKind), and whether they are classified (classified);
+ *   The hits of the victim cache (victim_hits), whether the cache has one (victims), and whether it is a miss cache (missCache);
+ *   The sums over the clusters of a sampled cache: clusters, the squares of their accesses and misses and their products, fraction.
  */
 class Result {
   friend ostream &print(ostream &os, const Result &results);
-  friend struct CPU;
+  template <class Memory> friend struct CPU;
+  template <class Policy> friend class Hierarchy;
 public:
   // Constructor (default)
   Result() {}
   // Increase counters
   inline void instruction() { ++this->instruction_count; }
+  inline void instructions(uint64_t count) { this->instruction_count += count; }
   inline void read_hit() { ++this->read_hits; }
   inline void read_miss() { ++this->read_misses; }
   inline void write_hit() { ++this->write_hits; }
   inline void write_miss() { ++this->write_misses; }
+  inline void fetch(unsigned bytes) { ++this->fetches; this->read_bytes += bytes; }
+  inline void writeback(unsigned bytes) { ++this->writebacks; this->written_bytes += bytes; }
+  inline void write_through(unsigned bytes) { this->written_bytes += bytes; }
+  inline void prefetching() { this->prefetcher = true; }
+  inline void prefetch(unsigned bytes) { ++this->prefetches; this->read_bytes += bytes; }
+  inline void prefetch_used(bool late) { ++this->prefetches_useful; this->prefetches_late += late; }
+  inline void prefetch_polluted() { ++this->prefetches_polluting; }
+  inline void classifying() { this->classified = true; }
+  inline void miss_class(MissKind kind) { ++this->classes[kind]; }
+  inline void victim_caching(bool miss) { this->victims = true; this->missCache = miss; }
+  inline void victim_hit() { ++this->victim_hits; }
+  void merge(const Result &other);
+  inline void sampling(double sampled) { this->fraction = sampled; }
+  inline void sample(uint64_t accesses, uint64_t misses, bool miss) {
+    this->clusters += accesses == 0;
+    this->accesses_squared += 2.0*accesses + 1;
+    this->misses_squared += miss ? 2.0*misses + 1 : 0;
+    this->products += misses + (miss ? accesses + 1.0 : 0); }
   // Counting member functions (for printing out the result)
-  inline unsigned count_instructions() const { return this->instruction_count; }
-  inline unsigned count_read_hits() const { return this->read_hits; }
-  inline unsigned count_read_misses() const { return this->read_misses; }
+  inline uint64_t count_instructions() const { return this->instruction_count; }
+  inline uint64_t count_read_hits() const { return this->read_hits; }
+  inline uint64_t count_read_misses() const { return this->read_misses; }
   inline double count_read_miss_rate() const { return static_cast<double>(this->read_misses) / (this->read_hits + this->read_misses); }
-  inline unsigned count_write_hits() const { return this->write_hits; }
-  inline unsigned count_write_misses() const { return this->write_misses; }
+  inline uint64_t count_write_hits() const { return this->write_hits; }
+  inline uint64_t count_write_misses() const { return this->write_misses; }
   inline double count_write_miss_rate() const { return static_cast<double>(this->write_misses) / (this->write_hits + this->write_misses); }
+  inline uint64_t count_fetches() const { return this->fetches; }
+  inline uint64_t count_writebacks() const { return this->writebacks; }
+  inline uint64_t count_read_bytes() const { return this->read_bytes; }
+  inline uint64_t count_written_bytes() const { return this->written_bytes; }
+  inline bool isPrefetching() const { return this->prefetcher; }
+  inline uint64_t count_prefetches() const { return this->prefetches; }
+  inline uint64_t count_prefetches_useful() const { return this->prefetches_useful; }
+  inline uint64_t count_prefetches_late() const { return this->prefetches_late; }
+  inline uint64_t count_prefetches_polluting() const { return this->prefetches_polluting; }
+  inline double count_prefetch_accuracy() const { return static_cast<double>(this->prefetches_useful) / this->prefetches; }
+  inline double count_prefetch_coverage() const {
+    return static_cast<double>(this->prefetches_useful) / (this->prefetches_useful + this->read_misses + this->write_misses); }
+  inline bool isClassified() const { return this->classified; }
+  inline uint64_t count_misses(MissKind kind) const { return this->classes[kind]; }
+  inline bool hasVictimCache() const { return this->victims; }
+  inline bool isMissCache() const { return this->missCache; }
+  inline uint64_t count_victim_hits() const { return this->victim_hits; }
+  inline double count_victim_hit_rate() const {
+    return static_cast<double>(this->victim_hits) / (this->read_misses + this->write_misses); }
+  inline bool isSampled() const { return this->fraction != 0; }
+  inline uint64_t count_clusters() const { return this->clusters; }
+  inline double count_miss_rate() const {
+    return static_cast<double>(this->read_misses + this->write_misses) /
+      (this->read_hits + this->read_misses + this->write_hits + this->write_misses); }
+  double count_miss_rate_margin() const;
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
 private:
-  // Counting variables
-  unsigned instruction_count = 0;
-  unsigned read_hits = 0;
-  unsigned read_misses = 0;
-  unsigned write_hits = 0;
-  unsigned write_misses = 0;
-  // Reset the results (all valid bits set to 0)
+  // Counting variables (64 bits, a long run overflows 32 bits)
+  uint64_t instruction_count = 0;
+  uint64_t read_hits = 0;
+  uint64_t read_misses = 0;
+  uint64_t write_hits = 0;
+  uint64_t write_misses = 0;
+  uint64_t fetches = 0;
+  uint64_t writebacks = 0;
+  uint64_t read_bytes = 0;
+  uint64_t written_bytes = 0;
+  // The prefetches of the prefetcher (if any)
+  uint64_t prefetches = 0;
+  uint64_t prefetches_useful = 0;
+  uint64_t prefetches_late = 0;
+  uint64_t prefetches_polluting = 0;
+  bool prefetcher = false;
+  // The misses of each class (if they are classified)
+  uint64_t classes[3] = {0, 0, 0};
+  bool classified = false;
+  // The misses the victim cache (if any) supplied
+  uint64_t victim_hits = 0;
+  bool victims = false, missCache = false;
+  // The clusters of a sampled cache (the sums of squares are doubles, they overflow 64 bits on a long run)
+  uint64_t clusters = 0;
+  double accesses_squared = 0, misses_squared = 0, products = 0;
+  double fraction = 0;
+  // Reset the results (all counters set to 0)
   void reset(); // Only the CPU has access to this function
 };
 /* Print the results to stdout */
@@ -164,9 +494,12 @@ ostream &print(ostream &os, const Result &results);
  *    Rule: Constructor;
  *    unsigned getBlockSize(), returns the block size, same as Parameters::getBlockSize()
  *    unsigned getBlockOffset(Address), returns the block offset (byte-precision)
- *    unsigned getBlockIndexRAM(Address), returns the block index of an address in the ram (ram is treated as directly mapped)
+ *    uint64_t getBlockIndexRAM(Address), returns the block index of an address in the ram (ram is treated as directly mapped)
  *    unsigned getSetIndex(Address), returns the set inde of an address in the cache
- *    unsigned getTag(Address), returns the tag value of an address
+ *    Tag getTag(Address), returns the tag value of an address
+ *    Address getAddress(Tag, unsigned), returns the address of the block of a tag in a set (the victim of a level)
+ *    void decode(const Access*, unsigned, unsigned*, Tag*), the sets and tags of a run of accesses (a loop of shifts and masks,
+ *      vectorized by the compiler when the number of sets is a power of two)
  *  private:
  *    word_bit (unsigned): The word offset (by bits)
  *    block_size (unsigned): The size of a block (by bytes)
@@ -174,6 +507,7 @@ ostream &print(ostream &os, const Result &results);
  *    set_count (unsigned): The number of sets in the cache (by sets)
  *    index_len (unsigned): The length of index (by bits)
  *    tag_len (unsigned): The length of tag (by bits)
+ *    set_mask (uint64_t): set_count-1, the set index is masked (rather than divided) when set_pow2
  *    unsigned getBit(unsigned): Get the bit length when given the value size
  */
 class Rule {
@@ -182,10 +516,27 @@ class Rule {
 public:
   Rule(Parameters &p);
   inline unsigned getBlockSize() const { return this->block_size; }
-  inline unsigned getBlockOffset(Address address) const { return address % this->block_size; }
-  inline unsigned getBlockIndexRAM(Address address) const { return address>>offset_len; }
-  inline unsigned getSetIndex(Address address) const { return (address>>offset_len) % this->set_count; }
-  inline unsigned getTag(Address address) const { return address>>offset_len>>index_len; }
+  inline unsigned getBlockOffset(Address address) const { return address & (this->block_size - 1); }
+  inline uint64_t getBlockIndexRAM(Address address) const { return address>>offset_len; }
+  inline unsigned getSetIndex(Address address) const {
+    uint64_t block = address>>offset_len;
+    return this->set_pow2 ? block & this->set_mask : block % this->set_count; }
+  inline Tag getTag(Address address) const { return address>>offset_len>>index_len; }
+  inline Address getAddress(Tag tag, unsigned set_id) const { return ((Address)tag<<index_len | set_id)<<offset_len; }
+  inline void decode(const Access *accesses, unsigned n, unsigned *sets, Tag *tags) const {
+    // The fields are read once (the stores to sets and tags could alias them otherwise)
+    const unsigned offset = this->offset_len, tagShift = this->offset_len + this->index_len;
+    const uint64_t mask = this->set_mask;
+    if (this->set_pow2)
+      for (unsigned i=0; i!=n; ++i) {
+        sets[i] = accesses[i].address>>offset & mask;
+        tags[i] = accesses[i].address>>tagShift;
+      }
+    else
+      for (unsigned i=0; i!=n; ++i) {
+        sets[i] = this->getSetIndex(accesses[i].address);
+        tags[i] = this->getTag(accesses[i].address);
+      } }
 private:
   unsigned word_bit;
   unsigned block_size;
@@ -194,6 +545,8 @@ private:
   unsigned offset_len;
   unsigned index_len;
   unsigned tag_len;
+  uint64_t set_mask;
+  bool set_pow2;
   // Get the number of bits from the input
   unsigned getBit(unsigned val);
 };
@@ -203,32 +556,36 @@ ostream &print(ostream &os, const Rule &rule);
 /* Print the information of an address to stdout */
 ostream &print(ostream &os, const Rule &rule, Address address);
 
-/* Class DataBlock
+/* Class DataBlock, a view of the words of a block (in the payload of a Cache, or in a page of the Ram)
  *
  *  friend class are cache and ram, which means CPU cannot directly access the datablock
+ *  A DataBlock owns no storage, it is made by the cache (or the ram) over its words, and copied by value.
  *
  *  public method:
- *    DataBlock(Parameters&): Constructor
+ *    DataBlock(double*, unsigned): Constructor, the words and their number
  *    void show(): Print out the datablock status at runtime
  *    unsigned getBlockSize()
  *  private method:
+ *    data (double *): the first word of the block
  *    size (unsigned): The number of words in the block
- *    data (vector of double): data is stored in the vector as an array of doubles
+ *    void load(const double*), copy the words of the block from the ram
+ *    void store(double*), copy the words of the block to the ram
  *    double get(unsigned): get a word from the block
  *    void set(unsigned, double): set the value of a word in the block
  */
 class DataBlock {
-  friend class Cache;
+  template <class Policy> friend class Cache;
   friend class Ram;
 public:
-  DataBlock(Parameters &p);
-  void show(); // debugging only
-  inline unsigned getBlockSize() { return this->size; }
+  DataBlock(double *words, unsigned n) { data = words; size = n; }
+  void show() const; // debugging only
+  inline unsigned getBlockSize() const { return this->size; }
 private:
+  double *data;
   unsigned size;
-  vector<double> data;
   // Restricted function that can only be accessed by cache and ram
-  void replace(DataBlock &block);
+  inline void load(const double *words) { memcpy(this->data, words, this->size * WORD_SIZE); }
+  inline void store(double *words) const { memcpy(words, this->data, this->size * WORD_SIZE); }
   inline double get(unsigned block_offset) const { return this->data[block_offset/WORD_SIZE]; }
   inline void set(unsigned block_offset, double val) { this->data[block_offset/WORD_SIZE] = val; }
 };
@@ -236,109 +593,687 @@ private:
 /* Class Ram
  *
  *  friend class Cache, which means only the cache can access the ram
+ *  The ram is a sparse page table: a page (RAM_PAGE_SIZE bytes of blocks) is taken from an arena when it is first touched,
+ *  so the whole 64-bit address space can be accessed without allocating the ram up front (none is allocated in timing mode).
+ *  An arena is an anonymous mapping of RAM_ARENA_SIZE bytes, the host backs it with zeros as the pages are written,
+ *  a block is a view of blockSize contiguous bytes in its page, so a block is copied with one memcpy.
  *
  *  public members:
- *    Ram (Parameters&. Rule*): Constructor
+ *    Ram (Parameters&. Rule*): Constructor, nothing is mapped (O(1))
+ *    ~Ram(): Unmap the arenas
  *    void show(), print out the ram status at runtime
- *    unsigned summary(), print out the summary status of the ram (currently shows number of blocks only)
+ *    unsigned summary(), print out the summary status of the ram (the pages and arenas in use)
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&), write the pages to a checkpoint, read them back
  *  private members:
- *    numBlocks (unsigned)
- *    data (vectors of DataBlock), this is how the data is designed
+ *    wordsPerBlock, blocksPerPage (unsigned), pageSize (bytes), pageShift (log2 of blocksPerPage, a power of two)
+ *    pages (page number to its words), this is how the data is designed
+ *    arenas (the mappings), arenaUsed (the bytes of the last arena given to pages)
+ *    recent: the pages accessed last, indexed by their number modulo RAM_RECENT_PAGES (a software TLB, the hash of the page table
+ *      is computed on a miss only)
  *    rule (Rule *), this is the pointer to the addressing rule
- *    DataBlock &getBlock(Address), obtain a DataBlock from the RAM
- *    void setBlock(Address, DataBlock&), set a value of a DataBlock in the RAM
+ *    double *getBlock(Address), the words of the block of an address in the RAM (its page is allocated if needed)
+ *    void setBlock(Address, const DataBlock&), copy a DataBlock to the RAM
+ *    double *page(uint64_t), the words of a page (allocated if needed)
  */
 class Ram {
-  friend class Cache;
+  template <class Policy> friend class Cache;
 public:
   Ram(Parameters &p, Rule *r);
+  Ram(const Ram &) = delete;
+  Ram &operator=(const Ram &) = delete;
+  ~Ram();
   void show(); // debugging only
   void summary(); // debugging only
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
 private:
-  unsigned numBlocks;
-  vector<DataBlock> data;
+  unsigned wordsPerBlock;
+  unsigned blocksPerPage;
+  size_t pageSize;
+  unordered_map<uint64_t, double *> pages;
+  vector<pair<void *, size_t>> arenas;
+  size_t arenaUsed = 0;
+  unsigned pageShift;
+  struct RecentPage { uint64_t number; double *words; };
+  vector<RecentPage> recent;
   Rule *rule;
   // Restricted function that can only be accessed by cache only
-  DataBlock &getBlock(Address address);
-  void setBlock(Address address, DataBlock &block);
+  inline double *getBlock(Address address) {
+    uint64_t index = this->rule->getBlockIndexRAM(address);
+    uint64_t number = index >> this->pageShift;
+    RecentPage &entry = this->recent[number % RAM_RECENT_PAGES];
+    if (entry.number != number) {
+      entry.words = this->page(number);
+      entry.number = number;
+    }
+    return entry.words + (index & (this->blocksPerPage - 1)) * this->wordsPerBlock; }
+  inline void setBlock(Address address, const DataBlock &block) { block.store(this->getBlock(address)); }
+  double *page(uint64_t number);
 };
 
-/* Class Cache
+/* Class Cache, templated on the replacement policy (see lib/policies.hh)
  *
  *  friend struct CPU, CPU can directly controls Cache
+ *  The member functions are defined in Cache.cc, which instantiates the cache of every policy in FOR_EACH_POLICY.
  *
  *  public members:
  *    Cache(Parameters&, Rule*, Ram*, Result*): Construtor
  *    void show(), print the runtime status of the cache to stdout
- *    double getDouble(Address);
- *    void setDouble(Address);
+ *    double getDouble(Address), returns 0 in timing mode;
+ *    void setDouble(Address), the value is dropped in timing mode;
+ *    void batch(const Access*, const Access*, double*), a batch of reads and writes in order, values[i] is the value loaded
+ *      by a read, or stored by a write (values is not used, and may be null, in timing mode), the sets and tags are decoded ACCESS_DECODE at a time
+ *    void access(Address, bool), simulate a read (false) or write (true) on the tags only
+ *    bool isTimingOnly(), whether the cache runs in timing mode (no payload)
+ *    Policy &getPolicy(), the replacement state (to attach the next uses to OPT)
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&), write the tags, the dirty bits, the payload, the replacement
+ *      and the sampling state to a checkpoint, read them back (a cache of another geometry or policy is a mismatch)
+ *    The tags-only primitives of a level of a hierarchy (the hierarchy moves the blocks between the levels):
+ *      bool probe(Address, bool), look the block up, count the hit or the miss, and update the replacement state on a hit
+ *      bool fill(Address, bool, Address&, bool&), insert the block (not in the cache), dirty or not,
+ *        true if a valid block was evicted (its address and whether it was dirty are set)
+ *      bool invalidate(Address, bool&), remove the block, true if it was in the cache (and whether it was dirty is set)
+ *      bool markDirty(Address), mark the block dirty (a write, or a write back from the level above), true if it is in the cache
  *  private members:
- *    Cache parameters: numSets (unsigned), numBlocks (unsigned), replacement_rule (unsigned: 0, 1, 2);
- *    Data: validBits, tags, blocks;
- *    Pointers to other class instance: rule, ram, result;
- *    BlockQueues: queue (FIFO) and lru_queue (LRU);
+ *    Cache parameters: numSets (unsigned), numBlocks (unsigned), blockSize (unsigned), wordsPerBlock (unsigned);
+ *    timingOnly (bool): simulate the tags only, payload is empty and the ram is never touched;
+ *    writeBack, writeAllocate (bool): the write policy (see Parameters);
+ *    dirty: whether the block of each way was written since it was filled (write-back), indexed like the blocks;
+ *    Data: tags (TagArray, an invalid way holds INVALID_TAG),
+ *      payload (the words of every block in one allocation, block set_id*numBlocks+block_id at a stride of wordsPerBlock);
+ *    Pointers to other class instance: rule, ram, result (measured, or warming while the stream is not sampled);
+ *    policy (Policy): the replacement state;
+ *    Sampling (timing mode, see Parameters::isSampled()):
+ *      sampleMask: the sets whose index has none of its bits are simulated, the accesses to the others are skipped (-S),
+ *        sampling only the sets of the policies whose sets are independent (Policy::setLocal);
+ *      window, period, untilSwitch: the accesses of a window are counted in measured, the others only warm the cache (-T),
+ *        they are counted in warming, untilSwitch is the number of accesses left before the next window starts or ends;
+ *      clusterAccesses, clusterMisses: the accesses and misses of each sampled set (-S), or of the current window (-T);
+ *      void sampled(unsigned, bool): count a sampled access (and whether it missed) in its cluster;
+ *      void switchPhase(): start the next window, or end it;
+ *    Prefetching (-F, see Prefetcher):
+ *      prefetcher: the prefetcher (none without -F), latency: the accesses a prefetch takes (see Parameters);
+ *      issuedAt: the time (of the prefetcher) a block was prefetched, 0 if it was filled by a demand access or used since,
+ *        indexed like the blocks;
+ *      evicted: the blocks the prefetches evicted (a table of as many blocks as the cache, indexed by the block number,
+ *        a block is forgotten when another one takes its entry), a demand miss on one of them is a polluting prefetch;
+ *      void prefetchAfter(Address, unsigned, bool): after a demand access (the index of its block, and whether it missed),
+ *        count the use of a prefetched block, and show the access to the prefetcher;
+ *      void prefetchPending(): prefetch the candidates of the prefetcher, once the payload of the access is read or written;
+ *      void prefetchBlock(uint64_t): prefetch a block the cache does not hold (into the cache, or into a stream buffer);
+ *      unsigned takeBuffered(unsigned, Tag, Address): move a missed block from a stream buffer into the cache,
+ *        returns its way (numBlocks if no buffer held it);
+ *    classifier: the classifier of the misses (none without -K), it sees every access, and the class of every miss is counted;
+ *    Victim cache (-V, see VictimCache):
+ *      victims: the victim cache (none without -V), missCache: whether it is a miss cache;
+ *      bool takeVictim(Address, bool&): on a miss that fills the cache, take the block from the victim cache (it is swapped
+ *        with the victim of the cache, replaceBlock() moves the victim into it), or keep it in the miss cache;
+ *        true if it held the block (nothing is fetched, and whether it was dirty is set), a miss cache receives the block otherwise;
+ *      void evictToVictims(unsigned, unsigned): move the victim of replaceBlock() into the victim cache, its payload goes to the
+ *        ram at once, and the writeback is counted when a dirty block leaves the victim cache;
  *
- *    DataBlock &findBlock(Address, bool), find the datablock from the cache and returns its reference
- *    DataBlock &updateBlock(Address), finds the block in RAM and put it into Cache
- *    DataBlock &fetchBlock(Address), subroutine of updateBlock, fetch the target block from the RAM, and return its reference
- *    DataBlock &replaceBlock(Address), subroutine of updateBlock, replace one block in the cache, and return the new block's reference
- *    unsigned replaceRandom(), subroutine of replaceBlock, returns the random block number to replace
+ *    unsigned findBlock(Address, bool), find the block in the cache and returns its index (set_id*numBlocks+block_id)
+ *      (NO_BLOCK for a write miss without write-allocate, the write goes around the cache)
+ *    unsigned lookup(unsigned, Tag, Address, bool), findBlock with the set and the tag of the address decoded (inline in Cache.cc)
+ *    double load(unsigned, Address), void store(unsigned, Address, double): the payload of a read or a write found at an index
+ *    unsigned updateBlock(unsigned, Tag, Address), finds the block in RAM and put it into Cache, returns its index
+ *    const double *fetchBlock(Address), subroutine of updateBlock, the words of the target block in the RAM
+ *    unsigned replaceBlock(unsigned, Tag, Address), subroutine of updateBlock, replace one block in the cache, and return the new block's index
+ *    DataBlock getBlock(unsigned), returns the view of the block of an index (of a way in a set, with two arguments)
  */
+template <class Policy>
 class Cache {
-  friend struct CPU;
+  template <class Memory> friend struct CPU;
+  template <class P> friend class Hierarchy;
 public:
   Cache(Parameters &p, Rule *r, Ram *rm, Result *resu);
   void show(); // debug only
   double getDouble(Address address); // Get the double from cache
   void setDouble(Address address, double value);
+  void batch(const Access *first, const Access *last, double *values); // A batch of accesses in order
+  inline void access(Address address, bool write) {
+    this->findBlock(address, write);
+    if (this->prefetcher)
+      this->prefetchPending(); }
+  inline bool isTimingOnly() const { return this->timingOnly; }
+  inline Policy &getPolicy() { return this->policy; }
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
+  inline bool probe(Address address, bool write) {
+    unsigned set_id = this->rule->getSetIndex(address);
+    unsigned block_id = this->tags.find(set_id, this->rule->getTag(address));
+    if (block_id != this->numBlocks) {
+      this->policy.touch(set_id, block_id);
+      write ? this->result->write_hit() : this->result->read_hit();
+      return true;
+    }
+    write ? this->result->write_miss() : this->result->read_miss();
+    return false; }
+  inline bool fill(Address address, bool dirtyFill, Address &victim, bool &victimDirty) {
+    unsigned set_id = this->rule->getSetIndex(address);
+    unsigned block_id = this->tags.findInvalid(set_id);
+    bool evicted = block_id == this->numBlocks;
+    if (evicted) {
+      block_id = this->policy.victim(set_id);
+      victim = this->rule->getAddress(this->tags.get(set_id, block_id), set_id);
+      victimDirty = this->dirty[set_id*this->numBlocks + block_id];
+    }
+    this->tags.set(set_id, block_id, this->rule->getTag(address));
+    this->dirty[set_id*this->numBlocks + block_id] = dirtyFill;
+    this->policy.insert(set_id, block_id);
+    return evicted; }
+  inline bool invalidate(Address address, bool &wasDirty) {
+    unsigned set_id = this->rule->getSetIndex(address);
+    unsigned block_id = this->tags.find(set_id, this->rule->getTag(address));
+    if (block_id == this->numBlocks)
+      return false;
+    wasDirty = this->dirty[set_id*this->numBlocks + block_id];
+    this->tags.invalidate(set_id, block_id);
+    this->policy.invalidate(set_id, block_id);
+    return true; }
+  inline bool markDirty(Address address) {
+    unsigned set_id = this->rule->getSetIndex(address);
+    unsigned block_id = this->tags.find(set_id, this->rule->getTag(address));
+    if (block_id == this->numBlocks)
+      return false;
+    this->dirty[set_id*this->numBlocks + block_id] = 1;
+    return true; }
 private:
   // Cache Parameters
   unsigned numSets;
   unsigned numBlocks;
-  unsigned replacement_rule;
-  // Data (Stored in vectors)
-  vector<vector<bool>> validBits;
-  vector<vector<unsigned>> tags;
-  vector<vector<DataBlock>> blocks;
+  unsigned blockSize;
+  unsigned wordsPerBlock;
+  bool timingOnly;
+  bool writeBack;
+  bool writeAllocate;
+  // The index of no block (a write around the cache)
+  static const unsigned NO_BLOCK = UINT32_MAX;
+  // Data (Tags in a flat set-major array, the words of the numSets*numBlocks blocks in a flat vector)
+  TagArray tags;
+  vector<double> payload;
+  vector<uint8_t> dirty;
   // Address rule, ram, and result
   Rule *rule;
   Ram *ram;
   Result *result;
-  // Block queue (to trigger the replacement rule)
-  BlockQueues queue;
-  BlockLRU lru_queue;
+  // Replacement state
+  Policy policy;
+  // Sampling (the accesses of the sets skipped, or of the warming between the windows, are not measured)
+  unsigned sampleMask = 0;
+  uint64_t window = 0, period = 0, untilSwitch = UINT64_MAX;
+  Result *measured;
+  Result warming;
+  bool sampling = false;
+  vector<uint64_t> clusterAccesses, clusterMisses;
+  inline void sampled(unsigned set_id, bool miss) {
+    if (!this->sampling)
+      return;
+    unsigned cluster = this->window ? 0 : set_id;
+    this->result->sample(this->clusterAccesses[cluster], this->clusterMisses[cluster], miss);
+    ++this->clusterAccesses[cluster];
+    this->clusterMisses[cluster] += miss; }
+  void switchPhase();
+  // Prefetching (the prefetched blocks not used yet, and the blocks evicted by the prefetches)
+  unique_ptr<Prefetcher> prefetcher;
+  unsigned latency = 0;
+  vector<uint64_t> issuedAt;
+  vector<uint64_t> evicted;
+  void prefetchAfter(Address address, unsigned index, bool miss);
+  void prefetchPending();
+  void prefetchBlock(uint64_t block);
+  unsigned takeBuffered(unsigned set_id, Tag tag, Address address);
+  // Miss classification
+  unique_ptr<MissClassifier> classifier;
+  // Victim cache (or miss cache)
+  unique_ptr<VictimCache> victims;
+  bool missCache = false;
+  bool takeVictim(Address address, bool &wasDirty);
+  void evictToVictims(unsigned set_id, unsigned block_id);
   // Helper (private) functions
-  DataBlock &findBlock(Address address, bool write); // Find the address entry in the block
-  DataBlock &updateBlock(Address address); // Update the block containing the address into the cache
-  inline DataBlock &fetchBlock(Address address) const {
+  unsigned findBlock(Address address, bool write); // Find the address entry in the block
+  inline unsigned lookup(unsigned set_id, Tag tag, Address address, bool write); // Find the entry of a decoded address
+  inline double load(unsigned index, Address address); // Read the word of an address from the block found
+  inline void store(unsigned index, Address address, double value); // Write the word of an address to the block found
+  unsigned updateBlock(unsigned set_id, Tag tag, Address address); // Update the block containing the address into the cache
+  inline const double *fetchBlock(Address address) const {
     return this->ram->getBlock(address); } // Fetch the block from RAM
-  DataBlock &replaceBlock(Address address); // Replace one block and return its reference
-  inline unsigned replaceRandom() const { return rand() % this->numBlocks; }
-  // Reset the cache (only accessible from CPU::reset())
+  unsigned replaceBlock(unsigned set_id, Tag tag, Address address); // Replace one block (writing it back if it is dirty)
+  void writeBackBlock(unsigned set_id, unsigned block_id); // Write a dirty block back to the ram
+  inline void written(unsigned index) { // A write to a block: it is dirty (write-back), or the word goes through
+    if (this->writeBack)
+      this->dirty[index] = 1;
+    else
+      this->result->write_through(WORD_SIZE); }
+  inline DataBlock getBlock(unsigned index) {
+    return DataBlock(this->payload.data() + (size_t)index*this->wordsPerBlock, this->wordsPerBlock); }
+  inline DataBlock getBlock(unsigned set_id, unsigned block_id) { return this->getBlock(set_id*this->numBlocks + block_id); }
+  // Reset the cache, writing the dirty payload back (only accessible from CPU::reset())
+  void reset();
+};
+
+/* Class BlockRecorder, the memory of the recording pass of OPT
+ *
+ *  Every access appends the block number of its address (Rule::getBlockIndexRAM) to a NextUse,
+ *  no data is stored, so loads return 0.
+ *  public members:
+ *    BlockRecorder(Rule*, NextUse*): Constructor
+ *    double getDouble(Address), record a read
+ *    void setDouble(Address, double), record a write
+ *    void batch(const Access*, const Access*, double*), record a batch
+ *    void reset(), nothing to invalidate (the stream goes on)
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&), not checkpointed (OPT is not)
+ */
+class BlockRecorder {
+public:
+  BlockRecorder(Rule *r, NextUse *s) { rule = r; stream = s; }
+  inline double getDouble(Address address) { this->stream->record(this->rule->getBlockIndexRAM(address)); return 0; }
+  inline void setDouble(Address address, double value) { this->stream->record(this->rule->getBlockIndexRAM(address)); }
+  inline void batch(const Access *first, const Access *last, double *values) { accessEach(*this, first, last, values); }
+  inline void reset() {}
+  inline void save(CheckpointWriter &w) { throw string("The recording of OPT is not checkpointed (Code: 010).\n"); }
+  inline void restore(CheckpointReader &r) { throw string("The recording of OPT is not checkpointed (Code: 010).\n"); }
+private:
+  Rule *rule;
+  NextUse *stream;
+};
+
+/* Class StackProfiler, the memory of the miss curves (-m)
+ *
+ *  friend function: print(), show the misses of every cache (and the instruction count of a Result) to stdout
+ *  Every access is measured by a StackDistance on its block number (Rule::getBlockIndexRAM),
+ *  for every power-of-two cache from one block to the cache size, and every power-of-two associativity (LRU).
+ *  public members:
+ *    StackProfiler(Parameters&, Rule*): Constructor
+ *    double getDouble(Address), measure a read (returns 0)
+ *    void setDouble(Address, double), measure a write
+ *    void batch(const Access*, const Access*, double*), measure a batch
+ *    void reset(), empty the stacks and clear the counters (as CPU::reset() invalidates the cache)
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&), the stacks are not checkpointed (only without -l)
+ *  private members:
+ *    blockSize, maxBlocks (unsigned): the block size, and the largest cache in blocks
+ *    rule (Rule *), distances (StackDistance)
+ */
+class StackProfiler {
+  friend ostream &print(ostream &os, const StackProfiler &profiler, const Result &result);
+public:
+  StackProfiler(Parameters &p, Rule *r);
+  inline double getDouble(Address address) { this->distances.access(this->rule->getBlockIndexRAM(address), false); return 0; }
+  inline void setDouble(Address address, double value) { this->distances.access(this->rule->getBlockIndexRAM(address), true); }
+  inline void batch(const Access *first, const Access *last, double *values) { accessEach(*this, first, last, values); }
+  inline void reset() { this->distances.reset(); }
+  inline void save(CheckpointWriter &w) { throw string("The stacks of the miss curves are not checkpointed, give it no -l (Code: 010).\n"); }
+  inline void restore(CheckpointReader &r) { throw string("The stacks of the miss curves are not checkpointed, give it no -l (Code: 010).\n"); }
+private:
+  unsigned blockSize;
+  unsigned maxBlocks;
+  Rule *rule;
+  StackDistance distances;
+};
+/* Print the miss curves to stdout */
+ostream &print(ostream &os, const StackProfiler &profiler, const Result &result);
+
+/* Class SweepRunner, a cache of a sweep (the caches of the policies are behind this interface, see Sweep.cc)
+ *  public members:
+ *    void run(const Access*, const Access*): Simulate a batch of the stream
+ *    Parameters &getParameters(): The configuration of the cache
+ *    Result &getResult(): The results of the cache
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&): Write the cache and its results to a checkpoint, read them back
+ */
+class SweepRunner {
+public:
+  virtual ~SweepRunner() {}
+  virtual void run(const Access *first, const Access *last) = 0;
+  virtual Parameters &getParameters() = 0;
+  virtual Result &getResult() = 0;
+  virtual void save(CheckpointWriter &w) = 0;
+  virtual void restore(CheckpointReader &r) = 0;
+};
+
+/* Class Sweep, the memory of a sweep
+ *
+ *  friend function: print(), show the results of every configuration (and the instruction count of a Result) to stdout
+ *  The accesses are appended to a batch, a full batch is published to a pool of threads (while the next one is filled),
+ *  and the threads take the caches one at a time to run the batch on them, so every cache sees the whole stream in order.
+ *  public members:
+ *    Sweep(vector<Parameters>&, unsigned): Constructor, builds the caches of the configurations, and starts the threads
+ *    ~Sweep(): Stop the threads
+ *    double getDouble(Address), append a read (returns 0)
+ *    void setDouble(Address, double), append a write
+ *    void batch(const Access*, const Access*, double*), append a batch
+ *    void reset(), append a reset of the caches
+ *    void finish(), run the last batch, and wait for the threads to be done with it
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&), write the cache of every configuration to a checkpoint
+ *      (once the batch is run), read them back (before the first batch)
+ *  private members:
+ *    runners (SweepRunner), one per configuration
+ *    batches (two vectors of Access): the batch being filled, and the one being run, filling is the index of the first
+ *    workers (threads), lock (mutex), ready and idle (conditions): a batch is published, the threads are done with it
+ *    published (the number of batches published), busy (the threads running the last one), nextRunner (the next cache to take)
+ *    stopping (bool): no batch will be published anymore
+ *    void publish(): hand the batch being filled to the threads (waits for the previous one)
+ *    void work(): the loop of a thread
+ */
+class Sweep {
+  friend ostream &print(ostream &os, const Sweep &sweep, const Result &result);
+public:
+  Sweep(vector<Parameters> &configs, unsigned n_threads);
+  ~Sweep();
+  inline double getDouble(Address address) { this->append(address, ACCESS_READ); return 0; }
+  inline void setDouble(Address address, double value) { this->append(address, ACCESS_WRITE); }
+  inline void batch(const Access *first, const Access *last, double *values) { accessEach(*this, first, last, values); }
+  inline void reset() { this->append(0, ACCESS_RESET); }
+  void finish();
+  void save(CheckpointWriter &w);
+  void restore(CheckpointReader &r);
+private:
+  vector<unique_ptr<SweepRunner>> runners;
+  vector<Access> batches[2];
+  unsigned filling = 0;
+  vector<thread> workers;
+  mutex lock;
+  condition_variable ready, idle;
+  uint64_t published = 0;
+  unsigned busy = 0;
+  atomic<unsigned> nextRunner;
+  bool stopping = false;
+  inline void append(Address address, AccessOp op) {
+    Access a = {address, op};
+    this->batches[this->filling].push_back(a);
+    if (this->batches[this->filling].size() == this->batches[this->filling].capacity())
+      this->publish(); }
+  void publish();
+  void work();
+};
+/* Print the results of a sweep to stdout */
+ostream &print(ostream &os, const Sweep &sweep, const Result &result);
+
+/* Class TraceCapture, the memory of a capture (-w)
+ *
+ *  friend function: print(), show the size of the trace (and the instruction count of a Result) to stdout
+ *  Every access is appended to a TraceWriter, the instructions that are not accesses are counted from the Result of the CPU
+ *  public members:
+ *    TraceCapture(TraceWriter*, Result*): Constructor
+ *    double getDouble(Address), append a read (returns 0)
+ *    void setDouble(Address, double), append a write
+ *    void batch(const Access*, const Access*, double*), append a batch
+ *    void reset(), cut the trace (CPU::reset() resets the Result right after)
+ *    void finish(), count the last instructions
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&), not checkpointed (the trace is the whole stream)
+ *  private members:
+ *    trace (TraceWriter *), result (Result *), accesses (since the last reset)
+ */
+class TraceCapture {
+  friend ostream &print(ostream &os, const TraceCapture &capture, const Result &result);
+public:
+  TraceCapture(TraceWriter *w, Result *r) { trace = w; result = r; }
+  inline double getDouble(Address address) { ++this->accesses; this->trace->append(address, false); return 0; }
+  inline void setDouble(Address address, double value) { ++this->accesses; this->trace->append(address, true); }
+  inline void batch(const Access *first, const Access *last, double *values) { accessEach(*this, first, last, values); }
+  inline void reset() { this->finish(); this->trace->reset(); }
+  inline void finish() {
+    this->trace->instructions(this->result->count_instructions() - this->accesses);
+    this->accesses = 0; }
+  inline void save(CheckpointWriter &w) { throw string("A capture is not checkpointed (Code: 010).\n"); }
+  inline void restore(CheckpointReader &r) { throw string("A capture is not checkpointed (Code: 010).\n"); }
+private:
+  TraceWriter *trace;
+  Result *result;
+  uint64_t accesses = 0;
+};
+/* Print the size of a trace to stdout */
+ostream &print(ostream &os, const TraceCapture &capture, const Result &result);
+
+/* Class Hierarchy, templated on the replacement policy (of every level), the memory of a hierarchy of caches (-L)
+ *
+ *  friend function: print(), show the results of the levels below L1 (L1 counts in the Result of the CPU)
+ *  Every level is a Cache in timing mode, with a Rule of its own, the block size is the same in every level.
+ *  A miss of a level goes to the next one (the same read or write), a miss of the last level goes to the ram,
+ *  and the block is moved between the levels by the inclusion policy (see Inclusion).
+ *  The levels are called through the inline primitives of Cache (no virtual call), the definitions are in Hierarchy.cc.
+ *  public members:
+ *    Hierarchy(Parameters&, Rule*, Ram*, Result*): Constructor, L1 is the cache of the parameters, the levels below it are given by -L
+ *    double getDouble(Address), a read (returns 0)
+ *    void setDouble(Address, double), a write
+ *    void batch(const Access*, const Access*, double*), the accesses of a batch in order
+ *    void reset(), invalidate every level, and clear the results of the levels below L1
+ *    unsigned size(), the number of levels
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&), write every level, the results below L1 and the traffic
+ *      to a checkpoint, read them back
+ *  private members:
+ *    levels (the parameters, rule, result and cache of each level, L1 first), inclusion
+ *    backInvalidations (of each level): the blocks invalidated above it when it evicted them (inclusive)
+ *    blockSize, memoryRead, memoryWritten: the traffic between the last level and the ram (bytes)
+ *    void access(Address, bool): simulate an access on the levels
+ *    void writeBack(size_t, Address): write a dirty victim of a level back to the next level that holds it (or to the ram)
+ *  The Result of a level counts the traffic below it (the blocks it fetched and wrote back).
+ */
+template <class Policy>
+class Hierarchy {
+  template <class P> friend ostream &print(ostream &os, const Hierarchy<P> &hierarchy);
+public:
+  Hierarchy(Parameters &p, Rule *r, Ram *rm, Result *resu);
+  inline double getDouble(Address address) { this->access(address, false); return 0; }
+  inline void setDouble(Address address, double value) { this->access(address, true); }
+  inline void batch(const Access *first, const Access *last, double *values) { accessEach(*this, first, last, values); }
   void reset();
+  inline unsigned size() const { return this->levels.size(); }
+  void save(CheckpointWriter &w) const;
+  void restore(CheckpointReader &r);
+private:
+  struct Level {
+    Level(Parameters &p, Rule *r, Ram *rm, Result *resu) : params(p), rule(r), result(resu), cache(p, r, rm, resu) {}
+    Parameters params;
+    Rule *rule;
+    Result *result;
+    Cache<Policy> cache;
+  };
+  vector<unique_ptr<Level>> levels;
+  vector<unique_ptr<Rule>> rules;
+  vector<unique_ptr<Result>> results;
+  vector<uint64_t> backInvalidations;
+  Inclusion inclusion;
+  unsigned blockSize;
+  uint64_t memoryRead = 0, memoryWritten = 0;
+  void access(Address address, bool write);
+  void writeBack(size_t level, Address victim);
+};
+/* Print the results of the levels below L1 to stdout */
+template <class Policy>
+ostream &print(ostream &os, const Hierarchy<Policy> &hierarchy);
+
+/* The accesses the producer of a partitioned cache routes to a shard are pushed to its ring PARTITION_CHUNK at a time */
+#define PARTITION_CHUNK 1024
+/* The capacity of the ring of a shard (accesses) */
+#define PARTITION_RING (1u<<16)
+
+/* Class Partition, templated on the replacement policy, the memory of a cache whose sets are simulated by several threads (-P)
+ *
+ *  The sets are cut into contiguous ranges of the same size, and every range (a shard) is a Cache of its own, on a thread of its own:
+ *  the thread of the CPU (the producer) decodes the set of every access, and routes it to the ring (a RingQueue) of its shard,
+ *  every shard sees the accesses of its sets in order, so its hits, misses and replacements are those of the single cache,
+ *  as long as the state of a set depends on that set only (Policy::setLocal, random, BRRIP, DRRIP and OPT are not).
+ *  The cache of a shard has the sets of its range only, its Rule decodes the offset of the set in the range
+ *  (the block number modulo the sets of a shard), and a tag that tells the blocks of a set apart as the one of the whole cache does.
+ *  The Result of every shard is added to the one of the CPU by finish(), in timing mode only (the loads return 0).
+ *  public members:
+ *    Partition(Parameters&, Rule*, Ram*, Result*): Constructor, builds the shards and starts their threads
+ *    ~Partition(): Stop the threads (if finish() was not reached)
+ *    double getDouble(Address), route a read (returns 0)
+ *    void setDouble(Address, double), route a write
+ *    void batch(const Access*, const Access*, double*), route a batch (its sets are decoded ACCESS_DECODE at a time)
+ *    void reset(), route a reset to every shard (it resets the cache and the Result of the shard)
+ *    void finish(), push the last accesses, wait for the threads to be done, and merge the results of the shards
+ *    void save(CheckpointWriter&), void restore(CheckpointReader&), the shards are not checkpointed (only without -l)
+ *  private members:
+ *    shards (the parameters, rule, result, cache and CPU of each shard, with its ring, its pending accesses and its thread)
+ *    rule (of the whole cache), result (of the CPU), setsPerShard
+ *    void route(Address, unsigned, AccessOp): append an access to the pending accesses of the shard of its set
+ *    void push(Shard&): hand the pending accesses of a shard to its ring (waits for room)
+ *    void work(Shard&): the loop of the thread of a shard
+ */
+template <class Policy>
+class Partition {
+public:
+  Partition(Parameters &p, Rule *r, Ram *rm, Result *resu);
+  ~Partition();
+  inline double getDouble(Address address) {
+    this->route(address, this->rule->getSetIndex(address), ACCESS_READ); return 0; }
+  inline void setDouble(Address address, double value) {
+    this->route(address, this->rule->getSetIndex(address), ACCESS_WRITE); }
+  void batch(const Access *first, const Access *last, double *values);
+  void reset();
+  void finish();
+  inline void save(CheckpointWriter &w) { throw string("The shards of -P are not checkpointed, give it no -l (Code: 010).\n"); }
+  inline void restore(CheckpointReader &r) { throw string("The shards of -P are not checkpointed, give it no -l (Code: 010).\n"); }
+private:
+  struct Shard {
+    Shard(const Parameters &p, Ram *rm) : params(p), rule(this->params), cache(this->params, &this->rule, rm, &this->result),
+      cpu(&this->cache, &this->result), ring(PARTITION_RING) { pending.reserve(PARTITION_CHUNK); }
+    Parameters params;
+    Rule rule;
+    Result result;
+    Cache<Policy> cache;
+    CPU<Cache<Policy>> cpu;
+    RingQueue<Access> ring;
+    vector<Access> pending;
+    thread worker;
+  };
+  vector<unique_ptr<Shard>> shards;
+  Rule *rule;
+  Result *result;
+  unsigned setsPerShard;
+  inline void route(Address address, unsigned set_id, AccessOp op) {
+    Shard &shard = *this->shards[set_id / this->setsPerShard];
+    Access a = {address, op};
+    shard.pending.push_back(a);
+    if (shard.pending.size() == PARTITION_CHUNK)
+      this->push(shard); }
+  void push(Shard &shard);
+  void work(Shard &shard);
+};
+
+/* The states of a line of the cache of a core (see Protocol) */
+enum LineState : uint8_t { LINE_INVALID, LINE_SHARED, LINE_EXCLUSIVE, LINE_OWNED, LINE_MODIFIED };
+/* The requests of a core on the bus: a read miss, a write miss, a write to a shared line, and the write back of a dirty victim */
+enum BusOp : uint8_t { BUS_READ, BUS_READ_EXCLUSIVE, BUS_UPGRADE, BUS_WRITEBACK };
+
+/* Class Multicore, templated on the replacement policy (of every cache), the cores of a multicore (-N)
+ *
+ *  friend function: print(), show the results of every core, of the shared level, and the memory traffic
+ *  Every core has a private cache (tags only) with a state per line (LineState), kept coherent by a snooping bus,
+ *  the misses that no other core supplies go to the shared level (-L, one level), or to the memory.
+ *  The cores run on host threads of their own, the share of the algorithm of a core appends its accesses to its quantum,
+ *  and the cores are synchronized every quantum (-Q accesses):
+ *    every core simulates its quantum on its own cache in parallel: a hit on a line in a state that allows the access
+ *      is done, the others (the misses, a write to a shared or owned line, the write back of a dirty victim) fill or update
+ *      the line at once and leave a request for the bus;
+ *    the last core to be done resolves the bus alone: the requests of every core, in the order of the cores,
+ *      snoop the caches of the others (downgrade or invalidate their copies), and set the state of the requesting line.
+ *  So the results do not depend on the host threads, a write of a core is seen by the others at the end of the quantum
+ *  (1 is the exact interleaving of the cores, access by access).
+ *  public members:
+ *    Multicore(Parameters&, Rule*, Result*): Constructor, builds the cores and the shared level
+ *    void run(function): run the kernel of every core on its thread (kernel(core, cpu)), wait for them,
+ *      and add their results to the one of the CPU
+ *    struct Core, the memory of the CPU of a core (getDouble() returns 0, the values are not simulated)
+ *  private members:
+ *    cores, rule, result (of the CPU), protocol, blockSize, numSets, numBlocks
+ *    shared (the shared level with its parameters, rule and result, none without -L), memoryRead, memoryWritten
+ *    lock, next (condition), arrived (the cores done with the quantum), active (the cores still running), leaving, round
+ *    void step(Core&, bool): simulate the quantum of a core, and wait for the others (the last one resolves the bus)
+ *    void resolve(): apply the requests of every core on the bus
+ *    void fetch(Address), writeBack(Address): a block read from, or written back to, the shared level (or the memory)
+ */
+template <class Policy>
+class Multicore {
+  template <class P> friend ostream &print(ostream &os, const Multicore<P> &multicore);
+public:
+  struct Core;
+  Multicore(Parameters &p, Rule *r, Result *resu);
+  void run(const function<void(unsigned, CPU<Core>&)> &kernel);
+  struct Core {
+    Core(Multicore *m, unsigned i);
+    inline double getDouble(Address address) { this->append(address, ACCESS_READ); return 0; }
+    inline void setDouble(Address address, double value) { this->append(address, ACCESS_WRITE); }
+    inline void batch(const Access *first, const Access *last, double *values) { accessEach(*this, first, last, values); }
+    struct Request { Address address; BusOp op; };
+    Multicore *owner;
+    unsigned id;
+    TagArray tags;
+    Policy policy;
+    vector<uint8_t> states;
+    Result result;
+    uint64_t coherenceMisses = 0, invalidations = 0, transfers = 0, busReads = 0, busExclusives = 0, upgrades = 0;
+    unordered_set<uint64_t> lost;
+    vector<Access> quantum;
+    vector<Request> requests;
+    inline void append(Address address, AccessOp op) {
+      Access a = {address, op};
+      this->quantum.push_back(a);
+      if (this->quantum.size() == this->quantum.capacity())
+        this->owner->step(*this, false); }
+    void simulate();
+  };
+private:
+  struct Shared {
+    Shared(Parameters &p) : params(p), rule(this->params), cache(this->params, &this->rule, nullptr, &this->result) {}
+    Parameters params;
+    Rule rule;
+    Result result;
+    Cache<Policy> cache;
+  };
+  vector<unique_ptr<Core>> cores;
+  unique_ptr<Shared> shared;
+  Rule *rule;
+  Result *result;
+  Protocol protocol;
+  unsigned blockSize, numSets, numBlocks;
+  uint64_t memoryRead = 0, memoryWritten = 0;
+  mutex lock;
+  condition_variable next;
+  unsigned arrived = 0, active = 0, leaving = 0;
+  uint64_t round = 0;
+  void step(Core &core, bool last);
+  void resolve();
+  void fetch(Address address);
+  void writeBack(Address address);
 };
+/* Print the results of every core, of the shared level, and the memory traffic to stdout */
+template <class Policy>
+ostream &print(ostream &os, const Multicore<Policy> &multicore);
 
-/* struct Cpu
+/* struct Cpu, templated on the memory it accesses (Cache<Policy>)
  *  public members:
- *   CPU(Cache*, Result*), constructor
+ *   CPU(Memory*, Result*), constructor
  *   double loadDouble(Address), load the value from the address given
  *   void storeDouble(Address, double), store the value to the address given
  *   Register addDouble(Register, Register), return the sum of the two values in the Registers
  *   Register multDouble(Register, Register), return the product of the two values in the Registers
- *   void reset(), reset the result, and the validBits of the Cache
+ *   void batch(const Access*, const Access*, double*), a batch of loads and stores in order (an instruction each),
+ *     values[i] is the value loaded by a read, or stored by a write (see Cache::batch)
+ *   void compute(uint64_t), count instructions that are not memory accesses (replayed from a trace)
+ *   void reset(), reset the result, and invalidate the tags of the Cache
+ *   void save(CheckpointWriter&), void restore(CheckpointReader&), write the state of the memory to a checkpoint, read it back
  */
+template <class Memory>
 struct CPU {
-  CPU(Cache *c, Result *r) { cache = c; result = r; }
-  inline double loadDouble(Address &address) {
+  CPU(Memory *c, Result *r) { cache = c; result = r; }
+  inline double loadDouble(Address address) {
     this->result->instruction(); return this->cache->getDouble(address); }
-  inline void storeDouble(Address &address, double value) {
+  inline void storeDouble(Address address, double value) {
     this->result->instruction(); this->cache->setDouble(address, value); }
   inline Register addDouble(Register value1, Register value2) {
     this->result->instruction(); return value1 + value2; }
   inline Register multDouble(Register value1, Register value2) {
     this->result->instruction(); return value1 * value2; }
+  inline void batch(const Access *first, const Access *last, double *values) {
+    this->result->instructions(last - first); this->cache->batch(first, last, values); }
+  inline void compute(uint64_t count) { this->result->instructions(count); }
   inline void reset() { this->cache->reset(); this->result->reset(); }
+  inline void save(CheckpointWriter &w) { this->cache->save(w); }
+  inline void restore(CheckpointReader &r) { this->cache->restore(r); }
 private:
-  Cache *cache;
+  Memory *cache;
   Result *result;
 };